@@ -91,6 +91,9 @@ int main(int argc, char **argv)
 	// Load the models if images found
 	LandmarkDetector::FaceModelParameters det_parameters(arguments);
 
+	// The threads used by landmark detection
+	LandmarkDetector::TaskScheduler::Configure(det_parameters.num_threads, det_parameters.first_core);
+
 	// The modules that are being used for tracking
 	std::cout << "Loading the model" << std::endl;
 	LandmarkDetector::CLNF face_model(det_parameters.model_location);
@@ -132,6 +135,9 @@ int main(int argc, char **argv)
 		std::cout << "WARNING: no eye model found" << std::endl;
 	}
 
+	// The eye models are only fit as part of the hierarchical refinement, without it there are no eye landmarks or gaze
+	bool track_eyes = face_model.eye_model && det_parameters.refine_hierarchical;
+
 	if (face_analyser.GetAUClassNames().size() == 0 && face_analyser.GetAUClassNames().size() == 0)
 	{
 		std::cout << "WARNING: no Action Unit models found" << std::endl;
@@ -144,7 +150,7 @@ int main(int argc, char **argv)
 		Utilities::RecorderOpenFaceParameters recording_params(arguments, false, false,
 			image_reader.fx, image_reader.fy, image_reader.cx, image_reader.cy);
 
-		if (!face_model.eye_model)
+		if (!track_eyes)
 		{
 			recording_params.setOutputGaze(false);
 		}
@@ -189,19 +195,23 @@ int main(int argc, char **argv)
 			// if there are multiple detections go through them
 			bool success = LandmarkDetector::DetectLandmarksInImage(rgb_image, face_detections[face], face_model, det_parameters, grayscale_image);
 
+			// Pose, 3D landmarks, eye landmarks and gaze are computed once and shared by the analysis, visualization and output
+			LandmarkDetector::FaceFrameResult face_result(face_model, image_reader.fx, image_reader.fy, image_reader.cx, image_reader.cy);
+
 			// Estimate head pose and eye gaze				
-			cv::Vec6d pose_estimate = LandmarkDetector::GetPose(face_model, image_reader.fx, image_reader.fy, image_reader.cx, image_reader.cy);
+			cv::Vec6d pose_estimate = face_result.GetPose();
 
 			// Gaze tracking, absolute gaze direction
 			cv::Point3f gaze_direction0(0, 0, -1);
 			cv::Point3f gaze_direction1(0, 0, -1);
 			cv::Vec2f gaze_angle(0, 0);
 
-			if (face_model.eye_model)
+			if (track_eyes)
 			{
-				GazeAnalysis::EstimateGaze(face_model, gaze_direction0, image_reader.fx, image_reader.fy, image_reader.cx, image_reader.cy, true);
-				GazeAnalysis::EstimateGaze(face_model, gaze_direction1, image_reader.fx, image_reader.fy, image_reader.cx, image_reader.cy, false);
-				gaze_angle = GazeAnalysis::GetGazeAngle(gaze_direction0, gaze_direction1);
+				GazeAnalysis::EstimateGaze(face_result);
+				gaze_direction0 = face_result.GetGazeDirection0();
+				gaze_direction1 = face_result.GetGazeDirection1();
+				gaze_angle = face_result.GetGazeAngle();
 			}
 
 			cv::Mat sim_warped_img;
@@ -215,21 +225,30 @@ int main(int argc, char **argv)
 				face_analyser.GetLatestHOG(hog_descriptor, num_hog_rows, num_hog_cols);
 			}
 
-			// Displaying the tracking visualizations
-			visualizer.SetObservationFaceAlign(sim_warped_img);
-			visualizer.SetObservationHOG(hog_descriptor, num_hog_rows, num_hog_cols);
-			visualizer.SetObservationLandmarks(face_model.detected_landmarks, 1.0, face_model.GetVisibilities()); // Set confidence to high to make sure we always visualize
-			visualizer.SetObservationPose(pose_estimate, 1.0);
-			visualizer.SetObservationGaze(gaze_direction0, gaze_direction1, LandmarkDetector::CalculateAllEyeLandmarks(face_model), LandmarkDetector::Calculate3DEyeLandmarks(face_model, image_reader.fx, image_reader.fy, image_reader.cx, image_reader.cy), face_model.detection_certainty);
-			visualizer.SetObservationActionUnits(face_analyser.GetCurrentAUsReg(), face_analyser.GetCurrentAUsClass());
+			// Displaying the tracking visualizations (only if they are shown or recorded)
+			if (visualizer.IsVisualizing() || recording_params.outputTracked())
+			{
+				visualizer.SetObservationFaceAlign(sim_warped_img);
+				visualizer.SetObservationHOG(hog_descriptor, num_hog_rows, num_hog_cols);
+				visualizer.SetObservationLandmarks(face_model.detected_landmarks, 1.0, face_model.GetVisibilities()); // Set confidence to high to make sure we always visualize
+				visualizer.SetObservationPose(pose_estimate, 1.0);
+				if (track_eyes)
+				{
+					visualizer.SetObservationGaze(gaze_direction0, gaze_direction1, face_result.GetEyeLandmarks2D(), face_result.GetEyeLandmarks3D(), face_model.detection_certainty);
+				}
+				visualizer.SetObservationActionUnits(face_analyser.GetCurrentAUsReg(), face_analyser.GetCurrentAUsClass());
+			}
 
 			// Setting up the recorder output
 			open_face_rec.SetObservationHOG(face_model.detection_success, hog_descriptor, num_hog_rows, num_hog_cols, 31); // The number of channels in HOG is fixed at the moment, as using FHOG
 			open_face_rec.SetObservationActionUnits(face_analyser.GetCurrentAUsReg(), face_analyser.GetCurrentAUsClass());
-			open_face_rec.SetObservationLandmarks(face_model.detected_landmarks, face_model.GetShape(image_reader.fx, image_reader.fy, image_reader.cx, image_reader.cy),
+			open_face_rec.SetObservationLandmarks(face_model.detected_landmarks, face_result.GetShape3D(),
 				face_model.params_global, face_model.params_local, face_model.detection_certainty, face_model.detection_success);
 			open_face_rec.SetObservationPose(pose_estimate);
-			open_face_rec.SetObservationGaze(gaze_direction0, gaze_direction1, gaze_angle, LandmarkDetector::CalculateAllEyeLandmarks(face_model), LandmarkDetector::Calculate3DEyeLandmarks(face_model, image_reader.fx, image_reader.fy, image_reader.cx, image_reader.cy));
+			if (track_eyes)
+			{
+				open_face_rec.SetObservationGaze(gaze_direction0, gaze_direction1, gaze_angle, face_result.GetEyeLandmarks2D(), face_result.GetEyeLandmarks3D());
+			}
 			open_face_rec.SetObservationFaceAlign(sim_warped_img);
 			open_face_rec.SetObservationFaceID(face);
 			open_face_rec.WriteObservation();
@@ -240,8 +259,11 @@ int main(int argc, char **argv)
 			visualizer.ShowObservation();
 		}
 
-		open_face_rec.SetObservationVisualization(visualizer.GetVisImage());
-		open_face_rec.WriteObservationTracked();
+		if (recording_params.outputTracked())
+		{
+			open_face_rec.SetObservationVisualization(visualizer.GetVisImage());
+			open_face_rec.WriteObservationTracked();
+		}
 
 		open_face_rec.Close();
 
@@ -86,6 +86,9 @@ int main(int argc, char **argv)
 
 	LandmarkDetector::FaceModelParameters det_parameters(arguments);
 
+	// The threads used by landmark detection
+	LandmarkDetector::TaskScheduler::Configure(det_parameters.num_threads, det_parameters.first_core);
+
 	// The modules that are being used for tracking
 	LandmarkDetector::CLNF face_model(det_parameters.model_location);
 	if (!face_model.loaded_successfully)
@@ -99,6 +102,9 @@ int main(int argc, char **argv)
 		std::cout << "WARNING: no eye model found" << std::endl;
 	}
 
+	// The eye models are only fit as part of the hierarchical refinement, without it there are no eye landmarks or gaze
+	bool track_eyes = face_model.eye_model && det_parameters.refine_hierarchical;
+
 	// Open a sequence
 	Utilities::SequenceCapture sequence_reader;
 
@@ -118,6 +124,9 @@ int main(int argc, char **argv)
 		if (!sequence_reader.Open(arguments))
 			break;
 
+		// If frames are being skipped the tracker needs to account for larger motion between frames
+		det_parameters.frame_stride = sequence_reader.GetFrameStride();
+
 		INFO_STREAM("Device or file opened");
 
 		cv::Mat rgb_image = sequence_reader.GetNextFrame();
@@ -132,19 +141,26 @@ int main(int argc, char **argv)
 			// The actual facial landmark detection / tracking
 			bool detection_success = LandmarkDetector::DetectLandmarksInVideo(rgb_image, face_model, det_parameters, grayscale_image);
 
+			// Incorporate the eye models if they are refined in the background
+			face_model.FinishHierarchicalRefinement();
+
+			// Pose, 3D landmarks, eye landmarks and gaze are computed once and shared by the analysis, visualization and output
+			LandmarkDetector::FaceFrameResult face_result(face_model, sequence_reader.fx, sequence_reader.fy, sequence_reader.cx, sequence_reader.cy);
+
 			// Gaze tracking, absolute gaze direction
 			cv::Point3f gazeDirection0(0, 0, -1);
 			cv::Point3f gazeDirection1(0, 0, -1);
 
 			// If tracking succeeded and we have an eye model, estimate gaze
-			if (detection_success && face_model.eye_model)
+			if (detection_success && track_eyes)
 			{
-				GazeAnalysis::EstimateGaze(face_model, gazeDirection0, sequence_reader.fx, sequence_reader.fy, sequence_reader.cx, sequence_reader.cy, true);
-				GazeAnalysis::EstimateGaze(face_model, gazeDirection1, sequence_reader.fx, sequence_reader.fy, sequence_reader.cx, sequence_reader.cy, false);
+				GazeAnalysis::EstimateGaze(face_result);
+				gazeDirection0 = face_result.GetGazeDirection0();
+				gazeDirection1 = face_result.GetGazeDirection1();
 			}
 
 			// Work out the pose of the head from the tracked model
-			cv::Vec6d pose_estimate = LandmarkDetector::GetPose(face_model, sequence_reader.fx, sequence_reader.fy, sequence_reader.cx, sequence_reader.cy);
+			cv::Vec6d pose_estimate = face_result.GetPose();
 
 			// Keeping track of FPS
 			fps_tracker.AddFrame();
@@ -153,7 +169,10 @@ int main(int argc, char **argv)
 			visualizer.SetImage(rgb_image, sequence_reader.fx, sequence_reader.fy, sequence_reader.cx, sequence_reader.cy);
 			visualizer.SetObservationLandmarks(face_model.detected_landmarks, face_model.detection_certainty, face_model.GetVisibilities());
 			visualizer.SetObservationPose(pose_estimate, face_model.detection_certainty);
-			visualizer.SetObservationGaze(gazeDirection0, gazeDirection1, LandmarkDetector::CalculateAllEyeLandmarks(face_model), LandmarkDetector::Calculate3DEyeLandmarks(face_model, sequence_reader.fx, sequence_reader.fy, sequence_reader.cx, sequence_reader.cy), face_model.detection_certainty);
+			if (track_eyes)
+			{
+				visualizer.SetObservationGaze(gazeDirection0, gazeDirection1, face_result.GetEyeLandmarks2D(), face_result.GetEyeLandmarks3D(), face_model.detection_certainty);
+			}
 			visualizer.SetFps(fps_tracker.GetFPS());
 			// detect key presses (due to pecularities of OpenCV, you can get it when displaying images)
 			char character_press = visualizer.ShowObservation();
@@ -131,6 +131,25 @@ void NonOverlapingDetections(const std::vector<LandmarkDetector::CLNF>& clnf_mod
 	}
 }
 
+// Detecting all of the faces in a frame with the face detectors of the given model
+void DetectFacesInFrame(std::vector<cv::Rect_<float> >& face_detections, const cv::Mat& rgb_image, const cv::Mat_<uchar>& grayscale_image, LandmarkDetector::CLNF& face_model, int face_detector)
+{
+	if (face_detector == LandmarkDetector::FaceModelParameters::HOG_SVM_DETECTOR)
+	{
+		std::vector<float> confidences;
+		LandmarkDetector::DetectFacesHOG(face_detections, grayscale_image, face_model.face_detector_HOG, confidences);
+	}
+	else if (face_detector == LandmarkDetector::FaceModelParameters::HAAR_DETECTOR)
+	{
+		LandmarkDetector::DetectFaces(face_detections, grayscale_image, face_model.face_detector_HAAR);
+	}
+	else
+	{
+		std::vector<float> confidences;
+		LandmarkDetector::DetectFacesMTCNN(face_detections, rgb_image, face_model.face_detector_MTCNN, confidences);
+	}
+}
+
 int main(int argc, char **argv)
 {
 
@@ -145,6 +164,10 @@ int main(int argc, char **argv)
 	}
 
 	LandmarkDetector::FaceModelParameters det_params(arguments);
+
+	// The threads used by landmark detection
+	LandmarkDetector::TaskScheduler::Configure(det_params.num_threads, det_params.first_core);
+
 	// This is so that the model would not try re-initialising itself
 	det_params.reinit_video_every = -1;
 
@@ -202,6 +225,9 @@ int main(int argc, char **argv)
 		std::cout << "WARNING: no eye model found" << std::endl;
 	}
 
+	// The eye models are only fit as part of the hierarchical refinement, without it there are no eye landmarks or gaze
+	bool track_eyes = face_model.eye_model && det_params.refine_hierarchical;
+
 	if (face_analyser.GetAUClassNames().size() == 0 && face_analyser.GetAUClassNames().size() == 0)
 	{
 		std::cout << "WARNING: no Action Unit models found" << std::endl;
@@ -218,6 +244,11 @@ int main(int argc, char **argv)
 	fps_tracker.AddFrame();
 
 	int sequence_number = 0;
+
+	// With -async_detect the face detection runs in the background on a copy of the frame (using the detectors of face_model, which is not tracking),
+	// and its detections are used on the first frame after it is done
+	std::shared_future<void> face_detection;
+	std::vector<cv::Rect_<float> > background_detections;
 	
 	
 	while (true) // this is not a for loop as we might also be reading from a webcam
@@ -235,7 +266,7 @@ int main(int argc, char **argv)
 		Utilities::RecorderOpenFaceParameters recording_params(arguments, true, sequence_reader.IsWebcam(),
 			sequence_reader.fx, sequence_reader.fy, sequence_reader.cx, sequence_reader.cy, sequence_reader.fps);
 
-		if (!face_model.eye_model)
+		if (!track_eyes)
 		{
 			recording_params.setOutputGaze(false);
 		}
@@ -275,23 +306,28 @@ int main(int argc, char **argv)
 			}
 
 			// Get the detections (every 8th frame and when there are free models available for tracking)
-			if (frame_count % 8 == 0 && !all_models_active)
+			bool detection_due = frame_count % 8 == 0 && !all_models_active;
+			int face_detector = det_parameters[0].curr_face_detector;
+			if (det_parameters[0].async_face_detection)
 			{
-				if (det_parameters[0].curr_face_detector == LandmarkDetector::FaceModelParameters::HOG_SVM_DETECTOR)
-				{
-					std::vector<float> confidences;
-					LandmarkDetector::DetectFacesHOG(face_detections, grayscale_image, face_models[0].face_detector_HOG, confidences);
-				}
-				else if (det_parameters[0].curr_face_detector == LandmarkDetector::FaceModelParameters::HAAR_DETECTOR)
+				if (detection_due && !face_detection.valid())
 				{
-					LandmarkDetector::DetectFaces(face_detections, grayscale_image, face_models[0].face_detector_HAAR);
+					cv::Mat rgb_copy = rgb_image.clone();
+					cv::Mat_<uchar> grayscale_copy = grayscale_image.clone();
+					face_detection = LandmarkDetector::TaskScheduler::Async([&background_detections, &face_model, rgb_copy, grayscale_copy, face_detector]() {
+						DetectFacesInFrame(background_detections, rgb_copy, grayscale_copy, face_model, face_detector);
+					}, true);
 				}
-				else
+
+				if (face_detection.valid() && LandmarkDetector::TaskScheduler::Done(face_detection))
 				{
-					std::vector<float> confidences;
-					LandmarkDetector::DetectFacesMTCNN(face_detections, rgb_image, face_models[0].face_detector_MTCNN, confidences);
+					face_detections.swap(background_detections);
+					face_detection = std::shared_future<void>();
 				}
-
+			}
+			else if (detection_due)
+			{
+				DetectFacesInFrame(face_detections, rgb_image, grayscale_image, face_models[0], face_detector);
 			}
 
 			// Keep only non overlapping detections (so as not to start tracking where the face is already tracked)
@@ -301,9 +337,6 @@ int main(int argc, char **argv)
 			// Go through every model and update the tracking
 			for (unsigned int model = 0; model < face_models.size(); ++model)
 			{
-
-				bool detection_success = false;
-
 				// If the current model has failed more than 4 times in a row, remove it
 				if (face_models[model].failures_in_a_row > 4)
 				{
@@ -327,7 +360,11 @@ int main(int argc, char **argv)
 
 							// This ensures that a wider window is used for the initial landmark localisation
 							face_models[model].detection_success = false;
-							detection_success = LandmarkDetector::DetectLandmarksInVideo(rgb_image, face_detections[detection_ind], face_models[model], det_parameters[model], grayscale_image);
+
+							// Start tracking from the detected bounding box
+							face_models[model].params_local.setTo(0);
+							face_models[model].pdm.CalcParams(face_models[model].params_global, face_detections[detection_ind], face_models[model].params_local);
+							face_models[model].tracking_initialised = true;
 
 							// This activates the model
 							active_models[model] = true;
@@ -338,13 +375,11 @@ int main(int argc, char **argv)
 
 					}
 				}
-				else
-				{
-					// The actual facial landmark detection / tracking
-					detection_success = LandmarkDetector::DetectLandmarksInVideo(rgb_image, face_models[model], det_parameters[model], grayscale_image);
-				}
 			}
 
+			// The actual facial landmark detection / tracking, all of the active models are fit together
+			LandmarkDetector::DetectLandmarksInVideo(rgb_image, face_models, active_models, det_parameters, grayscale_image);
+
 			// Remove models that end up tracking overlapping faces
 			// even if initial bounding boxes were not overlapping, they could have ended up converging to the same face
 			RemoveOverlapingModels(face_models, active_models);
@@ -352,7 +387,12 @@ int main(int argc, char **argv)
 			// Keeping track of FPS
 			fps_tracker.AddFrame();
 
-			visualizer.SetImage(rgb_image, sequence_reader.fx, sequence_reader.fy, sequence_reader.cx, sequence_reader.cy);
+			// The visualization is only built if it is shown or recorded
+			bool visualize = visualizer.IsVisualizing() || recording_params.outputTracked();
+			if (visualize)
+			{
+				visualizer.SetImage(rgb_image, sequence_reader.fx, sequence_reader.fy, sequence_reader.cx, sequence_reader.cy);
+			}
 
 			// Go through every model and detect eye gaze, record results and visualise the results
 			for (size_t model = 0; model < face_models.size(); ++model)
@@ -360,18 +400,24 @@ int main(int argc, char **argv)
 				// Visualising and recording the results
 				if (active_models[model])
 				{
+					// Incorporate the eye models if they are refined in the background (they are refined while the overlapping models are removed)
+					face_models[model].FinishHierarchicalRefinement();
+
+					// Pose, 3D landmarks, eye landmarks and gaze are computed once and shared by the analysis, visualization and output
+					LandmarkDetector::FaceFrameResult face_result(face_models[model], sequence_reader.fx, sequence_reader.fy, sequence_reader.cx, sequence_reader.cy);
 
 					// Estimate head pose and eye gaze				
-					cv::Vec6d pose_estimate = LandmarkDetector::GetPose(face_models[model], sequence_reader.fx, sequence_reader.fy, sequence_reader.cx, sequence_reader.cy);
+					cv::Vec6d pose_estimate = face_result.GetPose();
 
 					cv::Point3f gaze_direction0(0, 0, 0); cv::Point3f gaze_direction1(0, 0, 0); cv::Vec2d gaze_angle(0, 0);
 
 					// Detect eye gazes
-					if (face_models[model].detection_success && face_model.eye_model)
+					if (face_models[model].detection_success && track_eyes)
 					{
-						GazeAnalysis::EstimateGaze(face_models[model], gaze_direction0, sequence_reader.fx, sequence_reader.fy, sequence_reader.cx, sequence_reader.cy, true);
-						GazeAnalysis::EstimateGaze(face_models[model], gaze_direction1, sequence_reader.fx, sequence_reader.fy, sequence_reader.cx, sequence_reader.cy, false);
-						gaze_angle = GazeAnalysis::GetGazeAngle(gaze_direction0, gaze_direction1);
+						GazeAnalysis::EstimateGaze(face_result);
+						gaze_direction0 = face_result.GetGazeDirection0();
+						gaze_direction1 = face_result.GetGazeDirection1();
+						gaze_angle = face_result.GetGazeAngle();
 					}
 
 					// Face analysis step
@@ -387,20 +433,29 @@ int main(int argc, char **argv)
 					}
 
 					// Visualize the features
-					visualizer.SetObservationFaceAlign(sim_warped_img);
-					visualizer.SetObservationHOG(hog_descriptor, num_hog_rows, num_hog_cols);
-					visualizer.SetObservationLandmarks(face_models[model].detected_landmarks, face_models[model].detection_certainty);
-					visualizer.SetObservationPose(LandmarkDetector::GetPose(face_models[model], sequence_reader.fx, sequence_reader.fy, sequence_reader.cx, sequence_reader.cy), face_models[model].detection_certainty);
-					visualizer.SetObservationGaze(gaze_direction0, gaze_direction1, LandmarkDetector::CalculateAllEyeLandmarks(face_models[model]), LandmarkDetector::Calculate3DEyeLandmarks(face_models[model], sequence_reader.fx, sequence_reader.fy, sequence_reader.cx, sequence_reader.cy), face_models[model].detection_certainty);
-					visualizer.SetObservationActionUnits(face_analyser.GetCurrentAUsReg(), face_analyser.GetCurrentAUsClass());
+					if (visualize)
+					{
+						visualizer.SetObservationFaceAlign(sim_warped_img);
+						visualizer.SetObservationHOG(hog_descriptor, num_hog_rows, num_hog_cols);
+						visualizer.SetObservationLandmarks(face_models[model].detected_landmarks, face_models[model].detection_certainty);
+						visualizer.SetObservationPose(face_result.GetPose(), face_models[model].detection_certainty);
+						if (track_eyes)
+						{
+							visualizer.SetObservationGaze(gaze_direction0, gaze_direction1, face_result.GetEyeLandmarks2D(), face_result.GetEyeLandmarks3D(), face_models[model].detection_certainty);
+						}
+						visualizer.SetObservationActionUnits(face_analyser.GetCurrentAUsReg(), face_analyser.GetCurrentAUsClass());
+					}
 
 					// Output features
 					open_face_rec.SetObservationHOG(face_models[model].detection_success, hog_descriptor, num_hog_rows, num_hog_cols, 31); // The number of channels in HOG is fixed at the moment, as using FHOG
 					open_face_rec.SetObservationActionUnits(face_analyser.GetCurrentAUsReg(), face_analyser.GetCurrentAUsClass());
-					open_face_rec.SetObservationLandmarks(face_models[model].detected_landmarks, face_models[model].GetShape(sequence_reader.fx, sequence_reader.fy, sequence_reader.cx, sequence_reader.cy),
+					open_face_rec.SetObservationLandmarks(face_models[model].detected_landmarks, face_result.GetShape3D(),
 						face_models[model].params_global, face_models[model].params_local, face_models[model].detection_certainty, face_models[model].detection_success);
 					open_face_rec.SetObservationPose(pose_estimate);
-					open_face_rec.SetObservationGaze(gaze_direction0, gaze_direction1, gaze_angle, LandmarkDetector::CalculateAllEyeLandmarks(face_models[model]), LandmarkDetector::Calculate3DEyeLandmarks(face_models[model], sequence_reader.fx, sequence_reader.fy, sequence_reader.cx, sequence_reader.cy));
+					if (track_eyes)
+					{
+						open_face_rec.SetObservationGaze(gaze_direction0, gaze_direction1, gaze_angle, face_result.GetEyeLandmarks2D(), face_result.GetEyeLandmarks3D());
+					}
 					open_face_rec.SetObservationFaceAlign(sim_warped_img);
 					open_face_rec.SetObservationFaceID(model);
 					open_face_rec.SetObservationTimestamp(sequence_reader.time_stamp);
@@ -410,11 +465,17 @@ int main(int argc, char **argv)
 				}
 			}
 
-			visualizer.SetFps(fps_tracker.GetFPS());
+			if (visualize)
+			{
+				visualizer.SetFps(fps_tracker.GetFPS());
+			}
 
 			// Record frame
-			open_face_rec.SetObservationVisualization(visualizer.GetVisImage());
-			open_face_rec.WriteObservationTracked();
+			if (recording_params.outputTracked())
+			{
+				open_face_rec.SetObservationVisualization(visualizer.GetVisImage());
+				open_face_rec.WriteObservationTracked();
+			}
 
 			// show visualization and detect key presses
 			char character_press = visualizer.ShowObservation();
@@ -431,6 +492,7 @@ int main(int argc, char **argv)
 			// quit the application
 			else if (character_press == 'q')
 			{
+				LandmarkDetector::TaskScheduler::Wait(face_detection);
 				return 0;
 			}
 
@@ -455,6 +517,11 @@ int main(int argc, char **argv)
 
 		frame_count = 0;
 
+		// A detection from this video is of no use for the next one
+		LandmarkDetector::TaskScheduler::Wait(face_detection);
+		face_detection = std::shared_future<void>();
+		background_detections.clear();
+
 		// Reset the model, for the next video
 		for (size_t model = 0; model < face_models.size(); ++model)
 		{
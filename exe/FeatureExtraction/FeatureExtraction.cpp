@@ -47,6 +47,10 @@
 #include <Visualizer.h>
 #include <VisualizationUtils.h>
 
+#include <thread>
+#include <memory>
+#include <sstream>
+
 #ifndef CONFIG_DIR
 #define CONFIG_DIR "~"
 #endif
@@ -81,11 +85,161 @@ std::vector<std::string> get_arguments(int argc, char **argv)
 	return arguments;
 }
 
+// Replacing the AU columns of the columnar output with the post-processed predictions (the CSV file is post-processed by the analyser itself)
+void PostprocessColumnarFile(FaceAnalysis::FaceAnalyser& face_analyser, const std::string& columnar_file, bool dynamic)
+{
+	std::vector<double> certainties;
+	std::vector<bool> successes;
+	std::vector<double> timestamps;
+	std::vector<std::pair<std::string, std::vector<double>>> predictions_reg;
+	std::vector<std::pair<std::string, std::vector<double>>> predictions_class;
+
+	face_analyser.ExtractAllPredictionsOfflineReg(predictions_reg, certainties, successes, timestamps, dynamic);
+	face_analyser.ExtractAllPredictionsOfflineClass(predictions_class, certainties, successes, timestamps, dynamic);
+
+	// A column that cannot be overwritten (e.g. the number of rows does not match the predictions) keeps the values before post-processing
+	for (auto& au : predictions_reg)
+	{
+		if (!Utilities::RecorderColumnar::OverwriteColumn(columnar_file, au.first + "_r", std::vector<float>(au.second.begin(), au.second.end())))
+		{
+			ERROR_STREAM("Could not write the post-processed " << au.first << "_r values to " << columnar_file << ", it keeps the values before post-processing");
+		}
+	}
+	for (auto& au : predictions_class)
+	{
+		if (!Utilities::RecorderColumnar::OverwriteColumn(columnar_file, au.first + "_c", std::vector<float>(au.second.begin(), au.second.end())))
+		{
+			ERROR_STREAM("Could not write the post-processed " << au.first << "_c values to " << columnar_file << ", it keeps the values before post-processing");
+		}
+	}
+}
+
+// Tracking and analysing the frames [start_frame, end_frame) of a video file (end_frame < 0 for until the end of the video, used when processing a long video in several segments in parallel),
+// the frames from warm_up_frame onwards are tracked to initialise the landmark detector, but only the segment frames are analysed and recorded
+void ProcessVideoSegment(const std::string& video_file, int warm_up_frame, int start_frame, int end_frame, int frame_stride, float fx, float fy, float cx, float cy,
+	LandmarkDetector::CLNF& face_model, LandmarkDetector::FaceModelParameters det_parameters, FaceAnalysis::FaceAnalyser& face_analyser,
+	Utilities::RecorderOpenFace& open_face_rec, const Utilities::RecorderOpenFaceParameters& recording_params)
+{
+	Utilities::SequenceCapture sequence_reader;
+	sequence_reader.frame_stride = frame_stride;
+
+	if (!sequence_reader.OpenVideoFileSegment(video_file, warm_up_frame, end_frame, fx, fy, cx, cy))
+	{
+		ERROR_STREAM("Could not open the video segment starting at frame " << start_frame);
+		return;
+	}
+
+	// The eye models are only fit as part of the hierarchical refinement
+	bool track_eyes = face_model.eye_model && det_parameters.refine_hierarchical;
+
+	cv::Mat captured_image = sequence_reader.GetNextFrame();
+
+	while (!captured_image.empty())
+	{
+		cv::Mat_<uchar> grayscale_image = sequence_reader.GetGrayFrame();
+
+		bool detection_success = LandmarkDetector::DetectLandmarksInVideo(captured_image, face_model, det_parameters, grayscale_image);
+
+		// Frames before the segment are only used for getting the tracking going
+		if (sequence_reader.GetFrameNumber() <= (size_t)start_frame)
+		{
+			captured_image = sequence_reader.GetNextFrame();
+			continue;
+		}
+
+		// Incorporating the hierarchical models moves all of the landmarks, so it has to be done before they are used for the face alignment
+		face_model.FinishHierarchicalRefinement();
+
+		cv::Mat sim_warped_img;
+		cv::Mat_<double> hog_descriptor; int num_hog_rows = 0, num_hog_cols = 0;
+
+		if (recording_params.outputAlignedFaces() || recording_params.outputHOG() || recording_params.outputAUs())
+		{
+			face_analyser.AddNextFrame(captured_image, face_model.detected_landmarks, face_model.detection_success, sequence_reader.time_stamp, false);
+			face_analyser.GetLatestAlignedFace(sim_warped_img);
+			face_analyser.GetLatestHOG(hog_descriptor, num_hog_rows, num_hog_cols);
+		}
+
+		// Pose, 3D landmarks, eye landmarks and gaze are computed once and shared by the analysis, visualization and output
+		LandmarkDetector::FaceFrameResult face_result(face_model, sequence_reader.fx, sequence_reader.fy, sequence_reader.cx, sequence_reader.cy);
+
+		cv::Point3f gazeDirection0(0, 0, 0); cv::Point3f gazeDirection1(0, 0, 0); cv::Vec2d gazeAngle(0, 0);
+
+		if (detection_success && track_eyes)
+		{
+			GazeAnalysis::EstimateGaze(face_result);
+			gazeDirection0 = face_result.GetGazeDirection0();
+			gazeDirection1 = face_result.GetGazeDirection1();
+			gazeAngle = face_result.GetGazeAngle();
+		}
+
+		cv::Vec6d pose_estimate = face_result.GetPose();
+
+		open_face_rec.SetObservationHOG(detection_success, hog_descriptor, num_hog_rows, num_hog_cols, 31);
+		open_face_rec.SetObservationActionUnits(face_analyser.GetCurrentAUsReg(), face_analyser.GetCurrentAUsClass());
+		open_face_rec.SetObservationLandmarks(face_model.detected_landmarks, face_result.GetShape3D(),
+			face_model.params_global, face_model.params_local, face_model.detection_certainty, detection_success);
+		open_face_rec.SetObservationPose(pose_estimate);
+		if (track_eyes)
+		{
+			open_face_rec.SetObservationGaze(gazeDirection0, gazeDirection1, gazeAngle, face_result.GetEyeLandmarks2D(), face_result.GetEyeLandmarks3D());
+		}
+		open_face_rec.SetObservationTimestamp(sequence_reader.time_stamp);
+		open_face_rec.SetObservationFaceID(0);
+		open_face_rec.SetObservationFrameNumber(sequence_reader.GetFrameNumber());
+		open_face_rec.SetObservationFaceAlign(sim_warped_img);
+		open_face_rec.WriteObservation();
+
+		captured_image = sequence_reader.GetNextFrame();
+	}
+
+	open_face_rec.Close();
+	sequence_reader.Close();
+}
+
 int main(int argc, char **argv)
 {
 
 	std::vector<std::string> arguments = get_arguments(argc, argv);
 
+	// Long videos can be split into several segments that are processed in parallel, each segment is preceded by a number of
+	// (processed) frames that are only tracked to initialise the landmark detector
+	int num_segments = 1;
+	int segment_overlap = 30;
+	for (size_t i = 0; i + 1 < arguments.size(); ++i)
+	{
+		if (arguments[i].compare("-segments") == 0)
+		{
+			std::stringstream data(arguments[i + 1]);
+			int segments = 0;
+			data >> segments;
+
+			if (segments >= 1)
+			{
+				num_segments = segments;
+			}
+			else
+			{
+				WARN_STREAM("Ignoring -segments " << arguments[i + 1] << ", the number of segments should be at least 1");
+			}
+		}
+		else if (arguments[i].compare("-segment_overlap") == 0)
+		{
+			std::stringstream data(arguments[i + 1]);
+			int overlap = -1;
+			data >> overlap;
+
+			if (overlap >= 0)
+			{
+				segment_overlap = overlap;
+			}
+			else
+			{
+				WARN_STREAM("Ignoring -segment_overlap " << arguments[i + 1] << ", the overlap should be a non-negative number of frames");
+			}
+		}
+	}
+
 	// no arguments: output usage
 	if (arguments.size() == 1)
 	{
@@ -97,6 +251,10 @@ int main(int argc, char **argv)
 	// Load the modules that are being used for tracking and face analysis
 	// Load face landmark detector
 	LandmarkDetector::FaceModelParameters det_parameters(arguments);
+
+	// The threads used by landmark detection
+	LandmarkDetector::TaskScheduler::Configure(det_parameters.num_threads, det_parameters.first_core);
+
 	// Always track gaze in feature extraction
 	LandmarkDetector::CLNF face_model(det_parameters.model_location);
 
@@ -115,6 +273,9 @@ int main(int argc, char **argv)
 		std::cout << "WARNING: no eye model found" << std::endl;
 	}
 
+	// The eye models are only fit as part of the hierarchical refinement, without it there are no eye landmarks or gaze
+	bool track_eyes = face_model.eye_model && det_parameters.refine_hierarchical;
+
 	if (face_analyser.GetAUClassNames().size() == 0 && face_analyser.GetAUClassNames().size() == 0)
 	{
 		std::cout << "WARNING: no Action Unit models found" << std::endl;
@@ -138,6 +299,9 @@ int main(int argc, char **argv)
 
 		INFO_STREAM("Device or file opened");
 
+		// If frames are being skipped the tracker needs to account for larger motion between frames
+		det_parameters.frame_stride = sequence_reader.GetFrameStride();
+
 		if (sequence_reader.IsWebcam())
 		{
 			INFO_STREAM("WARNING: using a webcam in feature extraction, Action Unit predictions will not be as accurate in real-time webcam mode");
@@ -147,17 +311,103 @@ int main(int argc, char **argv)
 
 		cv::Mat captured_image;
 
+		// The tracked video is written at the rate frames are actually processed at
 		Utilities::RecorderOpenFaceParameters recording_params(arguments, true, sequence_reader.IsWebcam(),
-			sequence_reader.fx, sequence_reader.fy, sequence_reader.cx, sequence_reader.cy, sequence_reader.fps);
-		if (!face_model.eye_model)
+			sequence_reader.fx, sequence_reader.fy, sequence_reader.cx, sequence_reader.cy, sequence_reader.fps / sequence_reader.GetFrameStride());
+		if (!track_eyes)
 		{
 			recording_params.setOutputGaze(false);
 		}
+
+		// The AUs are post-processed once the whole video was analysed, so they are written in a layout that allows overwriting them in place
+		recording_params.setPostprocessAUs(true);
 		Utilities::RecorderOpenFace open_face_rec(sequence_reader.name, recording_params, arguments);
 
 		if (recording_params.outputGaze() && !face_model.eye_model)
 			std::cout << "WARNING: no eye model defined, but outputting gaze" << std::endl;
 
+		// Splitting a video file into segments processed in parallel (each with its own tracker, analyser, and recorder), the results are merged in order afterwards
+		int num_processed_frames = (int)((sequence_reader.GetNumberOfFrames() + sequence_reader.GetFrameStride() - 1) / sequence_reader.GetFrameStride());
+		if (num_segments > 1 && !sequence_reader.IsWebcam() && !sequence_reader.IsImageSequence() && num_processed_frames >= num_segments)
+		{
+			if (recording_params.outputTracked() || visualizer.vis_track || visualizer.vis_align || visualizer.vis_hog || visualizer.vis_aus)
+			{
+				WARN_STREAM("Visualization and tracked video output are not supported when processing a video in segments");
+			}
+
+			// The frames are read by the segments themselves
+			std::string video_file = sequence_reader.name;
+			int frame_stride = sequence_reader.GetFrameStride();
+			sequence_reader.Close();
+
+			INFO_STREAM("Processing the video in " << num_segments << " segments");
+
+			std::vector<LandmarkDetector::CLNF> segment_models(num_segments, face_model);
+			std::vector<std::unique_ptr<FaceAnalysis::FaceAnalyser> > segment_analysers(num_segments);
+			std::vector<std::unique_ptr<Utilities::RecorderOpenFace> > segment_recorders(num_segments);
+			std::vector<std::thread> segment_threads;
+
+			for (int s = 0; s < num_segments; ++s)
+			{
+				// Segment boundaries are placed on the processed frames so that a stride is respected across segments
+				int start_frame = (int)(((long long)num_processed_frames * s) / num_segments) * frame_stride;
+				int end_frame = (int)(((long long)num_processed_frames * (s + 1)) / num_segments) * frame_stride;
+
+				// The frame count of a container is not always reliable (e.g. variable frame rate), so the last segment reads until the video ends
+				if (s == num_segments - 1)
+				{
+					end_frame = -1;
+				}
+				int warm_up_frame = std::max(0, start_frame - segment_overlap * frame_stride);
+
+				// Each segment writes to its own temporary output next to the final one
+				char segment_name[100];
+				std::sprintf(segment_name, "_segment_%03d.csv", s);
+				std::string output_dir = open_face_rec.GetOutputDirectory();
+				if (!output_dir.empty() && output_dir.back() != '/' && output_dir.back() != '\\')
+				{
+					output_dir += "/";
+				}
+				std::vector<std::string> segment_arguments;
+				segment_arguments.push_back("-of");
+				segment_arguments.push_back(output_dir + open_face_rec.GetOutputName() + segment_name);
+
+				segment_analysers[s].reset(new FaceAnalysis::FaceAnalyser(face_analysis_params));
+				segment_recorders[s].reset(new Utilities::RecorderOpenFace(video_file, recording_params, segment_arguments));
+
+				segment_threads.push_back(std::thread(ProcessVideoSegment, video_file, warm_up_frame, start_frame, end_frame, frame_stride,
+					sequence_reader.fx, sequence_reader.fy, sequence_reader.cx, sequence_reader.cy, std::ref(segment_models[s]), det_parameters,
+					std::ref(*segment_analysers[s]), std::ref(*segment_recorders[s]), std::cref(recording_params)));
+			}
+
+			for (size_t s = 0; s < segment_threads.size(); ++s)
+			{
+				segment_threads[s].join();
+			}
+
+			INFO_STREAM("Merging the segment outputs");
+			open_face_rec.Close();
+			for (int s = 0; s < num_segments; ++s)
+			{
+				open_face_rec.MergeRecording(*segment_recorders[s]);
+				face_analyser.AppendPredictionHistory(*segment_analysers[s]);
+			}
+
+			if (recording_params.outputAUs())
+			{
+				INFO_STREAM("Postprocessing the Action Unit predictions");
+				face_analyser.PostprocessOutputFile(open_face_rec.GetCSVFile());
+				if (recording_params.outputColumnar())
+				{
+					PostprocessColumnarFile(face_analyser, open_face_rec.GetColumnarFile(), face_analysis_params.getDynamic());
+				}
+			}
+
+			face_analyser.Reset();
+			face_model.Reset();
+			continue;
+		}
+
 		captured_image = sequence_reader.GetNextFrame();
 
 		// For reporting progress
@@ -172,16 +422,10 @@ int main(int argc, char **argv)
 
 			// The actual facial landmark detection / tracking
 			bool detection_success = LandmarkDetector::DetectLandmarksInVideo(captured_image, face_model, det_parameters, grayscale_image);
-			
-			// Gaze tracking, absolute gaze direction
-			cv::Point3f gazeDirection0(0, 0, 0); cv::Point3f gazeDirection1(0, 0, 0); cv::Vec2d gazeAngle(0, 0);
 
-			if (detection_success && face_model.eye_model)
-			{
-				GazeAnalysis::EstimateGaze(face_model, gazeDirection0, sequence_reader.fx, sequence_reader.fy, sequence_reader.cx, sequence_reader.cy, true);
-				GazeAnalysis::EstimateGaze(face_model, gazeDirection1, sequence_reader.fx, sequence_reader.fy, sequence_reader.cx, sequence_reader.cy, false);
-				gazeAngle = GazeAnalysis::GetGazeAngle(gazeDirection0, gazeDirection1);
-			}
+			// Incorporate the hierarchical models if they are refined in the background, this moves all of the landmarks so it has to be done
+			// before they are used for the face alignment
+			face_model.FinishHierarchicalRefinement();
 			
 			// Do face alignment
 			cv::Mat sim_warped_img;
@@ -194,22 +438,42 @@ int main(int argc, char **argv)
 				face_analyser.GetLatestAlignedFace(sim_warped_img);
 				face_analyser.GetLatestHOG(hog_descriptor, num_hog_rows, num_hog_cols);
 			}
+
+			// Pose, 3D landmarks, eye landmarks and gaze are computed once and shared by the analysis, visualization and output
+			LandmarkDetector::FaceFrameResult face_result(face_model, sequence_reader.fx, sequence_reader.fy, sequence_reader.cx, sequence_reader.cy);
+
+			// Gaze tracking, absolute gaze direction
+			cv::Point3f gazeDirection0(0, 0, 0); cv::Point3f gazeDirection1(0, 0, 0); cv::Vec2d gazeAngle(0, 0);
+
+			if (detection_success && track_eyes)
+			{
+				GazeAnalysis::EstimateGaze(face_result);
+				gazeDirection0 = face_result.GetGazeDirection0();
+				gazeDirection1 = face_result.GetGazeDirection1();
+				gazeAngle = face_result.GetGazeAngle();
+			}
 			
 			// Work out the pose of the head from the tracked model
-			cv::Vec6d pose_estimate = LandmarkDetector::GetPose(face_model, sequence_reader.fx, sequence_reader.fy, sequence_reader.cx, sequence_reader.cy);
+			cv::Vec6d pose_estimate = face_result.GetPose();
 
 			// Keeping track of FPS
 			fps_tracker.AddFrame();
 
-			// Displaying the tracking visualizations
-			visualizer.SetImage(captured_image, sequence_reader.fx, sequence_reader.fy, sequence_reader.cx, sequence_reader.cy);
-			visualizer.SetObservationFaceAlign(sim_warped_img);
-			visualizer.SetObservationHOG(hog_descriptor, num_hog_rows, num_hog_cols);
-			visualizer.SetObservationLandmarks(face_model.detected_landmarks, face_model.detection_certainty, face_model.GetVisibilities());
-			visualizer.SetObservationPose(pose_estimate, face_model.detection_certainty);
-			visualizer.SetObservationGaze(gazeDirection0, gazeDirection1, LandmarkDetector::CalculateAllEyeLandmarks(face_model), LandmarkDetector::Calculate3DEyeLandmarks(face_model, sequence_reader.fx, sequence_reader.fy, sequence_reader.cx, sequence_reader.cy), face_model.detection_certainty);
-			visualizer.SetObservationActionUnits(face_analyser.GetCurrentAUsReg(), face_analyser.GetCurrentAUsClass());
-			visualizer.SetFps(fps_tracker.GetFPS());
+			// Displaying the tracking visualizations (only if they are shown or recorded)
+			if (visualizer.IsVisualizing() || recording_params.outputTracked())
+			{
+				visualizer.SetImage(captured_image, sequence_reader.fx, sequence_reader.fy, sequence_reader.cx, sequence_reader.cy);
+				visualizer.SetObservationFaceAlign(sim_warped_img);
+				visualizer.SetObservationHOG(hog_descriptor, num_hog_rows, num_hog_cols);
+				visualizer.SetObservationLandmarks(face_model.detected_landmarks, face_model.detection_certainty, face_model.GetVisibilities());
+				visualizer.SetObservationPose(pose_estimate, face_model.detection_certainty);
+				if (track_eyes)
+				{
+					visualizer.SetObservationGaze(gazeDirection0, gazeDirection1, face_result.GetEyeLandmarks2D(), face_result.GetEyeLandmarks3D(), face_model.detection_certainty);
+				}
+				visualizer.SetObservationActionUnits(face_analyser.GetCurrentAUsReg(), face_analyser.GetCurrentAUsClass());
+				visualizer.SetFps(fps_tracker.GetFPS());
+			}
 
 			// detect key presses
 			char character_press = visualizer.ShowObservation();
@@ -222,12 +486,18 @@ int main(int argc, char **argv)
 
 			// Setting up the recorder output
 			open_face_rec.SetObservationHOG(detection_success, hog_descriptor, num_hog_rows, num_hog_cols, 31); // The number of channels in HOG is fixed at the moment, as using FHOG
-			open_face_rec.SetObservationVisualization(visualizer.GetVisImage());
+			if (recording_params.outputTracked())
+			{
+				open_face_rec.SetObservationVisualization(visualizer.GetVisImage());
+			}
 			open_face_rec.SetObservationActionUnits(face_analyser.GetCurrentAUsReg(), face_analyser.GetCurrentAUsClass());
-			open_face_rec.SetObservationLandmarks(face_model.detected_landmarks, face_model.GetShape(sequence_reader.fx, sequence_reader.fy, sequence_reader.cx, sequence_reader.cy),
+			open_face_rec.SetObservationLandmarks(face_model.detected_landmarks, face_result.GetShape3D(),
 				face_model.params_global, face_model.params_local, face_model.detection_certainty, detection_success);
 			open_face_rec.SetObservationPose(pose_estimate);
-			open_face_rec.SetObservationGaze(gazeDirection0, gazeDirection1, gazeAngle, LandmarkDetector::CalculateAllEyeLandmarks(face_model), LandmarkDetector::Calculate3DEyeLandmarks(face_model, sequence_reader.fx, sequence_reader.fy, sequence_reader.cx, sequence_reader.cy));
+			if (track_eyes)
+			{
+				open_face_rec.SetObservationGaze(gazeDirection0, gazeDirection1, gazeAngle, face_result.GetEyeLandmarks2D(), face_result.GetEyeLandmarks3D());
+			}
 			open_face_rec.SetObservationTimestamp(sequence_reader.time_stamp);
 			open_face_rec.SetObservationFaceID(0);
 			open_face_rec.SetObservationFrameNumber(sequence_reader.GetFrameNumber());
@@ -251,6 +521,13 @@ int main(int argc, char **argv)
 
 		}
 
+		if (det_parameters.validation_interval > 1 || det_parameters.validation_skip_lhood_drop > 0)
+		{
+			const LandmarkDetector::ValidationStatistics& validation = face_model.validation_statistics;
+			INFO_STREAM("Detection validation skipped on " << validation.validations_skipped << " of " << validation.validations_run + validation.validations_skipped
+				<< " frames, " << validation.validations_triggered << " validations triggered early");
+		}
+
 		INFO_STREAM("Closing output recorder");
 		open_face_rec.Close();
 		INFO_STREAM("Closing input reader");
@@ -261,11 +538,16 @@ int main(int argc, char **argv)
 		{
 			INFO_STREAM("Postprocessing the Action Unit predictions");
 			face_analyser.PostprocessOutputFile(open_face_rec.GetCSVFile());
+			if (recording_params.outputColumnar())
+			{
+				PostprocessColumnarFile(face_analyser, open_face_rec.GetColumnarFile(), face_analysis_params.getDynamic());
+			}
 		}
 
 		// Reset the models for the next video
 		face_analyser.Reset();
 		face_model.Reset();
+		face_model.validation_statistics = LandmarkDetector::ValidationStatistics();
 
 	}
 
@@ -48,6 +48,7 @@
 #include "SVR_static_lin_regressors.h"
 #include "SVM_static_lin.h"
 #include "SVM_dynamic_lin.h"
+#include "Fused_lin_predictors.h"
 #include "PDM.h"
 #include "FaceAnalyserParameters.h"
 
@@ -104,6 +105,10 @@ public:
 	// Helper function for post-processing AU output files
 	void PostprocessOutputFile(std::string output_file);
 
+	// Appending the AU prediction history of an analyser that processed a later part of the same sequence (e.g. when processing a video in segments),
+	// so that the offline post-processing covers the whole sequence
+	void AppendPredictionHistory(FaceAnalyser& other);
+
 private:
 
 	// Point distribution model coddesponding to the current Face Analyser
@@ -170,9 +175,8 @@ private:
 	// Using the bounding box of previous analysed frame to determine if a reset is needed
 	cv::Rect_<double> face_bounding_box;
 	
-	// The AU predictions internally
-	std::vector<std::pair<std::string, double>> PredictCurrentAUs(int view);
-	std::vector<std::pair<std::string, double>> PredictCurrentAUsClass(int view);
+	// The AU predictions internally (intensity and presence are predicted together)
+	void PredictCurrentAUs(int view, std::vector<std::pair<std::string, double>>& predictions_reg, std::vector<std::pair<std::string, double>>& predictions_class);
 
 	// special step for online (rather than offline AU prediction)
 	std::vector<std::pair<std::string, double>> CorrectOnlineAUs(std::vector<std::pair<std::string, double>> predictions_orig, int view, bool dyn_shift = false, bool dyn_scale = false, bool update_track = true, bool clip_values = false);
@@ -197,6 +201,12 @@ private:
 	SVM_static_lin AU_SVM_static_appearance_lin;
 	SVM_dynamic_lin AU_SVM_dynamic_appearance_lin;
 
+	// All of the above combined for faster prediction
+	Fused_lin_predictors AU_lin_predictors;
+
+	// The current descriptor projected on the combined predictors
+	cv::Mat_<float> projected_descriptor_frame;
+
 	// The AUs predicted by the model are not always 0 calibrated to a person. That is they don't always predict 0 for a neutral expression
 	// Keeping track of the predictions we can correct for this, by assuming that at least "ratio" of frames are neutral and subtract that value of prediction, only perform the correction after min_frames
 	void UpdatePredictionTrack(cv::Mat_<int>& prediction_corr_histogram, int& prediction_correction_count, 
@@ -231,10 +241,10 @@ private:
 	int align_width_out;
 	int align_height_out;
 
-	// Useful placeholder for renormalizing the initial frames of shorter videos
+	// Useful placeholder for renormalizing the initial frames of shorter videos, only the descriptors projected on the
+	// linear predictors are kept (a value per AU rather than the full HOG descriptor)
 	int max_init_frames = 3000;
-	std::vector<cv::Mat_<double>> hog_desc_frames_init;
-	std::vector<cv::Mat_<double>> geom_descriptor_frames_init;
+	std::vector<cv::Mat_<float>> projected_desc_frames_init;
 	std::vector<int> views;
 	bool postprocessed = false;
 	int frames_tracking_succ = 0;
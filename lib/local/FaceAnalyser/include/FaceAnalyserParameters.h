@@ -66,6 +66,7 @@ public:
 	double getSimScaleOut() const { return sim_scale_out; }
 	int getSimSizeOut() const { return sim_size_out; }
 	bool getDynamic() const { return dynamic; }
+	int getMaxCalibrationFrames() const { return max_calibration_frames; }
 	std::string getModelLoc() const { return std::string(model_location); }
 	std::vector<cv::Vec3d> getOrientationBins() const { return std::vector<cv::Vec3d>(orientation_bins); }
 
@@ -83,6 +84,9 @@ private:
 	// Should a video stream be assumed
 	bool dynamic;
 
+	// How many of the initial frames are kept for re-predicting them once the person calibration has converged (a few hundred bytes each)
+	int max_calibration_frames;
+
 	// Where to load the models from
 	std::string model_location;
 	// The location of the executable
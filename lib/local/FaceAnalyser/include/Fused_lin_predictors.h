@@ -0,0 +1,111 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2017, Carnegie Mellon University and University of Cambridge,
+// all rights reserved.
+//
+// ACADEMIC OR NON-PROFIT ORGANIZATION NONCOMMERCIAL RESEARCH USE ONLY
+//
+// BY USING OR DOWNLOADING THE SOFTWARE, YOU ARE AGREEING TO THE TERMS OF THIS LICENSE AGREEMENT.  
+// IF YOU DO NOT AGREE WITH THESE TERMS, YOU MAY NOT USE OR DOWNLOAD THE SOFTWARE.
+//
+// License can be found in OpenFace-license.txt
+//
+//     * Any publications arising from the use of this software, including but
+//       not limited to academic journal and conference publications, technical
+//       reports and manuals, must cite at least one of the following works:
+//
+//       OpenFace 2.0: Facial Behavior Analysis Toolkit
+//       Tadas Baltruaitis, Amir Zadeh, Yao Chong Lim, and Louis-Philippe Morency
+//       in IEEE International Conference on Automatic Face and Gesture Recognition, 2018  
+//
+//       Convolutional experts constrained local model for facial landmark detection.
+//       A. Zadeh, T. Baltruaitis, and Louis-Philippe Morency,
+//       in Computer Vision and Pattern Recognition Workshops, 2017.    
+//
+//       Rendering of Eyes for Eye-Shape Registration and Gaze Estimation
+//       Erroll Wood, Tadas Baltruaitis, Xucong Zhang, Yusuke Sugano, Peter Robinson, and Andreas Bulling 
+//       in IEEE International. Conference on Computer Vision (ICCV),  2015 
+//
+//       Cross-dataset learning and person-specific normalisation for automatic Action Unit detection
+//       Tadas Baltruaitis, Marwa Mahmoud, and Peter Robinson 
+//       in Facial Expression Recognition and Analysis Challenge, 
+//       IEEE International Conference on Automatic Face and Gesture Recognition, 2015 
+//
+
+#ifndef FUSED_LIN_PREDICTORS_H
+#define FUSED_LIN_PREDICTORS_H
+
+#include <vector>
+#include <string>
+
+#include <opencv2/core/core.hpp>
+
+#include "SVR_static_lin_regressors.h"
+#include "SVR_dynamic_lin_regressors.h"
+#include "SVM_static_lin.h"
+#include "SVM_dynamic_lin.h"
+
+namespace FaceAnalysis
+{
+
+// All of the linear AU regressors and classifiers combined into a single weight matrix, so that the AUs of a frame (or a batch of frames) are predicted with one
+// matrix multiplication. The feature means are folded into the biases, and the running median of the dynamic models is multiplied together with the descriptor
+class Fused_lin_predictors{
+
+public:
+
+	Fused_lin_predictors() : input_dim(0), num_reg(0), num_class(0)
+	{}
+
+	// Combining the predictors (after they have been read in)
+	void Pack(const SVR_static_lin_regressors& svr_static, const SVR_dynamic_lin_regressors& svr_dynamic, const SVM_static_lin& svm_static, const SVM_dynamic_lin& svm_dynamic);
+
+	// Predict the AU intensities and occurences of a frame from the HOG appearance and geometry of the face, the predictions are in the order of the names,
+	// also returns the descriptor projected on the weights (a value per AU), which is all that is needed to predict the frame again with a different running median
+	void Predict(std::vector<double>& reg_predictions, std::vector<double>& class_predictions, cv::Mat_<float>& projected_descriptor, const cv::Mat_<double>& fhog_descriptor, 
+		const cv::Mat_<double>& geom_params, const cv::Mat_<double>& running_median, const cv::Mat_<double>& running_median_geom);
+
+	// Predict the AU intensities and occurences of a number of previously projected frames at once (a row in output per frame), all using the same running median
+	void PredictProjected(cv::Mat_<double>& reg_predictions, cv::Mat_<double>& class_predictions, const std::vector<cv::Mat_<float> >& projected_descriptors,
+		const cv::Mat_<double>& running_median, const cv::Mat_<double>& running_median_geom);
+
+	const std::vector<std::string>& GetAURegNames() const { return AU_names_reg; }
+	const std::vector<std::string>& GetAUClassNames() const { return AU_names_class; }
+
+	bool Empty() const { return weights.empty(); }
+
+private:
+
+	// Fill a row of the input with the descriptor (appending the geometry if the models use it)
+	void FillInput(cv::Mat_<float>& input, int row, const cv::Mat_<double>& fhog_descriptor, const cv::Mat_<double>& geom_params) const;
+
+	// Multiplying the input rows with the weights
+	void Project(cv::Mat_<float>& response, const cv::Mat_<float>& input) const;
+
+	// Converting the projected rows to the final predictions (the last row of the response being the projected running median)
+	void Evaluate(cv::Mat_<double>& reg_predictions, cv::Mat_<double>& class_predictions, const cv::Mat_<float>& response) const;
+
+	// The length of the descriptor the models use (HOG or HOG with geometry)
+	int input_dim;
+
+	// The regressors come first followed by the classifiers
+	int num_reg;
+	int num_class;
+
+	std::vector<std::string> AU_names_reg;
+	std::vector<std::string> AU_names_class;
+
+	// Weights stored in float (a column per AU), together with biases that already account for the feature means
+	cv::Mat_<float> weights;
+	cv::Mat_<double> biases;
+
+	// If a column uses the running median for person specific normalisation
+	std::vector<bool> dynamic;
+
+	// The classes the classifiers map to
+	std::vector<double> pos_classes;
+	std::vector<double> neg_classes;
+
+};
+  //===========================================================================
+}
+#endif // FUSED_LIN_PREDICTORS_H
@@ -66,6 +66,13 @@ public:
 		return AU_names;
 	}
 
+	// The model parameters, allowing to combine several predictors into one
+	const cv::Mat_<double>& GetMeans() const { return means; }
+	const cv::Mat_<double>& GetSupportVectors() const { return support_vectors; }
+	const cv::Mat_<double>& GetBiases() const { return biases; }
+	const std::vector<double>& GetPosClasses() const { return pos_classes; }
+	const std::vector<double>& GetNegClasses() const { return neg_classes; }
+
 private:
 
 	// The names of Action Units this model is responsible for
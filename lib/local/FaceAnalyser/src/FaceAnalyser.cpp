@@ -70,6 +70,9 @@ FaceAnalyser::FaceAnalyser(const FaceAnalysis::FaceAnalyserParameters& face_anal
 	// If the model used is dynamic (person callibration and video correction)
 	dynamic = face_analyser_params.getDynamic();
 
+	// How many frames to keep for calibrating the initial predictions
+	max_init_frames = face_analyser_params.getMaxCalibrationFrames();
+
 	out_grayscale = face_analyser_params.grayscale;
 
 	if(face_analyser_params.getOrientationBins().empty())
@@ -287,8 +290,9 @@ void FaceAnalyser::PredictStaticAUsAndComputeFeatures(const cv::Mat& frame, cons
 	//aligned_face_cols.convertTo(aligned_face_cols_double, CV_64F);
 	
 	// Perform AU prediction	
-	auto AU_predictions_intensity = PredictCurrentAUs(orientation_to_use);
-	auto AU_predictions_occurence = PredictCurrentAUsClass(orientation_to_use);
+	std::vector<std::pair<std::string, double>> AU_predictions_intensity;
+	std::vector<std::pair<std::string, double>> AU_predictions_occurence;
+	PredictCurrentAUs(orientation_to_use, AU_predictions_intensity, AU_predictions_occurence);
 
 	// Make sure intensity is within range (0-5)
 	for (size_t au = 0; au < AU_predictions_intensity.size(); ++au)
@@ -429,7 +433,7 @@ void FaceAnalyser::AddNextFrame(const cv::Mat& frame, const cv::Mat_<float>& det
 	}
 	
 	// Perform AU prediction	
-	AU_predictions_reg = PredictCurrentAUs(orientation_to_use);
+	PredictCurrentAUs(orientation_to_use, AU_predictions_reg, AU_predictions_class);
 
 	// Add the reg predictions to the historic data
 	for (size_t au = 0; au < AU_predictions_reg.size(); ++au)
@@ -449,8 +453,6 @@ void FaceAnalyser::AddNextFrame(const cv::Mat& frame, const cv::Mat_<float>& det
 			AU_predictions_reg[au].second = 0;
 		}
 	}
-	
-	AU_predictions_class = PredictCurrentAUsClass(orientation_to_use);
 
 	for (size_t au = 0; au < AU_predictions_class.size(); ++au)
 	{
@@ -481,8 +483,7 @@ void FaceAnalyser::AddNextFrame(const cv::Mat& frame, const cv::Mat_<float>& det
 	// Useful for prediction corrections (calibration after the whole video is processed)
 	if (success && frames_tracking_succ - 1 < max_init_frames)
 	{
-		hog_desc_frames_init.push_back(hog_descriptor);
-		geom_descriptor_frames_init.push_back(geom_descriptor_frame);
+		projected_desc_frames_init.push_back(projected_descriptor_frame);
 		views.push_back(orientation_to_use);
 	}
 
@@ -508,40 +509,47 @@ void FaceAnalyser::PostprocessPredictions()
 		int success_ind = 0;
 		int all_ind = 0;
 		int all_frames_size = (int)timestamps.size();
-		
-		while(all_ind < all_frames_size && success_ind < max_init_frames)
+
+		// Find the frames used for initialisation
+		std::vector<int> init_frame_inds;
+		while(all_ind < all_frames_size && success_ind < max_init_frames && success_ind < (int)projected_desc_frames_init.size())
 		{
-		
 			if(valid_preds[all_ind])
 			{
+				init_frame_inds.push_back(all_ind);
+				success_ind++;
+			}
+			all_ind++;
+		}
 
-				this->hog_desc_frame = hog_desc_frames_init[success_ind];
-				this->geom_descriptor_frame = geom_descriptor_frames_init[success_ind];
-
-				// Perform AU prediction	
-				auto AU_predictions_reg = PredictCurrentAUs(views[success_ind]);								
-
-				// Modify the predictions to the historic data
-				for (size_t au = 0; au < AU_predictions_reg.size(); ++au)
-				{
-					// Find the appropriate AU (if not found add it)		
-					AU_predictions_reg_all_hist[AU_predictions_reg[au].first][all_ind] = AU_predictions_reg[au].second;
+		// Perform AU prediction on all of them at once, using the final running median
+		std::vector<cv::Mat_<float> > projected_descs(projected_desc_frames_init.begin(), projected_desc_frames_init.begin() + success_ind);
 
-				}
+		cv::Mat_<double> preds_reg, preds_class;
+		AU_lin_predictors.PredictProjected(preds_reg, preds_class, projected_descs, this->hog_desc_median, this->geom_descriptor_median);
 
-				auto AU_predictions_class = PredictCurrentAUsClass(views[success_ind]);
+		const std::vector<std::string>& au_names_reg = AU_lin_predictors.GetAURegNames();
+		const std::vector<std::string>& au_names_class = AU_lin_predictors.GetAUClassNames();
 
-				for (size_t au = 0; au < AU_predictions_class.size(); ++au)
-				{
-					// Find the appropriate AU (if not found add it)		
-					AU_predictions_class_all_hist[AU_predictions_class[au].first][all_ind] = AU_predictions_class[au].second;
-				}
-		
-				success_ind++;
+		// Modify the predictions to the historic data
+		for (int au = 0; au < preds_reg.cols; ++au)
+		{
+			std::vector<double>& au_hist = AU_predictions_reg_all_hist[au_names_reg[au]];
+			for (int i = 0; i < preds_reg.rows; ++i)
+			{
+				au_hist[init_frame_inds[i]] = preds_reg.at<double>(i, au);
 			}
-			all_ind++;
+		}
 
+		for (int au = 0; au < preds_class.cols; ++au)
+		{
+			std::vector<double>& au_hist = AU_predictions_class_all_hist[au_names_class[au]];
+			for (int i = 0; i < preds_class.rows; ++i)
+			{
+				au_hist[init_frame_inds[i]] = preds_class.at<double>(i, au);
+			}
 		}
+
 		postprocessed = true;
 	}
 }
@@ -755,8 +763,7 @@ void FaceAnalyser::Reset()
 	valid_preds.clear();
 
 	// Clean up the postprocessing data as well
-	hog_desc_frames_init.clear();
-	geom_descriptor_frames_init.clear();
+	projected_desc_frames_init.clear();
 	postprocessed = false;
 	frames_tracking_succ = 0;
 }
@@ -860,36 +867,32 @@ void FaceAnalyser::ExtractMedian(cv::Mat_<int>& histogram, int hist_count, cv::M
 	}
 }
 // Apply the current predictors to the currently stored descriptors
-std::vector<std::pair<std::string, double>> FaceAnalyser::PredictCurrentAUs(int view)
+void FaceAnalyser::PredictCurrentAUs(int view, std::vector<std::pair<std::string, double>>& predictions_reg, std::vector<std::pair<std::string, double>>& predictions_class)
 {
 
-	std::vector<std::pair<std::string, double>> predictions;
+	predictions_reg.clear();
+	predictions_class.clear();
+	projected_descriptor_frame = cv::Mat_<float>();
 
 	if(!hog_desc_frame.empty())
 	{
-		std::vector<std::string> svr_lin_stat_aus;
-		std::vector<double> svr_lin_stat_preds;
+		std::vector<double> preds_reg;
+		std::vector<double> preds_class;
 
-		AU_SVR_static_appearance_lin_regressors.Predict(svr_lin_stat_preds, svr_lin_stat_aus, hog_desc_frame, geom_descriptor_frame);
+		AU_lin_predictors.Predict(preds_reg, preds_class, projected_descriptor_frame, hog_desc_frame, geom_descriptor_frame, this->hog_desc_median, this->geom_descriptor_median);
 
-		for(size_t i = 0; i < svr_lin_stat_preds.size(); ++i)
+		const std::vector<std::string>& au_names_reg = AU_lin_predictors.GetAURegNames();
+		for(size_t i = 0; i < preds_reg.size(); ++i)
 		{
-			predictions.push_back(std::pair<std::string, double>(svr_lin_stat_aus[i], svr_lin_stat_preds[i]));
+			predictions_reg.push_back(std::pair<std::string, double>(au_names_reg[i], preds_reg[i]));
 		}
 
-		std::vector<std::string> svr_lin_dyn_aus;
-		std::vector<double> svr_lin_dyn_preds;
-
-		AU_SVR_dynamic_appearance_lin_regressors.Predict(svr_lin_dyn_preds, svr_lin_dyn_aus, hog_desc_frame, geom_descriptor_frame,  this->hog_desc_median, this->geom_descriptor_median);
-
-		for(size_t i = 0; i < svr_lin_dyn_preds.size(); ++i)
+		const std::vector<std::string>& au_names_class = AU_lin_predictors.GetAUClassNames();
+		for(size_t i = 0; i < preds_class.size(); ++i)
 		{
-			predictions.push_back(std::pair<std::string, double>(svr_lin_dyn_aus[i], svr_lin_dyn_preds[i]));
+			predictions_class.push_back(std::pair<std::string, double>(au_names_class[i], preds_class[i]));
 		}
-
 	}
-
-	return predictions;
 }
 
 std::vector<std::pair<std::string, double>> FaceAnalyser::CorrectOnlineAUs(std::vector<std::pair<std::string, double>> predictions_orig, 
@@ -955,39 +958,6 @@ std::vector<std::pair<std::string, double>> FaceAnalyser::CorrectOnlineAUs(std::
 	return predictions;
 }
 
-// Apply the current predictors to the currently stored descriptors (classification)
-std::vector<std::pair<std::string, double>> FaceAnalyser::PredictCurrentAUsClass(int view)
-{
-
-	std::vector<std::pair<std::string, double>> predictions;
-
-	if(!hog_desc_frame.empty())
-	{
-		std::vector<std::string> svm_lin_stat_aus;
-		std::vector<double> svm_lin_stat_preds;
-		
-		AU_SVM_static_appearance_lin.Predict(svm_lin_stat_preds, svm_lin_stat_aus, hog_desc_frame, geom_descriptor_frame);
-
-		for(size_t i = 0; i < svm_lin_stat_aus.size(); ++i)
-		{
-			predictions.push_back(std::pair<std::string, double>(svm_lin_stat_aus[i], svm_lin_stat_preds[i]));
-		}
-
-		std::vector<std::string> svm_lin_dyn_aus;
-		std::vector<double> svm_lin_dyn_preds;
-
-		AU_SVM_dynamic_appearance_lin.Predict(svm_lin_dyn_preds, svm_lin_dyn_aus, hog_desc_frame, geom_descriptor_frame, this->hog_desc_median, this->geom_descriptor_median);
-
-		for(size_t i = 0; i < svm_lin_dyn_aus.size(); ++i)
-		{
-			predictions.push_back(std::pair<std::string, double>(svm_lin_dyn_aus[i], svm_lin_dyn_preds[i]));
-		}
-		
-	}
-
-	return predictions;
-}
-
 std::vector<std::pair<std::string, double>> FaceAnalyser::GetCurrentAUsClass() const
 {
 	return AU_predictions_class;
@@ -1048,6 +1018,9 @@ void FaceAnalyser::Read(std::string model_loc)
 			// The AU predictors
 			std::cout << "Reading the AU predictors from: " << location;
 			ReadAU(location);
+
+			// Combine the individual predictors into one
+			AU_lin_predictors.Pack(AU_SVR_static_appearance_lin_regressors, AU_SVR_dynamic_appearance_lin_regressors, AU_SVM_static_appearance_lin, AU_SVM_dynamic_appearance_lin);
 			std::cout << "... Done" << std::endl;
 		}
 		else if (module.compare("PDM") == 0)
@@ -1086,6 +1059,112 @@ static void rtrim(std::string &s) {
 	}).base(), s.end());
 }
 
+// Overwrite the AU columns of an output file in place, this relies on them being the last columns of every row and written at a fixed
+// width of four characters, if that is not the case the file is left untouched and false is returned
+static bool PatchAUColumns(const std::string& output_file, const std::vector<const std::vector<double>*>& au_columns, size_t num_rows)
+{
+	const int value_width = 4;
+	const int field_width = value_width + 1;
+	const int block_length = field_width * (int)au_columns.size();
+
+	// Make sure the new values fit in the fixed width
+	for (size_t c = 0; c < au_columns.size(); ++c)
+	{
+		if (au_columns[c]->size() != num_rows)
+			return false;
+
+		for (double value : *au_columns[c])
+		{
+			if (!(value >= 0 && value < 9.995))
+				return false;
+		}
+	}
+
+	std::fstream file(output_file, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+	if (!file.is_open() || block_length == 0)
+		return false;
+
+	// The header should end with the AU columns
+	std::string header_line;
+	std::getline(file, header_line);
+	std::vector<std::string> tokens;
+	split(header_line, tokens, ',');
+	if (tokens.size() < au_columns.size())
+		return false;
+	for (size_t t = tokens.size() - au_columns.size(); t < tokens.size(); ++t)
+	{
+		if (tokens[t].find("AU") == std::string::npos)
+			return false;
+	}
+	file.seekg(0);
+
+	// Find where each row ends, streaming through the file (the header is skipped)
+	std::vector<std::streamoff> row_ends;
+	std::vector<char> buffer(1 << 20);
+	std::streamoff position = 0;
+	char last_char = 0;
+	bool header = true;
+	while (file.read(buffer.data(), buffer.size()) || file.gcount() > 0)
+	{
+		std::streamsize num_read = file.gcount();
+		for (std::streamsize i = 0; i < num_read; ++i)
+		{
+			if (buffer[i] == '\n')
+			{
+				// Account for Windows line endings
+				char prev_char = i > 0 ? buffer[i - 1] : last_char;
+				std::streamoff row_end = prev_char == '\r' ? position + i - 1 : position + i;
+
+				if (header)
+					header = false;
+				else
+					row_ends.push_back(row_end);
+			}
+		}
+		last_char = buffer[num_read - 1];
+		position += num_read;
+	}
+	file.clear();
+
+	if (row_ends.size() != num_rows)
+		return false;
+
+	// Check that every row ends with the fixed width AU columns before modifying anything
+	std::vector<char> block(block_length);
+	for (size_t r = 0; r < num_rows; ++r)
+	{
+		if (row_ends[r] < block_length)
+			return false;
+
+		file.seekg(row_ends[r] - block_length);
+		if (!file.read(block.data(), block_length))
+			return false;
+
+		for (int c = 0; c < (int)au_columns.size(); ++c)
+		{
+			if (block[c * field_width] != ',' || block[c * field_width + 2] != '.')
+				return false;
+		}
+	}
+
+	// Overwrite the values
+	char value[16];
+	for (size_t r = 0; r < num_rows; ++r)
+	{
+		for (size_t c = 0; c < au_columns.size(); ++c)
+		{
+			std::snprintf(value, sizeof(value), "%.2f", (*au_columns[c])[r]);
+			block[c * field_width] = ',';
+			std::copy(value, value + value_width, block.begin() + c * field_width + 1);
+		}
+
+		file.seekp(row_ends[r] - block_length);
+		file.write(block.data(), block_length);
+	}
+
+	return file.good();
+}
+
 // Reading in AU prediction modules
 void FaceAnalyser::ReadAU(std::string au_model_location)
 {
@@ -1262,6 +1341,46 @@ double FaceAnalyser::GetCurrentTimeSeconds() {
 }
 
 // Allows for post processing of the AU signal
+void FaceAnalyser::AppendPredictionHistory(FaceAnalyser& other)
+{
+	// Re-predict the initial frames of both parts with their own neutral face estimates before merging, as the calibration frames are not kept after that
+	if (dynamic)
+	{
+		this->PostprocessPredictions();
+		other.PostprocessPredictions();
+	}
+
+	size_t num_frames = this->timestamps.size();
+
+	this->timestamps.insert(this->timestamps.end(), other.timestamps.begin(), other.timestamps.end());
+	this->valid_preds.insert(this->valid_preds.end(), other.valid_preds.begin(), other.valid_preds.end());
+
+	for (auto au_iter = other.AU_predictions_reg_all_hist.begin(); au_iter != other.AU_predictions_reg_all_hist.end(); ++au_iter)
+	{
+		std::vector<double>& au_vals = AU_predictions_reg_all_hist[au_iter->first];
+		au_vals.resize(num_frames, 0);
+		au_vals.insert(au_vals.end(), au_iter->second.begin(), au_iter->second.end());
+	}
+
+	for (auto au_iter = other.AU_predictions_class_all_hist.begin(); au_iter != other.AU_predictions_class_all_hist.end(); ++au_iter)
+	{
+		std::vector<double>& au_vals = AU_predictions_class_all_hist[au_iter->first];
+		au_vals.resize(num_frames, 0);
+		au_vals.insert(au_vals.end(), au_iter->second.begin(), au_iter->second.end());
+	}
+
+	// The AUs that are only predicted by this part are padded for the frames of the other one, so that every history covers all of the frames
+	for (auto au_iter = AU_predictions_reg_all_hist.begin(); au_iter != AU_predictions_reg_all_hist.end(); ++au_iter)
+	{
+		au_iter->second.resize(timestamps.size(), 0);
+	}
+
+	for (auto au_iter = AU_predictions_class_all_hist.begin(); au_iter != AU_predictions_class_all_hist.end(); ++au_iter)
+	{
+		au_iter->second.resize(timestamps.size(), 0);
+	}
+}
+
 void FaceAnalyser::PostprocessOutputFile(std::string output_file)
 {
 
@@ -1312,7 +1431,24 @@ void FaceAnalyser::PostprocessOutputFile(std::string output_file)
 			}
 		}
 	}
-	// Read all of the output file in
+
+	// Try overwriting only the AU columns in place first
+	std::vector<const std::vector<double>*> au_columns;
+	for (int ind : inds_reg)
+	{
+		au_columns.push_back(&predictions_reg[ind].second);
+	}
+	for (int ind : inds_class)
+	{
+		au_columns.push_back(&predictions_class[ind].second);
+	}
+
+	if ((int)au_columns.size() == num_reg + num_class && PatchAUColumns(output_file, au_columns, successes.size()))
+	{
+		return;
+	}
+
+	// Otherwise rewrite the whole file, read all of the output file in
 	std::vector<std::string> output_file_contents;
 
 	std::ifstream infile(output_file);
@@ -95,6 +95,24 @@ FaceAnalyserParameters::FaceAnalyserParameters(std::vector<std::string> &argumen
 			scale_set = true;
 			i++;
 		}
+		else if (arguments[i].compare("-au_calib_frames") == 0)
+		{
+			// 0 keeps none of the frames, the invalid values are ignored
+			std::stringstream data(arguments[i + 1]);
+			int calibration_frames = -1;
+			data >> calibration_frames;
+			if (calibration_frames >= 0)
+			{
+				max_calibration_frames = calibration_frames;
+			}
+			else
+			{
+				std::cout << "Warning: invalid number of AU calibration frames " << arguments[i + 1] << ", ignoring it" << std::endl;
+			}
+			valid[i] = false;
+			valid[i + 1] = false;
+			i++;
+		}
 		else if (arguments[i].compare("-simsize") == 0)
 		{
 			sim_size_out = stoi(arguments[i + 1]);
@@ -155,6 +173,7 @@ void FaceAnalyserParameters::init()
 	this->sim_scale_out = 0.7;
 	this->sim_size_out = 112;
 	this->sim_align_face_mask = true;
+	this->max_calibration_frames = 3000;
 
 	this->model_location = "AU_predictors/main_dynamic_svms.txt";
 
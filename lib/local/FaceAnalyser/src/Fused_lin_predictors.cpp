@@ -0,0 +1,261 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2017, Carnegie Mellon University and University of Cambridge,
+// all rights reserved.
+//
+// ACADEMIC OR NON-PROFIT ORGANIZATION NONCOMMERCIAL RESEARCH USE ONLY
+//
+// BY USING OR DOWNLOADING THE SOFTWARE, YOU ARE AGREEING TO THE TERMS OF THIS LICENSE AGREEMENT.  
+// IF YOU DO NOT AGREE WITH THESE TERMS, YOU MAY NOT USE OR DOWNLOAD THE SOFTWARE.
+//
+// License can be found in OpenFace-license.txt
+//
+//     * Any publications arising from the use of this software, including but
+//       not limited to academic journal and conference publications, technical
+//       reports and manuals, must cite at least one of the following works:
+//
+//       OpenFace 2.0: Facial Behavior Analysis Toolkit
+//       Tadas Baltruaitis, Amir Zadeh, Yao Chong Lim, and Louis-Philippe Morency
+//       in IEEE International Conference on Automatic Face and Gesture Recognition, 2018  
+//
+//       Convolutional experts constrained local model for facial landmark detection.
+//       A. Zadeh, T. Baltruaitis, and Louis-Philippe Morency,
+//       in Computer Vision and Pattern Recognition Workshops, 2017.    
+//
+//       Rendering of Eyes for Eye-Shape Registration and Gaze Estimation
+//       Erroll Wood, Tadas Baltruaitis, Xucong Zhang, Yusuke Sugano, Peter Robinson, and Andreas Bulling 
+//       in IEEE International. Conference on Computer Vision (ICCV),  2015 
+//
+//       Cross-dataset learning and person-specific normalisation for automatic Action Unit detection
+//       Tadas Baltruaitis, Marwa Mahmoud, and Peter Robinson 
+//       in Facial Expression Recognition and Analysis Challenge, 
+//       IEEE International Conference on Automatic Face and Gesture Recognition, 2015 
+//
+#include <stdafx_fa.h>
+
+#include "Fused_lin_predictors.h"
+
+// OpenBLAS
+#include <openblas_config.h>
+
+// Instead of including cblas.h and f77blas.h (the definitions from OpenBLAS and other BLAS libraries differ, declare the required OpenBLAS functionality here)
+#ifdef __cplusplus
+extern "C" {
+	/* Assume C declarations for C++ */
+#endif  /* __cplusplus */
+
+	void sgemm_(char *, char *, blasint *, blasint *, blasint *, float *,
+		float  *, blasint *, float  *, blasint *, float  *, float  *, blasint *);
+}
+
+using namespace FaceAnalysis;
+
+void Fused_lin_predictors::Pack(const SVR_static_lin_regressors& svr_static, const SVR_dynamic_lin_regressors& svr_dynamic, const SVM_static_lin& svm_static, const SVM_dynamic_lin& svm_dynamic)
+{
+	// The regressors followed by the classifiers
+	const cv::Mat_<double>* means[4] = { &svr_static.GetMeans(), &svr_dynamic.GetMeans(), &svm_static.GetMeans(), &svm_dynamic.GetMeans() };
+	const cv::Mat_<double>* support_vectors[4] = { &svr_static.GetSupportVectors(), &svr_dynamic.GetSupportVectors(), &svm_static.GetSupportVectors(), &svm_dynamic.GetSupportVectors() };
+	const cv::Mat_<double>* model_biases[4] = { &svr_static.GetBiases(), &svr_dynamic.GetBiases(), &svm_static.GetBiases(), &svm_dynamic.GetBiases() };
+	bool model_dynamic[4] = { false, true, false, true };
+
+	AU_names_reg = svr_static.GetAUNames();
+	std::vector<std::string> names = svr_dynamic.GetAUNames();
+	AU_names_reg.insert(AU_names_reg.end(), names.begin(), names.end());
+
+	AU_names_class = svm_static.GetAUNames();
+	names = svm_dynamic.GetAUNames();
+	AU_names_class.insert(AU_names_class.end(), names.begin(), names.end());
+
+	num_reg = (int)AU_names_reg.size();
+	num_class = (int)AU_names_class.size();
+
+	pos_classes = svm_static.GetPosClasses();
+	pos_classes.insert(pos_classes.end(), svm_dynamic.GetPosClasses().begin(), svm_dynamic.GetPosClasses().end());
+	neg_classes = svm_static.GetNegClasses();
+	neg_classes.insert(neg_classes.end(), svm_dynamic.GetNegClasses().begin(), svm_dynamic.GetNegClasses().end());
+
+	// Models using only HOG have shorter descriptors, the rows corresponding to geometry are left at zero for them
+	input_dim = 0;
+	int num_cols = 0;
+	for (int m = 0; m < 4; ++m)
+	{
+		if (!support_vectors[m]->empty())
+		{
+			input_dim = std::max(input_dim, means[m]->cols);
+			num_cols += support_vectors[m]->cols;
+		}
+	}
+
+	if (num_cols == 0 || num_cols != num_reg + num_class)
+	{
+		weights = cv::Mat_<float>();
+		biases = cv::Mat_<double>();
+		dynamic.clear();
+		return;
+	}
+
+	cv::Mat_<double> weights_d(input_dim, num_cols, 0.0);
+	biases = cv::Mat_<double>(1, num_cols, 0.0);
+	dynamic.assign(num_cols, false);
+
+	int col = 0;
+	for (int m = 0; m < 4; ++m)
+	{
+		if (support_vectors[m]->empty())
+			continue;
+
+		int cols = support_vectors[m]->cols;
+		int rows = support_vectors[m]->rows;
+		support_vectors[m]->copyTo(weights_d(cv::Rect(col, 0, cols, rows)));
+
+		// (x - means) * w + b = x * w + (b - means * w)
+		cv::Mat_<double> bias = *model_biases[m] - (*means[m]) * (*support_vectors[m]);
+		bias.copyTo(biases(cv::Rect(col, 0, cols, 1)));
+
+		for (int i = col; i < col + cols; ++i)
+		{
+			dynamic[i] = model_dynamic[m];
+		}
+		col += cols;
+	}
+
+	weights_d.convertTo(weights, CV_32F);
+}
+
+void Fused_lin_predictors::FillInput(cv::Mat_<float>& input, int row, const cv::Mat_<double>& fhog_descriptor, const cv::Mat_<double>& geom_params) const
+{
+	float* input_row = input.ptr<float>(row);
+
+	// An uninitialised running median acts as a zero one
+	if (fhog_descriptor.empty())
+	{
+		std::fill(input_row, input_row + input_dim, 0.0f);
+		return;
+	}
+
+	int hog_cols = std::min(fhog_descriptor.cols, input_dim);
+	const double* hog_row = fhog_descriptor.ptr<double>(0);
+	for (int i = 0; i < hog_cols; ++i)
+	{
+		input_row[i] = (float)hog_row[i];
+	}
+
+	// Append the geometry if the models use it
+	int geom_cols = std::min(geom_params.cols, input_dim - hog_cols);
+	const double* geom_row = geom_params.empty() ? 0 : geom_params.ptr<double>(0);
+	for (int i = 0; i < geom_cols; ++i)
+	{
+		input_row[hog_cols + i] = (float)geom_row[i];
+	}
+	for (int i = hog_cols + std::max(geom_cols, 0); i < input_dim; ++i)
+	{
+		input_row[i] = 0.0f;
+	}
+}
+
+void Fused_lin_predictors::Project(cv::Mat_<float>& response, const cv::Mat_<float>& input) const
+{
+	response = cv::Mat_<float>(input.rows, weights.cols, 0.0f);
+
+	// Perform matrix multiplication in OpenBLAS (fortran call)
+	float alpha1 = 1.0;
+	float beta1 = 0.0;
+	char N[2]; N[0] = 'N';
+	int num_rows = input.rows;
+	int num_cols = weights.cols;
+	int inner_dim = input.cols;
+	sgemm_(N, N, &num_cols, &num_rows, &inner_dim, &alpha1, (float*)weights.data, &num_cols, (float*)input.data, &inner_dim, &beta1, (float*)response.data, &num_cols);
+
+	// Above is a faster version of this
+	//response = input * weights;
+}
+
+void Fused_lin_predictors::Evaluate(cv::Mat_<double>& reg_predictions, cv::Mat_<double>& class_predictions, const cv::Mat_<float>& response) const
+{
+	int num_frames = response.rows - 1;
+	int num_cols = response.cols;
+
+	reg_predictions.create(num_frames, num_reg);
+	class_predictions.create(num_frames, num_class);
+
+	// The last row is the response to the running median, which the dynamic models subtract
+	const float* median_response = response.ptr<float>(num_frames);
+
+	for (int r = 0; r < num_frames; ++r)
+	{
+		const float* response_row = response.ptr<float>(r);
+		for (int j = 0; j < num_cols; ++j)
+		{
+			double pred = (double)response_row[j] + biases.at<double>(0, j);
+			if (dynamic[j])
+			{
+				pred -= (double)median_response[j];
+			}
+
+			if (j < num_reg)
+			{
+				reg_predictions.at<double>(r, j) = pred;
+			}
+			else
+			{
+				class_predictions.at<double>(r, j - num_reg) = pred > 0 ? pos_classes[j - num_reg] : neg_classes[j - num_reg];
+			}
+		}
+	}
+}
+
+void Fused_lin_predictors::Predict(std::vector<double>& reg_predictions, std::vector<double>& class_predictions, cv::Mat_<float>& projected_descriptor, const cv::Mat_<double>& fhog_descriptor,
+	const cv::Mat_<double>& geom_params, const cv::Mat_<double>& running_median, const cv::Mat_<double>& running_median_geom)
+{
+	reg_predictions.clear();
+	class_predictions.clear();
+
+	if (weights.empty())
+	{
+		projected_descriptor = cv::Mat_<float>();
+		return;
+	}
+
+	// The descriptor followed by the running median
+	cv::Mat_<float> input(2, input_dim);
+	FillInput(input, 0, fhog_descriptor, geom_params);
+	FillInput(input, 1, running_median, running_median_geom);
+
+	cv::Mat_<float> response;
+	Project(response, input);
+
+	cv::Mat_<double> reg_preds, class_preds;
+	Evaluate(reg_preds, class_preds, response);
+
+	reg_predictions.assign(reg_preds.begin(), reg_preds.end());
+	class_predictions.assign(class_preds.begin(), class_preds.end());
+
+	projected_descriptor = response.row(0).clone();
+}
+
+void Fused_lin_predictors::PredictProjected(cv::Mat_<double>& reg_predictions, cv::Mat_<double>& class_predictions, const std::vector<cv::Mat_<float> >& projected_descriptors,
+	const cv::Mat_<double>& running_median, const cv::Mat_<double>& running_median_geom)
+{
+	if (weights.empty() || projected_descriptors.empty())
+	{
+		reg_predictions = cv::Mat_<double>(0, num_reg);
+		class_predictions = cv::Mat_<double>(0, num_class);
+		return;
+	}
+
+	// Only the running median needs to be projected
+	cv::Mat_<float> median_input(1, input_dim);
+	FillInput(median_input, 0, running_median, running_median_geom);
+	cv::Mat_<float> median_response;
+	Project(median_response, median_input);
+
+	// A row per frame followed by the running median
+	int num_frames = (int)projected_descriptors.size();
+	cv::Mat_<float> response(num_frames + 1, weights.cols);
+	for (int i = 0; i < num_frames; ++i)
+	{
+		projected_descriptors[i].copyTo(response.row(i));
+	}
+	median_response.copyTo(response.row(num_frames));
+
+	Evaluate(reg_predictions, class_predictions, response);
+}
@@ -36,6 +36,7 @@
 #define GAZE_ESTIMATION_H
 
 #include "LandmarkDetectorModel.h"
+#include "FaceFrameResult.h"
 
 #include "opencv2/core/core.hpp"
 
@@ -44,6 +45,9 @@ namespace GazeAnalysis
 
 	void EstimateGaze(const LandmarkDetector::CLNF& clnf_model, cv::Point3f& gaze_absolute, float fx, float fy, float cx, float cy, bool left_eye);
 
+	// Estimating the gaze of both eyes and the gaze angle from the (cached) head pose and landmarks of a frame result, the gaze is stored in the result so is only estimated once
+	void EstimateGaze(LandmarkDetector::FaceFrameResult& face_result);
+
 	// Getting the gaze angle in radians with respect to the world coordinates (camera plane), when looking ahead straight at camera plane the gaze angle will be (0,0)
 	cv::Vec2f GetGazeAngle(cv::Point3f& gaze_vector_1, cv::Point3f& gaze_vector_2);
 	
@@ -84,12 +84,36 @@ cv::Point3f GazeAnalysis::GetPupilPosition(cv::Mat_<float> eyeLdmks3d){
 	return p;
 }
 
-void GazeAnalysis::EstimateGaze(const LandmarkDetector::CLNF& clnf_model, cv::Point3f& gaze_absolute, float fx, float fy, float cx, float cy, bool left_eye)
+// Estimating the gaze of an eye from the head pose, the 3D eye landmarks (3 x n) and the 3D face landmarks (3 x n)
+static cv::Point3f EstimateGazeFromShape(const cv::Vec6f& headPose, const cv::Mat_<float>& eyeLdmks3d, const cv::Mat_<float>& faceLdmks3d, bool left_eye)
 {
-	cv::Vec6f headPose = LandmarkDetector::GetPose(clnf_model, fx, fy, cx, cy);
 	cv::Vec3f eulerAngles(headPose(3), headPose(4), headPose(5));
 	cv::Matx33f rotMat = Utilities::Euler2RotationMatrix(eulerAngles);
 
+	cv::Point3f pupil = GazeAnalysis::GetPupilPosition(eyeLdmks3d);
+	cv::Point3f rayDir = pupil / norm(pupil);
+
+	cv::Mat faceLdmks3dT = faceLdmks3d.t();
+
+	cv::Mat offset = (cv::Mat_<float>(3, 1) << 0, -3.5, 7.0);
+
+	int eyeIdx = 1;
+	if (left_eye)
+	{
+		eyeIdx = 0;
+	}
+
+	cv::Mat eyeballCentreMat = (faceLdmks3dT.row(36+eyeIdx*6) + faceLdmks3dT.row(39+eyeIdx*6))/2.0f + (cv::Mat(rotMat)*offset).t();
+
+	cv::Point3f eyeballCentre = cv::Point3f(eyeballCentreMat);
+
+	cv::Point3f gazeVecAxis = RaySphereIntersect(cv::Point3f(0,0,0), rayDir, eyeballCentre, 12) - eyeballCentre;
+	
+	return gazeVecAxis / norm(gazeVecAxis);
+}
+
+void GazeAnalysis::EstimateGaze(const LandmarkDetector::CLNF& clnf_model, cv::Point3f& gaze_absolute, float fx, float fy, float cx, float cy, bool left_eye)
+{
 	int part = -1;
 	for (size_t i = 0; i < clnf_model.hierarchical_models.size(); ++i)
 	{
@@ -110,29 +134,32 @@ void GazeAnalysis::EstimateGaze(const LandmarkDetector::CLNF& clnf_model, cv::Po
 		return;
 	}
 
-	cv::Mat eyeLdmks3d = clnf_model.hierarchical_models[part].GetShape(fx, fy, cx, cy);
+	cv::Vec6f headPose = LandmarkDetector::GetPose(clnf_model, fx, fy, cx, cy);
+	cv::Mat_<float> eyeLdmks3d = clnf_model.hierarchical_models[part].GetShape(fx, fy, cx, cy);
+	cv::Mat_<float> faceLdmks3d = clnf_model.GetShape(fx, fy, cx, cy);
 
-	cv::Point3f pupil = GetPupilPosition(eyeLdmks3d);
-	cv::Point3f rayDir = pupil / norm(pupil);
+	gaze_absolute = EstimateGazeFromShape(headPose, eyeLdmks3d, faceLdmks3d, left_eye);
+}
 
-	cv::Mat faceLdmks3d = clnf_model.GetShape(fx, fy, cx, cy);
-	faceLdmks3d = faceLdmks3d.t();
+void GazeAnalysis::EstimateGaze(LandmarkDetector::FaceFrameResult& face_result)
+{
+	if (face_result.HasGaze())
+		return;
 
-	cv::Mat offset = (cv::Mat_<float>(3, 1) << 0, -3.5, 7.0);
+	const cv::Mat_<float>& left_eye = face_result.GetEyeShape3D(true);
+	const cv::Mat_<float>& right_eye = face_result.GetEyeShape3D(false);
 
-	int eyeIdx = 1;
-	if (left_eye)
+	if (left_eye.empty() || right_eye.empty())
 	{
-		eyeIdx = 0;
+		std::cout << "Couldn't find the eye model, something wrong" << std::endl;
+		face_result.SetGaze(cv::Point3f(0, 0, 0), cv::Point3f(0, 0, 0), cv::Vec2f(0, 0));
+		return;
 	}
 
-	cv::Mat eyeballCentreMat = (faceLdmks3d.row(36+eyeIdx*6) + faceLdmks3d.row(39+eyeIdx*6))/2.0f + (cv::Mat(rotMat)*offset).t();
+	cv::Point3f gaze_direction0 = EstimateGazeFromShape(face_result.GetPose(), left_eye, face_result.GetShape3D(), true);
+	cv::Point3f gaze_direction1 = EstimateGazeFromShape(face_result.GetPose(), right_eye, face_result.GetShape3D(), false);
 
-	cv::Point3f eyeballCentre = cv::Point3f(eyeballCentreMat);
-
-	cv::Point3f gazeVecAxis = RaySphereIntersect(cv::Point3f(0,0,0), rayDir, eyeballCentre, 12) - eyeballCentre;
-	
-	gaze_absolute = gazeVecAxis / norm(gazeVecAxis);
+	face_result.SetGaze(gaze_direction0, gaze_direction1, GetGazeAngle(gaze_direction0, gaze_direction1));
 }
 
 cv::Vec2f GazeAnalysis::GetGazeAngle(cv::Point3f& gaze_vector_1, cv::Point3f& gaze_vector_2)
@@ -48,6 +48,9 @@ namespace LandmarkDetector
 	// The fully connected layer
 	void fully_connected(std::vector<cv::Mat_<float> >& outputs, const std::vector<cv::Mat_<float> >& input_maps, cv::Mat_<float> weights, cv::Mat_<float> biases);
 
+	// The fully connected layer applied to several inputs (input -> maps) at once, the flattened inputs are stacked as columns for a single matrix multiplication
+	void fully_connected_batch(std::vector<std::vector<cv::Mat_<float> > >& outputs, const std::vector<std::vector<cv::Mat_<float> > >& input_maps, cv::Mat_<float> weights, cv::Mat_<float> biases);
+
 	// Max pooling layer with parametrized stride and kernel sizes
 	void max_pooling(std::vector<cv::Mat_<float> >& outputs, const std::vector<cv::Mat_<float> >& input_maps, int stride_x, int stride_y, int kernel_size_x, int kernel_size_y);
 
@@ -58,5 +61,8 @@ namespace LandmarkDetector
 	
 	// Convolution using matrix multiplication and OpenBLAS optimization, can also provide a pre-allocated im2col result for faster processing
 	void convolution_direct_blas(std::vector<cv::Mat_<float> >& outputs, const std::vector<cv::Mat_<float> >& input_maps, const cv::Mat_<float>& weight_matrix, int height_k, int width_k, cv::Mat_<float>& pre_alloc_im2col);
+
+	// The same convolution of several inputs (input -> maps) of the same size, their im2col results are stacked in pre_alloc_im2col so a single matrix multiplication is used
+	void convolution_direct_blas_batch(std::vector<std::vector<cv::Mat_<float> > >& outputs, const std::vector<std::vector<cv::Mat_<float> > >& input_maps, const cv::Mat_<float>& weight_matrix, int height_k, int width_k, cv::Mat_<float>& pre_alloc_im2col);
 }
 #endif // CNN_UTILS_H
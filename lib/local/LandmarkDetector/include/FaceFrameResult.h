@@ -0,0 +1,115 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2017, Carnegie Mellon University and University of Cambridge,
+// all rights reserved.
+//
+// ACADEMIC OR NON-PROFIT ORGANIZATION NONCOMMERCIAL RESEARCH USE ONLY
+//
+// BY USING OR DOWNLOADING THE SOFTWARE, YOU ARE AGREEING TO THE TERMS OF THIS LICENSE AGREEMENT.  
+// IF YOU DO NOT AGREE WITH THESE TERMS, YOU MAY NOT USE OR DOWNLOAD THE SOFTWARE.
+//
+// License can be found in OpenFace-license.txt
+//
+//     * Any publications arising from the use of this software, including but
+//       not limited to academic journal and conference publications, technical
+//       reports and manuals, must cite at least one of the following works:
+//
+//       OpenFace 2.0: Facial Behavior Analysis Toolkit
+//       Tadas Baltruaitis, Amir Zadeh, Yao Chong Lim, and Louis-Philippe Morency
+//       in IEEE International Conference on Automatic Face and Gesture Recognition, 2018  
+//
+//       Convolutional experts constrained local model for facial landmark detection.
+//       A. Zadeh, T. Baltruaitis, and Louis-Philippe Morency,
+//       in Computer Vision and Pattern Recognition Workshops, 2017.    
+//
+//       Rendering of Eyes for Eye-Shape Registration and Gaze Estimation
+//       Erroll Wood, Tadas Baltruaitis, Xucong Zhang, Yusuke Sugano, Peter Robinson, and Andreas Bulling 
+//       in IEEE International. Conference on Computer Vision (ICCV),  2015 
+//
+//       Cross-dataset learning and person-specific normalisation for automatic Action Unit detection
+//       Tadas Baltruaitis, Marwa Mahmoud, and Peter Robinson 
+//       in Facial Expression Recognition and Analysis Challenge, 
+//       IEEE International Conference on Automatic Face and Gesture Recognition, 2015 
+//
+
+#ifndef FACE_FRAME_RESULT_H
+#define FACE_FRAME_RESULT_H
+
+// OpenCV includes
+#include <opencv2/core/core.hpp>
+
+#include <vector>
+
+#include "LandmarkDetectorModel.h"
+
+namespace LandmarkDetector
+{
+	//===========================================================================
+	/**
+	The quantities derived from a face model after it was fitted on a frame (head pose, 3D landmarks, eye landmarks, and gaze). Each is computed the first
+	time it is requested and reused afterwards, so that the analysers, the visualizer and the recorder share them. As the result refers to the model it is only
+	valid until the model is fitted on the next frame.
+	*/
+	class FaceFrameResult
+	{
+	public:
+
+		FaceFrameResult(const CLNF& clnf_model, float fx, float fy, float cx, float cy);
+
+		const CLNF& GetModel() const { return clnf_model; }
+
+		float GetFx() const { return fx; }
+		float GetFy() const { return fy; }
+		float GetCx() const { return cx; }
+		float GetCy() const { return cy; }
+
+		// The head pose in world coordinates (same as GetPose)
+		const cv::Vec6f& GetPose();
+
+		// The 3D landmarks in camera space as 3 x n (same as CLNF::GetShape)
+		const cv::Mat_<float>& GetShape3D();
+
+		// The 3D landmarks of the left or right eye model as 3 x n, empty if the model has no such eye model
+		const cv::Mat_<float>& GetEyeShape3D(bool left_eye);
+
+		// The 2D and 3D landmarks of all the eye models (same as CalculateAllEyeLandmarks and Calculate3DEyeLandmarks)
+		const std::vector<cv::Point2f>& GetEyeLandmarks2D();
+		const std::vector<cv::Point3f>& GetEyeLandmarks3D();
+
+		// Gaze is estimated by the gaze analyser (see GazeAnalysis::EstimateGaze), which stores it here
+		bool HasGaze() const { return gaze_computed; }
+		void SetGaze(const cv::Point3f& gaze_direction0, const cv::Point3f& gaze_direction1, const cv::Vec2f& gaze_angle);
+		const cv::Point3f& GetGazeDirection0() const { return gaze_direction0; }
+		const cv::Point3f& GetGazeDirection1() const { return gaze_direction1; }
+		const cv::Vec2f& GetGazeAngle() const { return gaze_angle; }
+
+	private:
+
+		const CLNF& clnf_model;
+		float fx, fy, cx, cy;
+
+		bool pose_computed;
+		cv::Vec6f pose;
+
+		bool shape_computed;
+		cv::Mat_<float> shape_3D;
+
+		bool eye_shapes_computed;
+		cv::Mat_<float> left_eye_shape_3D;
+		cv::Mat_<float> right_eye_shape_3D;
+
+		bool eye_landmarks_2D_computed;
+		std::vector<cv::Point2f> eye_landmarks_2D;
+
+		bool eye_landmarks_3D_computed;
+		std::vector<cv::Point3f> eye_landmarks_3D;
+
+		bool gaze_computed;
+		cv::Point3f gaze_direction0;
+		cv::Point3f gaze_direction1;
+		cv::Vec2f gaze_angle;
+
+		void ComputeEyeShapes();
+
+	};
+}
+#endif // FACE_FRAME_RESULT_H
@@ -40,5 +40,7 @@
 #include "LandmarkDetectorFunc.h"
 #include "LandmarkDetectorParameters.h"
 #include "LandmarkDetectorUtils.h"
+#include "FaceFrameResult.h"
+#include "TaskScheduler.h"
 
 #endif // LANDMARK_CORE_INCLUDES_H
\ No newline at end of file
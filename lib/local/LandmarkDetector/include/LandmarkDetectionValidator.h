@@ -39,6 +39,7 @@
 #include <opencv2/core/core.hpp>
 
 // System includes
+#include <string>
 #include <vector>
 
 // Local includes
@@ -56,6 +57,9 @@ class DetectionValidator
 {
 		
 public:    
+
+	// The file the validator was read from, validators read from the same file are interchangeable so they can check detections together
+	std::string location;
 	
 	// The orientations of each of the landmark detection validator
 	std::vector<cv::Vec3d> orientations;
@@ -93,6 +97,9 @@ public:
 	// Given an image, orientation and detected landmarks output the result of the appropriate regressor
 	float Check(const cv::Vec3d& orientation, const cv::Mat_<uchar>& intensity_img, cv::Mat_<float>& detected_landmarks);
 
+	// Checking several detections in the same image (e.g. several faces), the detections closest to the same view are evaluated by the CNN together
+	std::vector<float> Check(const std::vector<cv::Vec3d>& face_orientations, const cv::Mat_<uchar>& intensity_img, const std::vector<cv::Mat_<float> >& detected_landmarks);
+
 	// Reading in the model
 	void Read(std::string location);
 			
@@ -103,8 +110,11 @@ private:
 
 	// The actual regressor application on the image
 
-	// Convolutional Neural Network
-	double CheckCNN(const cv::Mat_<float>& warped_img, int view_id);
+	// Warping the face within the detected landmarks to the reference shape of the view, returns false if there is no face region in the image
+	bool WarpFace(cv::Mat_<float>& warped_img, const cv::Mat_<uchar>& intensity_img, const cv::Mat_<float>& detected_landmarks, int view_id);
+
+	// Convolutional Neural Network applied to a number of warped images of the same view together
+	void CheckCNN(std::vector<double>& decisions, const std::vector<cv::Mat_<float> >& warped_imgs, int view_id);
 
 	// A normalisation helper
 	void NormaliseWarpedToVector(const cv::Mat_<float>& warped_img, cv::Mat_<float>& feature_vec, int view_id);
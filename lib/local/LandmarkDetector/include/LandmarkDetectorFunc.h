@@ -56,6 +56,11 @@ namespace LandmarkDetector
 	bool DetectLandmarksInVideo(const cv::Mat &rgb_image, CLNF& clnf_model, FaceModelParameters& params, cv::Mat &grayscale_image);
 	bool DetectLandmarksInVideo(const cv::Mat &rgb_image, const cv::Rect_<double> bounding_box, CLNF& clnf_model, FaceModelParameters& params, cv::Mat &grayscale_image);
 
+	// Landmark detection in video for several faces at once, the active models that are tracked are fit together (see CLNF::DetectLandmarks for several models),
+	// returns the detection success of every model (false for the inactive ones)
+	std::vector<bool> DetectLandmarksInVideo(const cv::Mat &rgb_image, std::vector<CLNF>& clnf_models, const std::vector<bool>& active_models, 
+		std::vector<FaceModelParameters>& params, cv::Mat &grayscale_image);
+
 	//================================================================================================================
 	// Landmark detection in image, need to provide an image and optionally CLNF model together with parameters (default values work well)
 	// Optionally can provide a bounding box in which detection is performed (this is useful if multiple faces are to be detected in images)
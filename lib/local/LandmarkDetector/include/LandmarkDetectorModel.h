@@ -43,15 +43,56 @@
 #include <dlib/image_processing/frontal_face_detector.h>
 #include <dlib/opencv.h>
 
+#include <functional>
+#include <future>
+
 #include "PDM.h"
 #include "Patch_experts.h"
 #include "LandmarkDetectionValidator.h"
 #include "LandmarkDetectorParameters.h"
 #include "FaceDetectorMTCNN.h"
+#include "MotionModel.h"
 
 namespace LandmarkDetector
 {
 
+// How much of the optimisation was used when fitting a model on the last frame
+struct FitStatistics
+{
+	// The number of scales (window sizes) at which the model was optimised
+	int scales_used = 0;
+
+	// The number of RLMS iterations across all the rigid and all the non-rigid passes
+	int rigid_iterations = 0;
+	int non_rigid_iterations = 0;
+
+	// Root mean square of the mean shifts (in pixels) at the last iteration
+	float mean_shift = 0;
+
+	// The remaining passes and scales were skipped as the model converged or as the time budget ran out
+	bool converged_early = false;
+	bool time_budget_exceeded = false;
+
+	// Time spent fitting the model in milliseconds
+	double fit_time = 0;
+};
+
+// How often the detection validator was run on a tracked model
+struct ValidationStatistics
+{
+	// The number of frames on which the validator was run and on which it was skipped (between the periodic validations)
+	int validations_run = 0;
+	int validations_skipped = 0;
+
+	// The validations that were run before the interval was up because the likelihood dropped or the head rotated
+	int validations_triggered = 0;
+
+	// The model likelihood and head rotation at the last validated frame and the number of frames tracked since
+	float validated_likelihood = 0;
+	cv::Vec3f validated_rotation = cv::Vec3f(0, 0, 0);
+	int frames_since_validation = 0;
+};
+
 // A main class containing all the modules required for landmark detection
 // Face shape model
 // Patch experts
@@ -128,8 +169,14 @@ public:
 	// This is useful for knowing when to initialise and reinitialise tracking
 	int failures_in_a_row;
 
-	// A template of a face that last succeeded with tracking (useful for large motions in video)
+	// A template of a face that last succeeded with tracking (useful for large motions in video), stored at the resolution it is matched at
+	// (face_template_scaling of the image) together with its coarser pyramid levels (each half the size of the previous one)
 	cv::Mat_<uchar> face_template;
+	std::vector<cv::Mat_<uchar> > face_template_pyramid;
+	float face_template_scaling;
+
+	// The motion of the face over the last tracked frames, used to predict where to start tracking on the next frame
+	MotionModel motion_model;
 
 	// Useful when resetting or initialising the model closer to a specific location (when multiple faces are present)
 	cv::Point_<double> preference_det;
@@ -137,6 +184,12 @@ public:
 	// Tracking which view was used last
 	int view_used;
 
+	// How many scales and iterations were used when fitting the model on the last frame
+	FitStatistics fit_statistics;
+
+	// How often the validator was run or skipped
+	ValidationStatistics validation_statistics;
+
 	// See if the model was read in correctly
 	bool loaded_successfully;
 
@@ -152,8 +205,8 @@ public:
 	// Assignment operator for lvalues (makes a deep copy of the detector)
 	CLNF & operator= (const CLNF& other);
 
-	// Empty Destructor	as the memory of every object will be managed by the corresponding libraries (no pointers)
-	~CLNF(){}
+	// The memory of every object will be managed by the corresponding libraries (no pointers), only a background hierarchical refinement or face detection has to be waited for
+	~CLNF();
 
 	// Move constructor
 	CLNF(const CLNF&& other);
@@ -163,6 +216,32 @@ public:
 
 	// Does the actual work - landmark detection
 	bool DetectLandmarks(const cv::Mat_<uchar> &image, FaceModelParameters& params);
+
+	// Landmark detection of several models (e.g. several faces) in the same image, the models are fit in lockstep and the patch expert responses
+	// of all of them are computed in one parallel loop at each scale, returns the detection success of every model
+	static std::vector<bool> DetectLandmarks(const cv::Mat_<uchar> &image, const std::vector<CLNF*>& models, const std::vector<FaceModelParameters*>& params);
+
+	// Validating the current landmarks after a fit (fit_success), sets and returns detection_success, validation might be skipped depending on params
+	bool ValidateDetection(const cv::Mat_<uchar> &image, bool fit_success, const FaceModelParameters& params);
+
+	// With refine_hierarchical_async the hierarchical models are fit in the background after DetectLandmarks returns, and detected_landmarks, params_local and
+	// params_global hold the main model fit until this is called, it waits for the part models and incorporates them (does nothing if no refinement is pending).
+	// The detection certainty is not updated here, it stays the one of the main model fit
+	void FinishHierarchicalRefinement();
+
+	// Is a background hierarchical refinement waiting to be incorporated through FinishHierarchicalRefinement
+	bool HierarchicalRefinementPending() const { return hierarchical_refinement_pending; }
+
+	// With async_face_detection the face detection used for (re)initialisation in video runs detect in the background, while the model keeps tracking
+	// (does nothing if a detection is already pending), detect should only use its own copy of the frame and the face detectors of this model
+	void StartFaceDetection(const std::function<bool(cv::Rect_<float>&)>& detect);
+
+	// Is a background face detection running or waiting to be picked up through FinishFaceDetection
+	bool FaceDetectionPending() const { return face_detection_pending; }
+
+	// If the background face detection is done returns true together with its result (success and the detected bounding_box), otherwise returns
+	// false right away
+	bool FinishFaceDetection(bool& success, cv::Rect_<float>& bounding_box);
 	
 	// Gets the shape of the current detected landmarks in camera space (given camera calibration)
 	// Can only be called after a call to DetectLandmarksInVideo or DetectLandmarksInImage
@@ -191,9 +270,82 @@ private:
 	// the speedup of RLMS using precalculated KDE responses (described in Saragih 2011 RLMS paper)
 	std::map<int, cv::Mat_<float> >		kde_resp_precalc;
 
+	// The state of fitting the model on a frame that is kept between the scales (so that several models can be fit in lockstep)
+	struct FitState
+	{
+		// The patch expert responses at the current scale
+		std::vector<cv::Mat_<float> > patch_expert_responses;
+		Patch_experts::ResponseContext response_context;
+
+		// Converting from image space to patch expert space (normalised for rotation and scale)
+		cv::Matx22f sim_ref_to_img;
+		cv::Matx22f sim_img_to_ref;
+
+		// The parameters adapted to the current scale
+		FaceModelParameters tmp_parameters;
+
+		int active_scale;
+		int64 fit_start;
+		bool adaptive_fit;
+
+		// Are the remaining scales skipped and was the fitting successful
+		bool finished;
+		bool success;
+	};
+
 	// The model fitting: patch response computation and optimisation steps
     bool Fit(const cv::Mat_<float>& intensity_image, const std::vector<int>& window_sizes, const FaceModelParameters& parameters);
 
+	// The steps of Fit, FitScale expects the patch expert responses at that scale to be computed
+	void FitBegin(FitState& state, const FaceModelParameters& parameters);
+	void FitScale(FitState& state, const std::vector<int>& window_sizes, int scale, const FaceModelParameters& parameters);
+	void FitEnd(FitState& state);
+
+	// The hierarchical refinement and validation of a fit model
+	bool RefineAndValidate(const cv::Mat_<uchar> &image, bool fit_success, FaceModelParameters& params);
+
+	// The hierarchical refinement of the landmarks after the model was fit (in the background if params.refine_hierarchical_async)
+	void RefineHierarchical(const cv::Mat_<uchar> &image, FaceModelParameters& params);
+
+	// Does the fit need to be checked by the validator, it is not needed if the fit failed or if it is a stable track in between the periodic validations
+	bool ValidationRequired(bool fit_success, const FaceModelParameters& params) const;
+
+	// Setting detection_success and detection_certainty given the validator certainty (negative if the validator was not run)
+	bool SetDetectionResult(bool fit_success, float certainty, const FaceModelParameters& params);
+
+	// Fitting the hierarchical models initialised from the main model landmarks, a part model is only fit if the face is large enough for it not to need
+	// upsampling, returns if any of them were fit
+	bool FitHierarchicalModels(const cv::Mat_<uchar> &image, const cv::Mat_<float>& main_landmarks, float main_scale);
+
+	// Copying the part model landmarks into detected_landmarks and recomputing the main model parameters from them
+	void IncorporateHierarchicalModels();
+
+	// Waiting for the background hierarchical refinement (if any) without incorporating it, the part models are not modified once this returns
+	void WaitHierarchicalRefinement() const;
+
+	// The background hierarchical refinement, whether its results still need to be incorporated into the main model and if any part models were fit
+	std::shared_future<void> hierarchical_refinement;
+	bool hierarchical_refinement_pending;
+	bool hierarchical_parts_used;
+
+	// Waiting for the background face detection (if any) without picking up its result, the face detectors are not used once this returns
+	void WaitFaceDetection() const;
+
+	// The result of a background face detection, owned by the task (and shared with the model) so that the task never writes into the model itself
+	struct FaceDetectionResult
+	{
+		bool success;
+		cv::Rect_<float> box;
+	};
+
+	// The background face detection, whether its result still needs to be picked up and the result itself
+	std::shared_future<void> face_detection;
+	bool face_detection_pending;
+	std::shared_ptr<FaceDetectionResult> face_detection_result;
+
+	// Should the adaptive fitting stop after a pass that moved the landmarks from shape_before to shape_after
+	bool FitCompleted(const cv::Mat_<float>& shape_after, const cv::Mat_<float>& shape_before, int64 fit_start, const FaceModelParameters& parameters);
+
 	// Mean shift computation that uses precalculated kernel density estimators (the one actually used)
 	void NonVectorisedMeanShift_precalc_kde(cv::Mat_<float>& out_mean_shifts, const std::vector<cv::Mat_<float> >& patch_expert_responses, 
 		const cv::Mat_<float> &dxs, const cv::Mat_<float> &dys, int resp_size, float a, int scale, int view_id, 
@@ -209,6 +361,9 @@ private:
 	// Generating the weight matrix for the Weighted least squares
 	void GetWeightMatrix(cv::Mat_<float>& WeightMatrix, int scale, int view_id, const FaceModelParameters& parameters);
 
+	// The diagonal of the weight matrix as n x 1 (the same weight is used for x and y)
+	void GetWeights(cv::Mat_<float>& weights, int scale, int view_id, const FaceModelParameters& parameters);
+
   };
   //===========================================================================
 }
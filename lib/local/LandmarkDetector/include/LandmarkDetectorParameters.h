@@ -46,6 +46,16 @@ struct FaceModelParameters
 
 	// A number of RLMS or NU-RLMS iterations
 	int num_optimisation_iteration;
+
+	// The number of iterations at each scale, overriding num_optimisation_iteration (if shorter than the number of scales the last value is used for the remaining ones)
+	std::vector<int> num_optimisation_iteration_scale;
+
+	// Adaptive fitting, if the landmarks moved less than this (root mean square in pixels) during a pass and the remaining mean shifts are also smaller, 
+	// the model is considered converged and the remaining passes and scales are skipped (0 to always use all of the scales)
+	float fit_convergence_threshold;
+
+	// Time budget for fitting the model on a frame in milliseconds, once exceeded no further passes are started (0 for no budget)
+	float fit_time_budget;
 	
 	// Should pose be limited to 180 degrees frontal
 	bool limit_pose;
@@ -56,6 +66,19 @@ struct FaceModelParameters
 	// Landmark detection validator boundary for correct detection, the regressor output 1 (perfect alignment) 0 (bad alignment), 
 	float validation_boundary;
 
+	// Validation is skipped on tracked frames whose model likelihood is at most this much below the one of the last validated frame, the last detection
+	// certainty is kept then (0 to validate every frame)
+	float validation_skip_lhood_drop;
+
+	// The most frames in a row on which validation can be skipped
+	int validation_max_skipped;
+
+	// Tracked frames can also be validated every validation_interval frames (1 for every frame), in between the detection certainty of the last validated
+	// frame is kept. With either policy a frame is validated right away if the head rotated by more than validation_rotation_change (in degrees) since the
+	// last validated frame, or if the likelihood dropped by more than validation_skip_lhood_drop (when it is set)
+	int validation_interval;
+	float validation_rotation_change;
+
 	// Used when tracking is going well
 	std::vector<int> window_sizes_small;
 
@@ -64,11 +87,23 @@ struct FaceModelParameters
 	
 	// Used for the current frame
 	std::vector<int> window_sizes_current;
+
+	// How many source frames are skipped between consecutive tracked frames (e.g. when processing a video at a lower frame rate),
+	// with a stride above 1 the motion between frames is larger so the initialisation window sizes are also used for tracking
+	int frame_stride;
 	
 	// How big is the tracking template that helps with large motions
 	float face_template_scale;	
 	bool use_face_template;
 
+	// The tracking template is only refreshed when its correlation with the newly tracked face drops below this
+	float face_template_refresh;
+
+	// Should tracking start from the rigid parameters predicted by a constant velocity motion model, if the last prediction error was below
+	// motion_model_max_error (as a fraction of the face width) the motion is smooth enough to keep tracking with the small window sizes even with a frame stride
+	bool use_motion_model;
+	float motion_model_max_error;
+
 	// Where to load the model from
 	std::string model_location;
 	
@@ -88,6 +123,10 @@ struct FaceModelParameters
 	// How often should face detection be used to attempt reinitialisation, every n frames (set to negative not to reinit)
 	int reinit_video_every;
 
+	// Should the face detection for reinitialisation run in the background, tracking then continues while the detector runs and the model is reinitialised
+	// from the detected face on the first frame after it is done (a frame or a few later)
+	bool async_face_detection;
+
 	// Determining which face detector to use for (re)initialisation, HAAR is quicker but provides more false positives and is not goot for in-the-wild conditions
 	// Also HAAR detector can detect smaller faces while HOG SVM is only capable of detecting faces at least 70px across
 	// MTCNN detector is much more accurate that the other two, and is even suitable for profile faces, but it is somewhat slower
@@ -100,9 +139,19 @@ struct FaceModelParameters
 	// Should the model be refined hierarchically (if available)
 	bool refine_hierarchical;
 
+	// Should the hierarchical refinement run in the background, the caller then has to use CLNF::FinishHierarchicalRefinement before reading the landmarks.
+	// The detection validation is not deferred, so detection_certainty and detection_success describe the main model fit before the part models are
+	// incorporated (which moves all of the landmarks), use the synchronous refinement if the certainty has to match the output landmarks exactly
+	bool refine_hierarchical_async;
+
 	// Should the parameters be refined for different scales
 	bool refine_parameters;
 
+	// The number of threads used by landmark detection (0 for one per hardware thread), and the first core the threads are bound to (-1 for no binding),
+	// see TaskScheduler::Configure
+	int num_threads;
+	int first_core;
+
 	FaceModelParameters();
 
 	FaceModelParameters(std::vector<std::string> &arguments);
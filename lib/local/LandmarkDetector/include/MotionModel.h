@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2017, Carnegie Mellon University and University of Cambridge,
+// all rights reserved.
+//
+// ACADEMIC OR NON-PROFIT ORGANIZATION NONCOMMERCIAL RESEARCH USE ONLY
+//
+// BY USING OR DOWNLOADING THE SOFTWARE, YOU ARE AGREEING TO THE TERMS OF THIS LICENSE AGREEMENT.  
+// IF YOU DO NOT AGREE WITH THESE TERMS, YOU MAY NOT USE OR DOWNLOAD THE SOFTWARE.
+//
+// License can be found in OpenFace-license.txt
+//
+//     * Any publications arising from the use of this software, including but
+//       not limited to academic journal and conference publications, technical
+//       reports and manuals, must cite at least one of the following works:
+//
+//       OpenFace 2.0: Facial Behavior Analysis Toolkit
+//       Tadas Baltruaitis, Amir Zadeh, Yao Chong Lim, and Louis-Philippe Morency
+//       in IEEE International Conference on Automatic Face and Gesture Recognition, 2018  
+//
+//       Convolutional experts constrained local model for facial landmark detection.
+//       A. Zadeh, T. Baltruaitis, and Louis-Philippe Morency,
+//       in Computer Vision and Pattern Recognition Workshops, 2017.    
+//
+//       Rendering of Eyes for Eye-Shape Registration and Gaze Estimation
+//       Erroll Wood, Tadas Baltruaitis, Xucong Zhang, Yusuke Sugano, Peter Robinson, and Andreas Bulling 
+//       in IEEE International. Conference on Computer Vision (ICCV),  2015 
+//
+//       Cross-dataset learning and person-specific normalisation for automatic Action Unit detection
+//       Tadas Baltruaitis, Marwa Mahmoud, and Peter Robinson 
+//       in Facial Expression Recognition and Analysis Challenge, 
+//       IEEE International Conference on Automatic Face and Gesture Recognition, 2015 
+//
+
+#ifndef MOTION_MODEL_H
+#define MOTION_MODEL_H
+
+// OpenCV includes
+#include <opencv2/core/core.hpp>
+
+namespace LandmarkDetector
+{
+	//===========================================================================
+	/**
+	A constant velocity motion model of the rigid (global) parameters of a tracked face [scale, euler_x, euler_y, euler_z, tx, ty].
+	It is an alpha-beta filter (the steady state form of a constant velocity Kalman filter), each parameter has a position and a velocity
+	which are corrected by the difference between the tracked and the predicted parameters. Used to initialise tracking where the face is
+	expected to be on the next frame rather than where it was on the last one.
+	*/
+	class MotionModel
+	{
+	public:
+
+		MotionModel();
+
+		// Forgetting the motion (e.g. after reinitialisation or a tracking failure)
+		void Reset();
+
+		// Adding the parameters tracked on a frame frame_step frames after the last update, face_width (in pixels) is used to normalise the prediction error
+		void Update(const cv::Vec6f& params_global, int frame_step, float face_width);
+
+		// The expected parameters frame_step frames after the last update
+		cv::Vec6f Predict(int frame_step) const;
+
+		// Is there a velocity estimate (the face was tracked on at least two frames in a row)
+		bool HasVelocity() const { return num_updates > 1; }
+
+		// The translation error of the last prediction as a fraction of the face width
+		float LastError() const { return last_error; }
+
+	private:
+
+		// The filtered parameters at the last update and their change per frame
+		cv::Vec6f position;
+		cv::Vec6f velocity;
+
+		int num_updates;
+		float last_error;
+
+	};
+	//===========================================================================
+}
+#endif // MOTION_MODEL_H
@@ -101,6 +101,33 @@ public:
 	void Response(std::vector<cv::Mat_<float> >& patch_expert_responses, cv::Matx22f& sim_ref_to_img, cv::Matx22f& sim_img_to_ref, const cv::Mat_<float>& grayscale_image,
 							 const PDM& pdm, const cv::Vec6f& params_global, const cv::Mat_<float>& params_local, int window_size, int scale);
 
+	// What is shared by the landmarks when computing the patch expert responses of a model instance
+	struct ResponseContext
+	{
+		int view_id;
+		int window_size;
+		int scale;
+
+		// The landmark locations around which the responses are computed
+		cv::Mat_<float> landmark_locations;
+
+		// The rotation and scaling from the reference frame to the image
+		float a1;
+		float b1;
+
+		// CEN interpolation matrix
+		cv::Mat_<float> interp_mat;
+
+		// Only the visible landmarks have responses
+		std::vector<int> visible_landmarks;
+	};
+
+	// The response computation split into two steps, so that responses of several models (e.g. several faces in a frame) can be computed in one parallel loop.
+	// PrepareResponse is called once per model instance and then LandmarkResponse for every one of the visible landmarks (can be done in parallel).
+	void PrepareResponse(ResponseContext& context, cv::Matx22f& sim_ref_to_img, cv::Matx22f& sim_img_to_ref, const PDM& pdm, const cv::Vec6f& params_global,
+		const cv::Mat_<float>& params_local, int window_size, int scale);
+	void LandmarkResponse(std::vector<cv::Mat_<float> >& patch_expert_responses, const ResponseContext& context, const cv::Mat_<float>& grayscale_image, int landmark);
+
 	// Getting the best view associated with the current orientation
 	int GetViewIdx(const cv::Vec6f& params_global, int scale) const;
 
@@ -0,0 +1,62 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2017, Carnegie Mellon University and University of Cambridge,
+// all rights reserved.
+//
+// ACADEMIC OR NON-PROFIT ORGANIZATION NONCOMMERCIAL RESEARCH USE ONLY
+//
+// BY USING OR DOWNLOADING THE SOFTWARE, YOU ARE AGREEING TO THE TERMS OF THIS LICENSE AGREEMENT.  
+// IF YOU DO NOT AGREE WITH THESE TERMS, YOU MAY NOT USE OR DOWNLOAD THE SOFTWARE.
+//
+// License can be found in OpenFace-license.txt
+//
+//     * Any publications arising from the use of this software, including but
+//       not limited to academic journal and conference publications, technical
+//       reports and manuals, must cite at least one of the following works:
+//
+//       OpenFace 2.0: Facial Behavior Analysis Toolkit
+//       Tadas Baltruaitis, Amir Zadeh, Yao Chong Lim, and Louis-Philippe Morency
+//       in IEEE International Conference on Automatic Face and Gesture Recognition, 2018  
+//
+//       Convolutional experts constrained local model for facial landmark detection.
+//       A. Zadeh, T. Baltruaitis, and Louis-Philippe Morency,
+//       in Computer Vision and Pattern Recognition Workshops, 2017.    
+//
+//       Rendering of Eyes for Eye-Shape Registration and Gaze Estimation
+//       Erroll Wood, Tadas Baltruaitis, Xucong Zhang, Yusuke Sugano, Peter Robinson, and Andreas Bulling 
+//       in IEEE International. Conference on Computer Vision (ICCV),  2015 
+//
+//       Cross-dataset learning and person-specific normalisation for automatic Action Unit detection
+//       Tadas Baltruaitis, Marwa Mahmoud, and Peter Robinson 
+//       in Facial Expression Recognition and Analysis Challenge, 
+//       IEEE International Conference on Automatic Face and Gesture Recognition, 2015 
+//
+
+#ifndef RLMS_SOLVER_H
+#define RLMS_SOLVER_H
+
+// OpenCV includes
+#include <opencv2/core/core.hpp>
+
+#include "PDM.h"
+
+namespace LandmarkDetector
+{
+	//===========================================================================
+	// A fixed size NU-RLMS update step for the common model sizes (68 point face models, 51 point inner face model and 28 point eye models).
+	// The Jacobian is never formed, instead J^T W J and J^T W v are accumulated point by point on the stack using the diagonal of the weight matrix,
+	// and the resulting system is solved with a Cholesky decomposition of fixed size.
+
+	// Is there a fixed size solver for a model with n points and m modes (m = 0 for the rigid step)
+	bool HasFixedRLMSSolver(int n, int m);
+
+	// Computes the parameter update of one NU-RLMS iteration, same as solving (J^T W J + R) dp = J^T W v - R p in CLNF::NU_RLMS
+	// weights - the diagonal of the weight matrix (n x 1, the same weight is used for x and y)
+	// mean_shifts - the mean shifts in image space (2n x 1)
+	// visibilities - the landmarks with 0 visibility are ignored (n x 1)
+	// regularisation - the regularisation of non-rigid parameters (m x 1), ignored for the rigid step
+	// Returns false if there is no fixed size solver or if the Hessian is not positive definite, in which case the generic solver should be used
+	bool SolveRLMSFixed(const PDM& pdm, const cv::Mat_<float>& params_local, const cv::Vec6f& params_global, const cv::Mat_<float>& weights,
+		const cv::Mat_<float>& mean_shifts, const cv::Mat_<int>& visibilities, const cv::Mat_<float>& regularisation, bool rigid, cv::Mat_<float>& param_update);
+
+}
+#endif // RLMS_SOLVER_H
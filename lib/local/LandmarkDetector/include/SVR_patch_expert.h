@@ -82,6 +82,13 @@ class SVR_patch_expert{
 		void Response(const cv::Mat_<float> &area_of_interest, cv::Mat_<float> &response);
 		void ResponseDepth(const cv::Mat_<float> &area_of_interest, cv::Mat_<float> &response);
 
+		// Response computation from an already prepared (normalised or gradient) area of interest, the DFT and integral images of the area
+		// are computed on first use and can be shared between patch experts of the same type and size so they don't get recalculated
+		void Response(const cv::Mat_<float> &prepared_area, cv::Mat_<double> &area_dft, cv::Mat &integral_img, cv::Mat &integral_img_sq, cv::Mat_<float> &response);
+
+		// Preparing the area of interest for a patch expert of a particular type (0=raw normalised, 1=grad)
+		static void PrepareArea(const cv::Mat_<float> &area_of_interest, int type, cv::Mat_<float> &prepared_area);
+
 };
 //===========================================================================
 /**
@@ -0,0 +1,142 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2017, Carnegie Mellon University and University of Cambridge,
+// all rights reserved.
+//
+// ACADEMIC OR NON-PROFIT ORGANIZATION NONCOMMERCIAL RESEARCH USE ONLY
+//
+// BY USING OR DOWNLOADING THE SOFTWARE, YOU ARE AGREEING TO THE TERMS OF THIS LICENSE AGREEMENT.  
+// IF YOU DO NOT AGREE WITH THESE TERMS, YOU MAY NOT USE OR DOWNLOAD THE SOFTWARE.
+//
+// License can be found in OpenFace-license.txt
+//
+//     * Any publications arising from the use of this software, including but
+//       not limited to academic journal and conference publications, technical
+//       reports and manuals, must cite at least one of the following works:
+//
+//       OpenFace 2.0: Facial Behavior Analysis Toolkit
+//       Tadas Baltruaitis, Amir Zadeh, Yao Chong Lim, and Louis-Philippe Morency
+//       in IEEE International Conference on Automatic Face and Gesture Recognition, 2018  
+//
+//       Convolutional experts constrained local model for facial landmark detection.
+//       A. Zadeh, T. Baltruaitis, and Louis-Philippe Morency,
+//       in Computer Vision and Pattern Recognition Workshops, 2017.    
+//
+//       Rendering of Eyes for Eye-Shape Registration and Gaze Estimation
+//       Erroll Wood, Tadas Baltruaitis, Xucong Zhang, Yusuke Sugano, Peter Robinson, and Andreas Bulling 
+//       in IEEE International. Conference on Computer Vision (ICCV),  2015 
+//
+//       Cross-dataset learning and person-specific normalisation for automatic Action Unit detection
+//       Tadas Baltruaitis, Marwa Mahmoud, and Peter Robinson 
+//       in Facial Expression Recognition and Analysis Challenge, 
+//       IEEE International Conference on Automatic Face and Gesture Recognition, 2015 
+//
+
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+// OpenCV includes
+#include <opencv2/core/core.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace LandmarkDetector
+{
+	//===========================================================================
+	/**
+	The library wide work-stealing task scheduler used by all of the parallel loops of landmark detection (patch expert responses, several faces,
+	hierarchical models). Each worker thread has its own queue of parallel loop chunks and steals from the others when it runs out of work. A thread
+	waiting for its parallel loop to finish keeps executing other chunks for a while, so nested parallel loops (e.g. the eye models inside the
+	hierarchical refinement inside fitting several faces) compose without creating new threads, and blocks once there is nothing left to help with.
+	The tasks started with Async are kept in separate queues that only the worker threads and the threads waiting for an Async task take from, so they
+	never run inside the wait of a parallel loop.
+	An exception thrown by a task is rethrown on the thread that waits for it.
+	*/
+	class TaskScheduler
+	{
+	public:
+
+		// Set the number of threads used by the library including the calling thread (0 for one per hardware thread, 1 to run everything on the calling thread),
+		// optionally pinning the worker threads to consecutive cores starting from first_core (-1 for no pinning). Should not be called while parallel loops are running.
+		static void Configure(int num_threads, int first_core = -1);
+
+		// The number of threads used by the library including the calling thread
+		static int NumThreads();
+
+		// Runs body over the range split into chunks, the calling thread takes part in the work and the call returns once all of the range is done (same as cv::parallel_for_),
+		// if the body throws on any of the threads the remaining chunks are skipped and the first exception is rethrown here
+		static void ParallelFor(const cv::Range& range, const std::function<void(const cv::Range&)>& body);
+
+		// Runs the task in the background on one of the worker threads (or right away on the calling thread if there are no workers), the returned future
+		// becomes ready when the task is done. A long running background task (e.g. face detection) is only picked up by idle workers (or by a thread waiting
+		// for an Async task when no worker got to it), never by a thread waiting for its own parallel loop, so that it does not hold up the frame being tracked
+		static std::shared_future<void> Async(const std::function<void()>& task, bool background = false);
+
+		// Waits for a task started with Async to finish, the waiting thread helps with the parallel loops and the queued Async tasks for a while and then
+		// blocks, rethrows the exception thrown by the task if there was one
+		static void Wait(const std::shared_future<void>& task);
+
+		// Has a task started with Async finished (also true if no task was started), does not wait
+		static bool Done(const std::shared_future<void>& task);
+
+		~TaskScheduler();
+
+	private:
+
+		TaskScheduler();
+
+		static TaskScheduler& Instance();
+
+		void Start(int num_threads, int first_core);
+		void Stop();
+
+		struct WorkerQueue
+		{
+			std::mutex mutex;
+			std::deque<std::function<void()> > tasks;
+		};
+
+		// Adds a parallel loop chunk task to the queue of the current worker (or to one of the workers if called from outside of the scheduler)
+		void Push(const std::function<void()>& task);
+
+		// Adds a task to one of the queues shared by all of the workers
+		void PushShared(WorkerQueue& queue, const std::function<void()>& task);
+
+		// Runs a task from the worker's own queue or one stolen from another worker, returns false if there was nothing to run
+		bool RunTask(int worker);
+
+		// Runs the oldest task of a shared queue, returns false if there was nothing to run
+		bool RunSharedTask(WorkerQueue& queue);
+
+		void WorkerLoop(int worker, int core);
+
+		std::vector<std::unique_ptr<WorkerQueue> > queues;
+
+		// The tasks started with Async, only taken by the worker loops (the background ones only once there is nothing else to do)
+		WorkerQueue async_queue;
+		WorkerQueue background_queue;
+		std::vector<std::thread> threads;
+
+		// Used to wake up the idle workers when tasks are added
+		std::mutex wake_mutex;
+		std::condition_variable wake;
+		std::atomic<int> pending_tasks;
+		std::atomic<unsigned int> next_queue;
+		bool stopping;
+
+		std::mutex configure_mutex;
+
+		// The index of the worker running on the current thread (-1 if it is not a worker thread)
+		static thread_local int current_worker;
+	};
+	//===========================================================================
+}
+#endif // TASK_SCHEDULER_H
@@ -158,6 +158,62 @@ namespace LandmarkDetector
 	}
 
 
+	void fully_connected_batch(std::vector<std::vector<cv::Mat_<float> > >& outputs, const std::vector<std::vector<cv::Mat_<float> > >& input_maps, cv::Mat_<float> weights, cv::Mat_<float> biases)
+	{
+		int num_inputs = (int)input_maps.size();
+		outputs.assign(num_inputs, std::vector<cv::Mat_<float> >());
+
+		if (num_inputs == 0)
+		{
+			return;
+		}
+
+		int num_maps = (int)input_maps[0].size();
+
+		// Separate feature maps are not flattened, so they are done one input at a time
+		if (num_maps > 1 && num_maps == weights.cols)
+		{
+			for (int i = 0; i < num_inputs; ++i)
+			{
+				fully_connected(outputs[i], input_maps[i], weights, biases);
+			}
+			return;
+		}
+
+		// Every input flattened to a column (in the same order as fully_connected does it)
+		cv::Mat_<float> input_concat(weights.cols, num_inputs);
+		for (int i = 0; i < num_inputs; ++i)
+		{
+			if (num_maps > 1)
+			{
+				int map_size = input_maps[i][0].rows * input_maps[i][0].cols;
+				for (int in = 0; in < num_maps; ++in)
+				{
+					cv::Mat_<float> add = input_maps[i][in].t();
+					add.reshape(0, map_size).copyTo(input_concat(cv::Rect(i, in * map_size, 1, map_size)));
+				}
+			}
+			else
+			{
+				input_maps[i][0].copyTo(input_concat.col(i));
+			}
+		}
+
+		cv::Mat_<float> out = weights * input_concat + cv::repeat(biases, 1, num_inputs);
+
+		for (int i = 0; i < num_inputs; ++i)
+		{
+			if (num_maps > 1)
+			{
+				outputs[i].push_back(out.col(i).clone());
+			}
+			else
+			{
+				outputs[i].push_back(cv::Mat_<float>(out.col(i).t()));
+			}
+		}
+	}
+
 	void max_pooling(std::vector<cv::Mat_<float> >& outputs, const std::vector<cv::Mat_<float> >& input_maps, int stride_x, int stride_y, int kernel_size_x, int kernel_size_y)
 	{
 		std::vector<cv::Mat_<float> > outputs_sub;
@@ -539,5 +595,60 @@ namespace LandmarkDetector
 	
 	}
 
+	void convolution_direct_blas_batch(std::vector<std::vector<cv::Mat_<float> > >& outputs, const std::vector<std::vector<cv::Mat_<float> > >& input_maps, const cv::Mat_<float>& weight_matrix, int height_k, int width_k, cv::Mat_<float>& pre_alloc_im2col)
+	{
+		int num_inputs = (int)input_maps.size();
+		outputs.assign(num_inputs, std::vector<cv::Mat_<float> >());
+
+		if (num_inputs == 0)
+		{
+			return;
+		}
+
+		int height_in = input_maps[0][0].rows;
+		int width_n = input_maps[0][0].cols;
+
+		// determine how many blocks there will be with a sliding window of width x height in the input
+		int yB = height_in - height_k + 1;
+		int xB = width_n - width_k + 1;
+		int num_rows = yB * xB;
+		int num_rows_all = num_rows * num_inputs;
+
+		// The im2col of every input takes up its own block of rows (the last column is the bias term)
+		int im2col_cols = width_k * height_k * (int)input_maps[0].size() + 1;
+		if (pre_alloc_im2col.cols != im2col_cols || pre_alloc_im2col.rows < num_rows_all)
+		{
+			pre_alloc_im2col = cv::Mat::ones(num_rows_all, im2col_cols, CV_32F);
+		}
+
+		for (int i = 0; i < num_inputs; ++i)
+		{
+			cv::Mat_<float> im2col_block = pre_alloc_im2col.rowRange(i * num_rows, (i + 1) * num_rows);
+			im2col_multimap(input_maps[i], width_k, height_k, im2col_block);
+		}
+
+		float* m1 = (float*)pre_alloc_im2col.data;
+		float* m2 = (float*)weight_matrix.data;
+		int m2_cols = weight_matrix.cols;
+
+		cv::Mat_<float> out(num_rows_all, weight_matrix.cols, 1.0);
+		float* m3 = (float*)out.data;
+
+		float alpha = 1.0f;
+		float beta = 0.0f;
+		char N[2]; N[0] = 'N';
+		sgemm_(N, N, &m2_cols, &num_rows_all, &pre_alloc_im2col.cols, &alpha, m2, &m2_cols, m1, &pre_alloc_im2col.cols, &beta, m3, &m2_cols);
+
+		// Above is equivalent to out = pre_alloc_im2col * weight_matrix, split it back into the outputs of every input
+		for (int i = 0; i < num_inputs; ++i)
+		{
+			cv::Mat_<float> out_input = out.rowRange(i * num_rows, (i + 1) * num_rows).t();
+
+			for (int k = 0; k < out_input.rows; ++k)
+			{
+				outputs[i].push_back(out_input.row(k).reshape(1, yB));
+			}
+		}
+	}
 
 }
@@ -0,0 +1,137 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2017, Carnegie Mellon University and University of Cambridge,
+// all rights reserved.
+//
+// ACADEMIC OR NON-PROFIT ORGANIZATION NONCOMMERCIAL RESEARCH USE ONLY
+//
+// BY USING OR DOWNLOADING THE SOFTWARE, YOU ARE AGREEING TO THE TERMS OF THIS LICENSE AGREEMENT.  
+// IF YOU DO NOT AGREE WITH THESE TERMS, YOU MAY NOT USE OR DOWNLOAD THE SOFTWARE.
+//
+// License can be found in OpenFace-license.txt
+//
+//     * Any publications arising from the use of this software, including but
+//       not limited to academic journal and conference publications, technical
+//       reports and manuals, must cite at least one of the following works:
+//
+//       OpenFace 2.0: Facial Behavior Analysis Toolkit
+//       Tadas Baltruaitis, Amir Zadeh, Yao Chong Lim, and Louis-Philippe Morency
+//       in IEEE International Conference on Automatic Face and Gesture Recognition, 2018  
+//
+//       Convolutional experts constrained local model for facial landmark detection.
+//       A. Zadeh, T. Baltruaitis, and Louis-Philippe Morency,
+//       in Computer Vision and Pattern Recognition Workshops, 2017.    
+//
+//       Rendering of Eyes for Eye-Shape Registration and Gaze Estimation
+//       Erroll Wood, Tadas Baltruaitis, Xucong Zhang, Yusuke Sugano, Peter Robinson, and Andreas Bulling 
+//       in IEEE International. Conference on Computer Vision (ICCV),  2015 
+//
+//       Cross-dataset learning and person-specific normalisation for automatic Action Unit detection
+//       Tadas Baltruaitis, Marwa Mahmoud, and Peter Robinson 
+//       in Facial Expression Recognition and Analysis Challenge, 
+//       IEEE International Conference on Automatic Face and Gesture Recognition, 2015 
+//
+
+#include "stdafx.h"
+
+#include <FaceFrameResult.h>
+#include <LandmarkDetectorFunc.h>
+#include <LandmarkDetectorUtils.h>
+
+using namespace LandmarkDetector;
+
+FaceFrameResult::FaceFrameResult(const CLNF& clnf_model, float fx, float fy, float cx, float cy) : clnf_model(clnf_model), fx(fx), fy(fy), cx(cx), cy(cy),
+	pose_computed(false), shape_computed(false), eye_shapes_computed(false), eye_landmarks_2D_computed(false), eye_landmarks_3D_computed(false),
+	gaze_computed(false), gaze_direction0(0, 0, -1), gaze_direction1(0, 0, -1), gaze_angle(0, 0)
+{
+}
+
+const cv::Vec6f& FaceFrameResult::GetPose()
+{
+	if (!pose_computed)
+	{
+		pose = LandmarkDetector::GetPose(clnf_model, fx, fy, cx, cy);
+		pose_computed = true;
+	}
+	return pose;
+}
+
+const cv::Mat_<float>& FaceFrameResult::GetShape3D()
+{
+	if (!shape_computed)
+	{
+		shape_3D = clnf_model.GetShape(fx, fy, cx, cy);
+		shape_computed = true;
+	}
+	return shape_3D;
+}
+
+void FaceFrameResult::ComputeEyeShapes()
+{
+	if (eye_shapes_computed)
+		return;
+
+	for (size_t i = 0; i < clnf_model.hierarchical_models.size(); ++i)
+	{
+		if (clnf_model.hierarchical_model_names[i].compare("left_eye_28") == 0)
+		{
+			left_eye_shape_3D = clnf_model.hierarchical_models[i].GetShape(fx, fy, cx, cy);
+		}
+		else if (clnf_model.hierarchical_model_names[i].compare("right_eye_28") == 0)
+		{
+			right_eye_shape_3D = clnf_model.hierarchical_models[i].GetShape(fx, fy, cx, cy);
+		}
+	}
+	eye_shapes_computed = true;
+}
+
+const cv::Mat_<float>& FaceFrameResult::GetEyeShape3D(bool left_eye)
+{
+	ComputeEyeShapes();
+	return left_eye ? left_eye_shape_3D : right_eye_shape_3D;
+}
+
+const std::vector<cv::Point2f>& FaceFrameResult::GetEyeLandmarks2D()
+{
+	if (!eye_landmarks_2D_computed)
+	{
+		eye_landmarks_2D = CalculateAllEyeLandmarks(clnf_model);
+		eye_landmarks_2D_computed = true;
+	}
+	return eye_landmarks_2D;
+}
+
+const std::vector<cv::Point3f>& FaceFrameResult::GetEyeLandmarks3D()
+{
+	if (!eye_landmarks_3D_computed)
+	{
+		ComputeEyeShapes();
+
+		// In the order of the hierarchical models, as in Calculate3DEyeLandmarks
+		eye_landmarks_3D.clear();
+		for (size_t i = 0; i < clnf_model.hierarchical_models.size(); ++i)
+		{
+			const cv::Mat_<float>* lmks = nullptr;
+			if (clnf_model.hierarchical_model_names[i].compare("left_eye_28") == 0)
+				lmks = &left_eye_shape_3D;
+			else if (clnf_model.hierarchical_model_names[i].compare("right_eye_28") == 0)
+				lmks = &right_eye_shape_3D;
+			else
+				continue;
+
+			for (int lmk = 0; lmk < lmks->cols; ++lmk)
+			{
+				eye_landmarks_3D.push_back(cv::Point3f(lmks->at<float>(0, lmk), lmks->at<float>(1, lmk), lmks->at<float>(2, lmk)));
+			}
+		}
+		eye_landmarks_3D_computed = true;
+	}
+	return eye_landmarks_3D;
+}
+
+void FaceFrameResult::SetGaze(const cv::Point3f& gaze_direction0, const cv::Point3f& gaze_direction1, const cv::Vec2f& gaze_angle)
+{
+	this->gaze_direction0 = gaze_direction0;
+	this->gaze_direction1 = gaze_direction1;
+	this->gaze_angle = gaze_angle;
+	gaze_computed = true;
+}
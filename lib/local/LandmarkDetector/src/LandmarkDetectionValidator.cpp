@@ -57,7 +57,7 @@
 using namespace LandmarkDetector;
 
 // Copy constructor
-DetectionValidator::DetectionValidator(const DetectionValidator& other) : orientations(other.orientations), paws(other.paws),
+DetectionValidator::DetectionValidator(const DetectionValidator& other) : location(other.location), orientations(other.orientations), paws(other.paws),
 cnn_subsampling_layers(other.cnn_subsampling_layers), cnn_layer_types(other.cnn_layer_types), cnn_convolutional_layers_im2col_precomp(other.cnn_convolutional_layers_im2col_precomp),
 cnn_convolutional_layers_weights(other.cnn_convolutional_layers_weights)
 {
@@ -129,6 +129,7 @@ cnn_convolutional_layers_weights(other.cnn_convolutional_layers_weights)
 // Read in the landmark detection validation module
 void DetectionValidator::Read(std::string location)
 {
+	this->location = location;
 
 	std::ifstream detection_validator_stream (location, std::ios::in | std::ios::binary);
 	if (detection_validator_stream.is_open())	
@@ -313,12 +314,58 @@ void DetectionValidator::Read(std::string location)
 // Check if the fitting actually succeeded
 float DetectionValidator::Check(const cv::Vec3d& orientation, const cv::Mat_<uchar>& intensity_img, cv::Mat_<float>& detected_landmarks)
 {
+	return Check(std::vector<cv::Vec3d>(1, orientation), intensity_img, std::vector<cv::Mat_<float> >(1, detected_landmarks))[0];
+}
 
-	int id = GetViewId(orientation);
-	
-	// The warped (cropped) image, corresponding to a face lying withing the detected lanmarks
-	cv::Mat_<float> warped;
-	
+std::vector<float> DetectionValidator::Check(const std::vector<cv::Vec3d>& face_orientations, const cv::Mat_<uchar>& intensity_img, const std::vector<cv::Mat_<float> >& detected_landmarks)
+{
+	std::vector<float> certainties(detected_landmarks.size(), 0.0f);
+
+	std::vector<int> view_ids(detected_landmarks.size());
+	for (size_t i = 0; i < detected_landmarks.size(); ++i)
+	{
+		view_ids[i] = GetViewId(face_orientations[i]);
+	}
+
+	for (int view = 0; view < (int)paws.size(); ++view)
+	{
+		// The warped (cropped) images, corresponding to faces lying withing the detected lanmarks
+		std::vector<cv::Mat_<float> > warped_imgs;
+		std::vector<size_t> warped_ids;
+
+		for (size_t i = 0; i < detected_landmarks.size(); ++i)
+		{
+			cv::Mat_<float> warped;
+
+			// If the face is not in the image it is a failure
+			if (view_ids[i] == view && WarpFace(warped, intensity_img, detected_landmarks[i], view))
+			{
+				warped_imgs.push_back(warped);
+				warped_ids.push_back(i);
+			}
+		}
+
+		if (warped_imgs.empty())
+		{
+			continue;
+		}
+
+		// The actual validation step
+		std::vector<double> decisions;
+		CheckCNN(decisions, warped_imgs, view);
+
+		for (size_t k = 0; k < warped_ids.size(); ++k)
+		{
+			// Convert it to a more interpretable signal (0 low confidence, 1 high confidence)
+			certainties[warped_ids[k]] = (float)(0.5 * (1.0 - decisions[k]));
+		}
+	}
+
+	return certainties;
+}
+
+bool DetectionValidator::WarpFace(cv::Mat_<float>& warped_img, const cv::Mat_<uchar>& intensity_img, const cv::Mat_<float>& detected_landmarks, int view_id)
+{
 	// First only use the ROI of the image of interest
 	cv::Mat_<float> detected_landmarks_local = detected_landmarks.clone();
 
@@ -344,110 +391,119 @@ float DetectionValidator::Check(const cv::Vec3d& orientation, const cv::Mat_<uch
 	// If the ROI is non existent return failure (this could happen if all landmarks are outside of the image)
 	if (max_x - min_x <= 1 || max_y - min_y <= 1)
 	{
-		return 0.0f;
+		return false;
 	}
 
 	cv::Mat_<float> intensity_img_float_local;
 	intensity_img(cv::Rect(min_x, min_y, max_x - min_x, max_y - min_y)).convertTo(intensity_img_float_local, CV_32F);
 
 	// the piece-wise affine image warping
-	paws[id].Warp(intensity_img_float_local, warped, detected_landmarks_local);
-
-	// The actual validation step
-	double dec = CheckCNN(warped, id);
+	paws[view_id].Warp(intensity_img_float_local, warped_img, detected_landmarks_local);
 
-	// Convert it to a more interpretable signal (0 low confidence, 1 high confidence)
-	dec = 0.5 * (1.0 - dec);
-
-	return (float)dec;
+	return true;
 }
 
-double DetectionValidator::CheckCNN(const cv::Mat_<float>& warped_img, int view_id)
+void DetectionValidator::CheckCNN(std::vector<double>& decisions, const std::vector<cv::Mat_<float> >& warped_imgs, int view_id)
 {
+	int num_imgs = (int)warped_imgs.size();
 
-	cv::Mat_<float> feature_vec;
-	NormaliseWarpedToVector(warped_img, feature_vec, view_id);
-
-	// Create a normalised image from the crop vector
-	cv::Mat_<float> img(warped_img.size(), 0.0);
-	img = img.t();
+	// The maps of every image (image -> maps)
+	std::vector<std::vector<cv::Mat_<float> > > input_maps(num_imgs);
+	std::vector<std::vector<cv::Mat_<float> > > outputs(num_imgs);
 
 	cv::Mat mask = paws[view_id].pixel_mask.t();
-	cv::MatIterator_<uchar>  mask_it = mask.begin<uchar>();
 
-	cv::MatIterator_<float> feature_it = feature_vec.begin();
-	cv::MatIterator_<float> img_it = img.begin();
+	for (int n = 0; n < num_imgs; ++n)
+	{
+		cv::Mat_<float> feature_vec;
+		NormaliseWarpedToVector(warped_imgs[n], feature_vec, view_id);
+
+		// Create a normalised image from the crop vector
+		cv::Mat_<float> img(warped_imgs[n].size(), 0.0);
+		img = img.t();
 
-	int wInt = img.cols;
-	int hInt = img.rows;
+		cv::MatIterator_<uchar>  mask_it = mask.begin<uchar>();
 
-	for (int i = 0; i < wInt; ++i)
-	{
-		for (int j = 0; j < hInt; ++j, ++mask_it, ++img_it)
+		cv::MatIterator_<float> feature_it = feature_vec.begin();
+		cv::MatIterator_<float> img_it = img.begin();
+
+		int wInt = img.cols;
+		int hInt = img.rows;
+
+		for (int i = 0; i < wInt; ++i)
 		{
-			// if is within mask
-			if (*mask_it)
+			for (int j = 0; j < hInt; ++j, ++mask_it, ++img_it)
 			{
-				// assign the feature to image if it is within the mask
-				*img_it = (float)*feature_it++;
+				// if is within mask
+				if (*mask_it)
+				{
+					// assign the feature to image if it is within the mask
+					*img_it = (float)*feature_it++;
+				}
 			}
 		}
+		img = img.t();
+
+		input_maps[n].push_back(img);
 	}
-	img = img.t();
 
 	int cnn_layer = 0;
 	int fully_connected_layer = 0;
 
-	std::vector<cv::Mat_<float> > input_maps;
-	input_maps.push_back(img);
-
-	std::vector<cv::Mat_<float> > outputs;
-
 	for (size_t layer = 0; layer < cnn_layer_types[view_id].size(); ++layer)
 	{
 		// Determine layer type
 		int layer_type = cnn_layer_types[view_id][layer];
 
-		// Convolutional layer
+		// Convolutional layer, done for all of the images with one matrix multiplication
 		if (layer_type == 0)
 		{
 
-			convolution_direct_blas(outputs, input_maps, cnn_convolutional_layers_weights[view_id][cnn_layer], cnn_convolutional_layers[view_id][cnn_layer][0][0].rows, cnn_convolutional_layers[view_id][cnn_layer][0][0].cols, cnn_convolutional_layers_im2col_precomp[view_id][cnn_layer]);
+			convolution_direct_blas_batch(outputs, input_maps, cnn_convolutional_layers_weights[view_id][cnn_layer], cnn_convolutional_layers[view_id][cnn_layer][0][0].rows, cnn_convolutional_layers[view_id][cnn_layer][0][0].cols, cnn_convolutional_layers_im2col_precomp[view_id][cnn_layer]);
 
 			cnn_layer++;
 		}
 		if (layer_type == 1)
 		{
-			max_pooling(outputs, input_maps, 2, 2, 2, 2);
+			for (int n = 0; n < num_imgs; ++n)
+			{
+				max_pooling(outputs[n], input_maps[n], 2, 2, 2, 2);
+			}
 		}
 		if (layer_type == 2)
 		{
 
-			fully_connected(outputs, input_maps, cnn_fully_connected_layers_weights[view_id][fully_connected_layer].t(), cnn_fully_connected_layers_biases[view_id][fully_connected_layer]);
+			fully_connected_batch(outputs, input_maps, cnn_fully_connected_layers_weights[view_id][fully_connected_layer].t(), cnn_fully_connected_layers_biases[view_id][fully_connected_layer]);
 			fully_connected_layer++;
 		}
 		if (layer_type == 3) // ReLU
 		{
-			outputs.clear();
-			for (size_t k = 0; k < input_maps.size(); ++k)
+			for (int n = 0; n < num_imgs; ++n)
 			{
-				// Apply the ReLU
-				cv::threshold(input_maps[k], input_maps[k], 0, 0, cv::THRESH_TOZERO);
-				outputs.push_back(input_maps[k]);
+				outputs[n].clear();
+				for (size_t k = 0; k < input_maps[n].size(); ++k)
+				{
+					// Apply the ReLU
+					cv::threshold(input_maps[n][k], input_maps[n][k], 0, 0, cv::THRESH_TOZERO);
+					outputs[n].push_back(input_maps[n][k]);
 
+				}
 			}
 		}
 		if (layer_type == 4)
 		{
-			outputs.clear();
-			for (size_t k = 0; k < input_maps.size(); ++k)
+			for (int n = 0; n < num_imgs; ++n)
 			{
-				// Apply the sigmoid
-				cv::exp(-input_maps[k], input_maps[k]);
-				input_maps[k] = 1.0 / (1.0 + input_maps[k]);
+				outputs[n].clear();
+				for (size_t k = 0; k < input_maps[n].size(); ++k)
+				{
+					// Apply the sigmoid
+					cv::exp(-input_maps[n][k], input_maps[n][k]);
+					input_maps[n][k] = 1.0 / (1.0 + input_maps[n][k]);
 
-				outputs.push_back(input_maps[k]);
+					outputs[n].push_back(input_maps[n][k]);
 
+				}
 			}
 		}
 		// Set the outputs of this layer to inputs of the next
@@ -455,19 +511,21 @@ double DetectionValidator::CheckCNN(const cv::Mat_<float>& warped_img, int view_
 
 	}
 
-	// Convert the class label to a continuous value
-	double max_val = 0;
-	cv::Point max_loc;
-	cv::minMaxLoc(outputs[0].t(), 0, &max_val, 0, &max_loc);
-	int max_idx = max_loc.y;
-	double max = 1;
-	double min = -1;
-	double bins = (double)outputs[0].cols;
-	// Unquantizing the softmax layer to continuous value
-	double step_size = (max - min) / bins; // This should be saved somewhere
-	double unquantized = min + step_size / 2.0 + max_idx * step_size;
-
-	return unquantized;
+	decisions.resize(num_imgs);
+	for (int n = 0; n < num_imgs; ++n)
+	{
+		// Convert the class label to a continuous value
+		double max_val = 0;
+		cv::Point max_loc;
+		cv::minMaxLoc(outputs[n][0].t(), 0, &max_val, 0, &max_loc);
+		int max_idx = max_loc.y;
+		double max = 1;
+		double min = -1;
+		double bins = (double)outputs[n][0].cols;
+		// Unquantizing the softmax layer to continuous value
+		double step_size = (max - min) / bins; // This should be saved somewhere
+		decisions[n] = min + step_size / 2.0 + max_idx * step_size;
+	}
 }
 
 void DetectionValidator::NormaliseWarpedToVector(const cv::Mat_<float>& warped_img, cv::Mat_<float>& feature_vec, int view_id)
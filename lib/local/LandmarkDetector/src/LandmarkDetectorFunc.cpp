@@ -154,8 +154,13 @@ cv::Vec6f LandmarkDetector::GetPoseWRTCamera(const CLNF& clnf_model, float fx, f
 	}
 }
 
-// If landmark detection in video succeeded create a template for use in simple tracking
-void UpdateTemplate(const cv::Mat_<uchar> &grayscale_image, CLNF& clnf_model)
+// The template pyramid has at most this many coarser levels, and the coarsest template is kept at least this big so it can still be matched reliably
+#define TEMPLATE_PYRAMID_LEVELS 3
+#define TEMPLATE_MIN_SIZE 12
+
+// If landmark detection in video succeeded create a template for use in simple tracking, the template is stored at the resolution it is matched at
+// together with a pyramid of coarser levels, and it is only refreshed when the appearance (or size) of the face changed
+void UpdateTemplate(const cv::Mat_<uchar> &grayscale_image, CLNF& clnf_model, const FaceModelParameters& params)
 {
 	cv::Rect_<float> bounding_box;
 	clnf_model.pdm.CalcBoundingBox(bounding_box, clnf_model.params_global, clnf_model.params_local);
@@ -164,11 +169,56 @@ void UpdateTemplate(const cv::Mat_<uchar> &grayscale_image, CLNF& clnf_model)
 	cv::Rect_<int> bbox_tmp((int)bounding_box.x, (int)bounding_box.y, (int)bounding_box.width, (int)bounding_box.height);
 	bounding_box = bbox_tmp & cv::Rect(0, 0, grayscale_image.cols, grayscale_image.rows);
 
-	clnf_model.face_template = grayscale_image(bounding_box).clone();
+	if (bounding_box.width < 1 || bounding_box.height < 1)
+	{
+		return;
+	}
+
+	float scaling = std::min(1.0f, params.face_template_scale / clnf_model.params_global[0]);
+
+	cv::Mat_<uchar> face;
+	if (scaling < 1)
+	{
+		cv::resize(grayscale_image(bounding_box), face, cv::Size(), scaling, scaling);
+	}
+	else
+	{
+		face = grayscale_image(bounding_box).clone();
+	}
+
+	// Keep the current template if the face still looks the same and is of a similar size
+	if (!clnf_model.face_template.empty() && std::abs(face.cols - clnf_model.face_template.cols) <= 0.1 * clnf_model.face_template.cols &&
+		std::abs(face.rows - clnf_model.face_template.rows) <= 0.1 * clnf_model.face_template.rows)
+	{
+		cv::Mat_<uchar> face_resized;
+		cv::resize(face, face_resized, clnf_model.face_template.size());
+
+		cv::Mat_<float> similarity;
+		cv::matchTemplate(face_resized, clnf_model.face_template, similarity, cv::TM_CCOEFF_NORMED);
+
+		if (similarity(0, 0) > params.face_template_refresh)
+		{
+			return;
+		}
+	}
+
+	clnf_model.face_template = face;
+	clnf_model.face_template_scaling = scaling;
+
+	clnf_model.face_template_pyramid.clear();
+	cv::Mat_<uchar> level = face;
+	while (clnf_model.face_template_pyramid.size() < TEMPLATE_PYRAMID_LEVELS && std::min(level.rows, level.cols) >= 2 * TEMPLATE_MIN_SIZE)
+	{
+		cv::Mat_<uchar> coarser_level;
+		cv::pyrDown(level, coarser_level);
+		clnf_model.face_template_pyramid.push_back(coarser_level);
+		level = coarser_level;
+	}
 }
 
-// This method uses basic template matching in order to allow for better tracking of fast moving faces
-void CorrectGlobalParametersVideo(const cv::Mat_<uchar> &grayscale_image, CLNF& clnf_model, const FaceModelParameters& params)
+// This method uses basic template matching in order to allow for better tracking of fast moving faces, the template is found in the coarsest
+// level of the image pyramid first and then refined in a small neighbourhood at the finer levels
+void CorrectGlobalParametersVideo(const cv::Mat_<uchar> &grayscale_image, CLNF& clnf_model)
 {
 	cv::Rect_<float> init_box;
 	clnf_model.pdm.CalcBoundingBox(init_box, clnf_model.params_global, clnf_model.params_local);
@@ -179,201 +229,307 @@ void CorrectGlobalParametersVideo(const cv::Mat_<uchar> &grayscale_image, CLNF&
 	int off_x = roi.x;
 	int off_y = roi.y;
 
-	float scaling = params.face_template_scale / clnf_model.params_global[0];
+	// The search area at the resolution of the template
+	float scaling = clnf_model.face_template_scaling;
 	cv::Mat_<uchar> image;
 	if(scaling < 1)
 	{
-		cv::resize(clnf_model.face_template, clnf_model.face_template, cv::Size(), scaling, scaling);
 		cv::resize(grayscale_image(roi), image, cv::Size(), scaling, scaling);
 	}
 	else
 	{
-		scaling = 1;
-		image = grayscale_image(roi).clone();
+		image = grayscale_image(roi);
 	}
-		
-	// Resizing the template			
+
+	// The template and the search area at every level of the pyramid (finest first), as long as the template still fits in the search area
+	std::vector<cv::Mat_<uchar> > templates(1, clnf_model.face_template);
+	std::vector<cv::Mat_<uchar> > images(1, image);
+
+	if (image.rows < templates[0].rows || image.cols < templates[0].cols)
+	{
+		return;
+	}
+
+	for (size_t level = 0; level < clnf_model.face_template_pyramid.size(); ++level)
+	{
+		cv::Mat_<uchar> coarser_image;
+		cv::pyrDown(images.back(), coarser_image);
+
+		const cv::Mat_<uchar>& coarser_template = clnf_model.face_template_pyramid[level];
+		if (coarser_image.rows < coarser_template.rows || coarser_image.cols < coarser_template.cols)
+		{
+			break;
+		}
+
+		templates.push_back(coarser_template);
+		images.push_back(coarser_image);
+	}
+
+	// Search the whole area at the coarsest level
 	cv::Mat corr_out;
-	cv::matchTemplate(image, clnf_model.face_template, corr_out, cv::TM_CCOEFF_NORMED);
+	cv::matchTemplate(images.back(), templates.back(), corr_out, cv::TM_CCOEFF_NORMED);
 
-	// Actually matching it
-	//double min, max;
-	int max_loc[2];
+	cv::Point max_loc;
+	cv::minMaxLoc(corr_out, NULL, NULL, NULL, &max_loc);
 
-	cv::minMaxIdx(corr_out, NULL, NULL, NULL, max_loc);
+	// Refine the location at the finer levels
+	const int search_radius = 2;
+	for (int level = (int)images.size() - 2; level >= 0; --level)
+	{
+		cv::Rect search_area(max_loc.x * 2 - search_radius, max_loc.y * 2 - search_radius, templates[level].cols + 2 * search_radius, templates[level].rows + 2 * search_radius);
+		search_area = search_area & cv::Rect(0, 0, images[level].cols, images[level].rows);
 
-	cv::Rect_<float> out_bbox(max_loc[1]/scaling + off_x, max_loc[0]/scaling + off_y, clnf_model.face_template.rows / scaling, clnf_model.face_template.cols / scaling);
+		// Close to the edge of the search area it is easier to search all of it
+		if (search_area.width < templates[level].cols || search_area.height < templates[level].rows)
+		{
+			search_area = cv::Rect(0, 0, images[level].cols, images[level].rows);
+		}
 
-	float shift_x = out_bbox.x - init_box.x;
-	float shift_y = out_bbox.y - init_box.y;
+		cv::matchTemplate(images[level](search_area), templates[level], corr_out, cv::TM_CCOEFF_NORMED);
+		cv::minMaxLoc(corr_out, NULL, NULL, NULL, &max_loc);
+		max_loc += search_area.tl();
+	}
+
+	float shift_x = max_loc.x / scaling + off_x - init_box.x;
+	float shift_y = max_loc.y / scaling + off_y - init_box.y;
 			
 	clnf_model.params_global[4] = clnf_model.params_global[4] + shift_x;
 	clnf_model.params_global[5] = clnf_model.params_global[5] + shift_y;
 	
 }
 
-bool LandmarkDetector::DetectLandmarksInVideo(const cv::Mat &rgb_image, CLNF& clnf_model, FaceModelParameters& params, cv::Mat& grayscale_image)
+// Getting ready to track the landmarks from the previous frame
+void PrepareTracking(const cv::Mat_<uchar>& grayscale_image, CLNF& clnf_model, FaceModelParameters& params)
 {
-	// First need to decide if the landmarks should be "detected" or "tracked"
-	// Detected means running face detection and a larger search area, tracked means initialising from previous step
-	// and using a smaller search area
+	// The parameters are adjusted from the ones refined on the last frame
+	clnf_model.FinishHierarchicalRefinement();
 
-	if(grayscale_image.empty())
+	bool predicted = params.use_motion_model && clnf_model.detection_success && clnf_model.motion_model.HasVelocity();
+
+	// Start from where the face is expected to be on this frame (the shape is kept)
+	if(predicted)
 	{
-		Utilities::ConvertToGrayscale_8bit(rgb_image, grayscale_image);
+		clnf_model.params_global = clnf_model.motion_model.Predict(params.frame_stride);
 	}
 
-	// Indicating that this is a first detection in video sequence or after restart
-	bool initial_detection = !clnf_model.tracking_initialised;
+	// With a smooth motion the prediction is close enough for the small search area even if the frames are further apart
+	bool smooth_motion = predicted && clnf_model.motion_model.LastError() < params.motion_model_max_error;
 
-	// Only do it if there was a face detection at all
-	if(clnf_model.tracking_initialised)
+	// The area of interest search size will depend if the previous track was successful, and on how far apart the frames are
+	if(!clnf_model.detection_success || (params.frame_stride > 1 && !smooth_motion))
 	{
+		params.window_sizes_current = params.window_sizes_init;
+	}
+	else
+	{
+		params.window_sizes_current = params.window_sizes_small;
+	}
 
-		// The area of interest search size will depend if the previous track was successful
-		if(!clnf_model.detection_success)
-		{
-			params.window_sizes_current = params.window_sizes_init;
-		}
-		else
-		{
-			params.window_sizes_current = params.window_sizes_small;
-		}
+	// Before the expensive landmark detection step apply a quick template tracking approach
+	if(params.use_face_template && !clnf_model.face_template.empty() && clnf_model.detection_success)
+	{
+		CorrectGlobalParametersVideo(grayscale_image, clnf_model);
+	}
+}
 
-		// Before the expensive landmark detection step apply a quick template tracking approach
-		if(params.use_face_template && !clnf_model.face_template.empty() && clnf_model.detection_success)
+// Keeping track of tracking failures after the landmarks were tracked
+void FinishTracking(const cv::Mat_<uchar>& grayscale_image, CLNF& clnf_model, FaceModelParameters& params, bool track_success)
+{
+	if(!track_success)
+	{
+		// Make a record that tracking failed
+		clnf_model.failures_in_a_row++;
+
+		// The motion is not known any more
+		clnf_model.motion_model.Reset();
+	}
+	else
+	{
+		// indicate that tracking is a success
+		clnf_model.failures_in_a_row = -1;		
+
+		if(params.use_motion_model)
 		{
-			CorrectGlobalParametersVideo(grayscale_image, clnf_model, params);
+			clnf_model.motion_model.Update(clnf_model.params_global, params.frame_stride, clnf_model.GetBoundingBox().width);
 		}
-
-		bool track_success = clnf_model.DetectLandmarks(grayscale_image, params);
 		
-		if(!track_success)
+		if(params.use_face_template)
 		{
-			// Make a record that tracking failed
-			clnf_model.failures_in_a_row++;
+			UpdateTemplate(grayscale_image, clnf_model, params);
 		}
-		else
+	}
+}
+
+// Loading the face detector on first use, returns the preferred location of the face (if any) in image coordinates
+cv::Point PrepareFaceDetection(const cv::Mat_<uchar>& grayscale_image, CLNF& clnf_model, FaceModelParameters& params)
+{
+	// If the face detector has not been initialised and we're using it, then read it in
+	if(clnf_model.face_detector_HAAR.empty() && params.curr_face_detector == params.HAAR_DETECTOR)
+	{
+		clnf_model.face_detector_HAAR.load(params.haar_face_detector_location);
+		clnf_model.haar_face_detector_location = params.haar_face_detector_location;
+	}
+	if (clnf_model.face_detector_MTCNN.empty() && params.curr_face_detector == params.MTCNN_DETECTOR)
+	{
+		clnf_model.face_detector_MTCNN.Read(params.mtcnn_face_detector_location);
+		clnf_model.mtcnn_face_detector_location = params.mtcnn_face_detector_location;
+
+		// If the model is still empty default to HOG
+		if (clnf_model.face_detector_MTCNN.empty())
 		{
-			// indicate that tracking is a success
-			clnf_model.failures_in_a_row = -1;		
-			
-			if(params.use_face_template)
-			{
-				UpdateTemplate(grayscale_image, clnf_model);
-			}
+			std::cout << "INFO: defaulting to HOG-SVM face detector" << std::endl;
+			params.curr_face_detector = LandmarkDetector::FaceModelParameters::HOG_SVM_DETECTOR;
 		}
+
 	}
 
+	cv::Point preference_det(-1, -1);
+	if(clnf_model.preference_det.x != -1 && clnf_model.preference_det.y != -1)
+	{
+		preference_det.x = clnf_model.preference_det.x * grayscale_image.cols;
+		preference_det.y = clnf_model.preference_det.y * grayscale_image.rows;
+		clnf_model.preference_det = cv::Point(-1, -1);
+	}
+
+	return preference_det;
+}
+
+// Detecting a single face to (re)initialise the model from, only uses the face detectors of the model (so it can run in the background)
+bool DetectFace(cv::Rect_<float>& bounding_box, const cv::Mat &rgb_image, const cv::Mat_<uchar>& grayscale_image, CLNF& clnf_model, int face_detector, cv::Point preference_det)
+{
+	bool face_detection_success = false;
+	if(face_detector == FaceModelParameters::HOG_SVM_DETECTOR)
+	{
+		float confidence;
+		face_detection_success = LandmarkDetector::DetectSingleFaceHOG(bounding_box, grayscale_image, clnf_model.face_detector_HOG, confidence, preference_det);
+	}
+	else if(face_detector == FaceModelParameters::HAAR_DETECTOR)
+	{
+		face_detection_success = LandmarkDetector::DetectSingleFace(bounding_box, grayscale_image, clnf_model.face_detector_HAAR, preference_det);
+	}
+	else if (face_detector == FaceModelParameters::MTCNN_DETECTOR)
+	{
+		float confidence;
+		face_detection_success = LandmarkDetector::DetectSingleFaceMTCNN(bounding_box, rgb_image, clnf_model.face_detector_MTCNN, confidence, preference_det);
+	}
+	return face_detection_success;
+}
+
+// Face detection based (re)initialisation after the tracking step if it is needed
+bool ReinitialiseInVideo(const cv::Mat &rgb_image, CLNF& clnf_model, FaceModelParameters& params, cv::Mat& grayscale_image, bool initial_detection)
+{
 	// This is used for both detection (if it the tracking has not been initialised yet) or if the tracking failed (however we do this every n frames, for speed)
 	// This also has the effect of an attempt to reinitialise just after the tracking has failed, which is useful during large motions
-	if((!clnf_model.tracking_initialised && (clnf_model.failures_in_a_row + 1) % (params.reinit_video_every * 6) == 0) 
-		|| (clnf_model.tracking_initialised && !clnf_model.detection_success && params.reinit_video_every > 0 && clnf_model.failures_in_a_row % params.reinit_video_every == 0))
-	{
+	bool reinitialise = (!clnf_model.tracking_initialised && (clnf_model.failures_in_a_row + 1) % (params.reinit_video_every * 6) == 0) 
+		|| (clnf_model.tracking_initialised && !clnf_model.detection_success && params.reinit_video_every > 0 && clnf_model.failures_in_a_row % params.reinit_video_every == 0);
 
-		cv::Rect_<float> bounding_box;
-		
-		// If the face detector has not been initialised and we're using it, then read it in
-		if(clnf_model.face_detector_HAAR.empty() && params.curr_face_detector == params.HAAR_DETECTOR)
-		{
-			clnf_model.face_detector_HAAR.load(params.haar_face_detector_location);
-			clnf_model.haar_face_detector_location = params.haar_face_detector_location;
-		}
-		if (clnf_model.face_detector_MTCNN.empty() && params.curr_face_detector == params.MTCNN_DETECTOR)
+	cv::Rect_<float> bounding_box;
+	bool face_detection_success = false;
+
+	if(params.async_face_detection)
+	{
+		// The detection runs on a copy of this frame in the background (right away if there are no worker threads) and the tracking continues in the meantime
+		if(reinitialise && !clnf_model.FaceDetectionPending())
 		{
-			clnf_model.face_detector_MTCNN.Read(params.mtcnn_face_detector_location);
-			clnf_model.mtcnn_face_detector_location = params.mtcnn_face_detector_location;
+			cv::Point preference_det = PrepareFaceDetection(grayscale_image, clnf_model, params);
 
-			// If the model is still empty default to HOG
-			if (clnf_model.face_detector_MTCNN.empty())
+			int face_detector = params.curr_face_detector;
+			cv::Mat rgb_copy;
+			cv::Mat_<uchar> grayscale_copy;
+			if (face_detector == FaceModelParameters::MTCNN_DETECTOR)
 			{
-				std::cout << "INFO: defaulting to HOG-SVM face detector" << std::endl;
-				params.curr_face_detector = LandmarkDetector::FaceModelParameters::HOG_SVM_DETECTOR;
+				rgb_copy = rgb_image.clone();
+			}
+			else
+			{
+				grayscale_copy = grayscale_image.clone();
 			}
 
+			// The task only reads the face detectors of the model, the copy and move operations, Reset and the destructor of CLNF all wait for it first
+			CLNF* model = &clnf_model;
+			clnf_model.StartFaceDetection([model, rgb_copy, grayscale_copy, face_detector, preference_det](cv::Rect_<float>& detected_box) {
+				return DetectFace(detected_box, rgb_copy, grayscale_copy, *model, face_detector, preference_det);
+			});
 		}
 
-		cv::Point preference_det(-1, -1);
-		if(clnf_model.preference_det.x != -1 && clnf_model.preference_det.y != -1)
+		// The detected face is from a frame or a few before, it is not needed if the tracking has recovered in the meantime
+		if(clnf_model.FinishFaceDetection(face_detection_success, bounding_box) && clnf_model.tracking_initialised && clnf_model.detection_success)
 		{
-			preference_det.x = clnf_model.preference_det.x * grayscale_image.cols;
-			preference_det.y = clnf_model.preference_det.y * grayscale_image.rows;
-			clnf_model.preference_det = cv::Point(-1, -1);
+			face_detection_success = false;
 		}
+	}
+	else if(reinitialise)
+	{
+		cv::Point preference_det = PrepareFaceDetection(grayscale_image, clnf_model, params);
+		face_detection_success = DetectFace(bounding_box, rgb_image, grayscale_image, clnf_model, params.curr_face_detector, preference_det);
+	}
 
-		bool face_detection_success;
-		if(params.curr_face_detector == FaceModelParameters::HOG_SVM_DETECTOR)
-		{
-			float confidence;
-			face_detection_success = LandmarkDetector::DetectSingleFaceHOG(bounding_box, grayscale_image, clnf_model.face_detector_HOG, confidence, preference_det);
-		}
-		else if(params.curr_face_detector == FaceModelParameters::HAAR_DETECTOR)
-		{
-			face_detection_success = LandmarkDetector::DetectSingleFace(bounding_box, grayscale_image, clnf_model.face_detector_HAAR, preference_det);
-		}
-		else if (params.curr_face_detector == FaceModelParameters::MTCNN_DETECTOR)
-		{
-			float confidence;
-			face_detection_success = LandmarkDetector::DetectSingleFaceMTCNN(bounding_box, rgb_image, clnf_model.face_detector_MTCNN, confidence, preference_det);
-		}
+	// Attempt to detect landmarks using the detected face (if unseccessful the detection will be ignored)
+	if(face_detection_success)
+	{
+		// Indicate that tracking has started as a face was detected
+		clnf_model.tracking_initialised = true;
 
-		// Attempt to detect landmarks using the detected face (if unseccessful the detection will be ignored)
-		if(face_detection_success)
-		{
-			// Indicate that tracking has started as a face was detected
-			clnf_model.tracking_initialised = true;
-						
-			// Keep track of old model values so that they can be restored if redetection fails
-			cv::Vec6f params_global_init = clnf_model.params_global;
-			cv::Mat_<float> params_local_init = clnf_model.params_local.clone();
-			float likelihood_init = clnf_model.model_likelihood;
-			cv::Mat_<float> detected_landmarks_init = clnf_model.detected_landmarks.clone();
-			cv::Mat_<float> landmark_likelihoods_init = clnf_model.landmark_likelihoods.clone();
-
-			// Use the detected bounding box and empty local parameters
-			clnf_model.params_local.setTo(0);
-			clnf_model.pdm.CalcParams(clnf_model.params_global, bounding_box, clnf_model.params_local);		
-
-			// Make sure the search size is large
-			params.window_sizes_current = params.window_sizes_init;
+		// Any background refinement of the tracked model is part of the values that are restored
+		clnf_model.FinishHierarchicalRefinement();
+					
+		// Keep track of old model values so that they can be restored if redetection fails
+		cv::Vec6f params_global_init = clnf_model.params_global;
+		cv::Mat_<float> params_local_init = clnf_model.params_local.clone();
+		float likelihood_init = clnf_model.model_likelihood;
+		cv::Mat_<float> detected_landmarks_init = clnf_model.detected_landmarks.clone();
+		cv::Mat_<float> landmark_likelihoods_init = clnf_model.landmark_likelihoods.clone();
+
+		// Use the detected bounding box and empty local parameters
+		clnf_model.params_local.setTo(0);
+		clnf_model.pdm.CalcParams(clnf_model.params_global, bounding_box, clnf_model.params_local);		
 
-			// TODO rem (should the multi-hyp version be only for CEN and not CLNF?), otherwise poss too slow, and poss not accurate
-			//bool landmark_detection_success = clnf_model.DetectLandmarks(grayscale_image, params);
+		// Make sure the search size is large
+		params.window_sizes_current = params.window_sizes_init;
 
-			// Do the actual landmark detection (and keep it only if successful)
-			// Perform multi-hypothesis detection here (as face detector can pick up multiple of them)
-			params.multi_view = true;
-			bool landmark_detection_success = DetectLandmarksInImage(rgb_image, bounding_box, clnf_model, params, grayscale_image);
-			params.multi_view = false;
+		// TODO rem (should the multi-hyp version be only for CEN and not CLNF?), otherwise poss too slow, and poss not accurate
+		//bool landmark_detection_success = clnf_model.DetectLandmarks(grayscale_image, params);
 
+		// Do the actual landmark detection (and keep it only if successful)
+		// Perform multi-hypothesis detection here (as face detector can pick up multiple of them)
+		params.multi_view = true;
+		bool landmark_detection_success = DetectLandmarksInImage(rgb_image, bounding_box, clnf_model, params, grayscale_image);
+		params.multi_view = false;
 
-			// If landmark reinitialisation unsucessful continue from previous estimates
-			// if it's initial detection however, do not care if it was successful as the validator might be wrong, so continue trackig
-			// regardless
-			if(!initial_detection && !landmark_detection_success)
-			{
 
-				// Restore previous estimates
-				clnf_model.params_global = params_global_init;
-				clnf_model.params_local = params_local_init.clone();
-				clnf_model.pdm.CalcShape2D(clnf_model.detected_landmarks, clnf_model.params_local, clnf_model.params_global);
-				clnf_model.model_likelihood = likelihood_init;
-				clnf_model.detected_landmarks = detected_landmarks_init.clone();
-				clnf_model.landmark_likelihoods = landmark_likelihoods_init.clone();
+		// If landmark reinitialisation unsucessful continue from previous estimates
+		// if it's initial detection however, do not care if it was successful as the validator might be wrong, so continue trackig
+		// regardless
+		if(!initial_detection && !landmark_detection_success)
+		{
 
-				return false;
-			}
-			else
+			// Restore previous estimates
+			clnf_model.params_global = params_global_init;
+			clnf_model.params_local = params_local_init.clone();
+			clnf_model.pdm.CalcShape2D(clnf_model.detected_landmarks, clnf_model.params_local, clnf_model.params_global);
+			clnf_model.model_likelihood = likelihood_init;
+			clnf_model.detected_landmarks = detected_landmarks_init.clone();
+			clnf_model.landmark_likelihoods = landmark_likelihoods_init.clone();
+
+			return false;
+		}
+		else
+		{
+			clnf_model.failures_in_a_row = -1;			
+			
+			if(params.use_face_template)
 			{
-				clnf_model.failures_in_a_row = -1;			
-				
-				if(params.use_face_template)
-				{
-					UpdateTemplate(grayscale_image, clnf_model);
-				}
+				UpdateTemplate(grayscale_image, clnf_model, params);
+			}
 
-				return true;
+			// The motion is tracked from the new detection
+			clnf_model.motion_model.Reset();
+			if(params.use_motion_model)
+			{
+				clnf_model.motion_model.Update(clnf_model.params_global, params.frame_stride, clnf_model.GetBoundingBox().width);
 			}
+
+			return true;
 		}
 	}
 
@@ -393,6 +549,81 @@ bool LandmarkDetector::DetectLandmarksInVideo(const cv::Mat &rgb_image, CLNF& cl
 	
 }
 
+bool LandmarkDetector::DetectLandmarksInVideo(const cv::Mat &rgb_image, CLNF& clnf_model, FaceModelParameters& params, cv::Mat& grayscale_image)
+{
+	// First need to decide if the landmarks should be "detected" or "tracked"
+	// Detected means running face detection and a larger search area, tracked means initialising from previous step
+	// and using a smaller search area
+
+	if(grayscale_image.empty())
+	{
+		Utilities::ConvertToGrayscale_8bit(rgb_image, grayscale_image);
+	}
+
+	// Indicating that this is a first detection in video sequence or after restart
+	bool initial_detection = !clnf_model.tracking_initialised;
+
+	// Only do it if there was a face detection at all
+	if(clnf_model.tracking_initialised)
+	{
+		PrepareTracking(grayscale_image, clnf_model, params);
+
+		bool track_success = clnf_model.DetectLandmarks(grayscale_image, params);
+		
+		FinishTracking(grayscale_image, clnf_model, params, track_success);
+	}
+
+	return ReinitialiseInVideo(rgb_image, clnf_model, params, grayscale_image, initial_detection);
+}
+
+std::vector<bool> LandmarkDetector::DetectLandmarksInVideo(const cv::Mat &rgb_image, std::vector<CLNF>& clnf_models, const std::vector<bool>& active_models, 
+	std::vector<FaceModelParameters>& params, cv::Mat& grayscale_image)
+{
+	if(grayscale_image.empty())
+	{
+		Utilities::ConvertToGrayscale_8bit(rgb_image, grayscale_image);
+	}
+
+	std::vector<bool> detection_success(clnf_models.size(), false);
+	std::vector<bool> initial_detection(clnf_models.size(), false);
+
+	// The models that are being tracked are all fit together
+	std::vector<CLNF*> tracked_models;
+	std::vector<FaceModelParameters*> tracked_params;
+	for(size_t model = 0; model < clnf_models.size(); ++model)
+	{
+		if(!active_models[model])
+			continue;
+
+		initial_detection[model] = !clnf_models[model].tracking_initialised;
+
+		if(clnf_models[model].tracking_initialised)
+		{
+			PrepareTracking(grayscale_image, clnf_models[model], params[model]);
+			tracked_models.push_back(&clnf_models[model]);
+			tracked_params.push_back(&params[model]);
+		}
+	}
+
+	std::vector<bool> track_success = CLNF::DetectLandmarks(grayscale_image, tracked_models, tracked_params);
+
+	for(size_t i = 0; i < tracked_models.size(); ++i)
+	{
+		FinishTracking(grayscale_image, *tracked_models[i], *tracked_params[i], track_success[i]);
+	}
+
+	// Face detection based reinitialisation is done one model at a time
+	for(size_t model = 0; model < clnf_models.size(); ++model)
+	{
+		if(active_models[model])
+		{
+			detection_success[model] = ReinitialiseInVideo(rgb_image, clnf_models[model], params[model], grayscale_image, initial_detection[model]);
+		}
+	}
+
+	return detection_success;
+}
+
 bool LandmarkDetector::DetectLandmarksInVideo(const cv::Mat &rgb_image, const cv::Rect_<double> bounding_box, CLNF& clnf_model, FaceModelParameters& params, cv::Mat &grayscale_image)
 {
 	if(bounding_box.width > 0)
@@ -437,6 +668,10 @@ bool DetectLandmarksInImageMultiHypBasic(const cv::Mat_<uchar> &grayscale_image,
 	std::vector<cv::Mat_<float>> best_detected_landmarks_h(clnf_model.hierarchical_models.size());
 	std::vector<cv::Mat_<float>> best_landmark_likelihoods_h(clnf_model.hierarchical_models.size());
 
+	// The hypotheses are picked based on the likelihood, so only the one that is kept needs to be validated
+	bool validate_detections = params.validate_detections;
+	params.validate_detections = false;
+
 	for (size_t hypothesis = 0; hypothesis < rotation_hypotheses.size(); ++hypothesis)
 	{
 		// Reset the potentially set clnf_model parameters
@@ -491,6 +726,9 @@ bool DetectLandmarksInImageMultiHypBasic(const cv::Mat_<uchar> &grayscale_image,
 		clnf_model.hierarchical_models[part].landmark_likelihoods = best_landmark_likelihoods_h[part].clone();
 	}
 
+	params.validate_detections = validate_detections;
+	best_success = clnf_model.ValidateDetection(grayscale_image, best_success, params);
+
 	return best_success;
 
 
@@ -598,10 +836,11 @@ bool DetectLandmarksInImageMultiHypEarlyTerm(const cv::Mat_<uchar> &grayscale_im
 		// Pick 3 best hypotheses and complete them
 		size_t max = indices.size() >= 3 ? 3 : indices.size();
 
+		// The hypotheses are picked based on the likelihood, so only the one that is kept needs to be validated
 		params.refine_hierarchical = old_params.refine_hierarchical;
 		params.window_sizes_current = params.window_sizes_init;
 		params.window_sizes_current[0] = 0;
-		params.validate_detections = old_params.validate_detections;
+		params.validate_detections = false;
 
 
 		for (size_t i = 0; i < max; ++i)
@@ -654,6 +893,9 @@ bool DetectLandmarksInImageMultiHypEarlyTerm(const cv::Mat_<uchar> &grayscale_im
 			clnf_model.hierarchical_models[part].landmark_likelihoods = best_landmark_likelihoods_h[part].clone();
 		}
 
+		params.validate_detections = old_params.validate_detections;
+		success = clnf_model.ValidateDetection(grayscale_image, best_success, params);
+
 	}
 
 	params = old_params;
@@ -699,6 +941,16 @@ bool LandmarkDetector::DetectLandmarksInImage(const cv::Mat &rgb_image, const cv
 	
 	bool success;
 
+	// The hypotheses are compared together with their part models, so the hierarchical refinement can not be left running in the background,
+	// and a new detection is always validated
+	clnf_model.FinishHierarchicalRefinement();
+	bool refine_hierarchical_async = params.refine_hierarchical_async;
+	params.refine_hierarchical_async = false;
+	int validation_interval = params.validation_interval;
+	float validation_skip_lhood_drop = params.validation_skip_lhood_drop;
+	params.validation_interval = 1;
+	params.validation_skip_lhood_drop = 0;
+
 	// Either use basic multi-hypothesis testing or clever testing if early termination parameters are present
 	if(clnf_model.patch_experts.early_term_biases.size() == 0)
 	{
@@ -708,6 +960,11 @@ bool LandmarkDetector::DetectLandmarksInImage(const cv::Mat &rgb_image, const cv
 	{
 		success = DetectLandmarksInImageMultiHypEarlyTerm(grayscale_image, rotation_hypotheses, bounding_box, clnf_model, params);
 	}
+
+	params.refine_hierarchical_async = refine_hierarchical_async;
+	params.validation_interval = validation_interval;
+	params.validation_skip_lhood_drop = validation_skip_lhood_drop;
+
 	return success;
 }
 
@@ -39,6 +39,8 @@
 // Local includes
 #include <LandmarkDetectorUtils.h>
 #include <RotationHelpers.h>
+#include <RLMSSolver.h>
+#include <TaskScheduler.h>
 
 using namespace LandmarkDetector;
 
@@ -54,6 +56,10 @@ CLNF::CLNF()
 	// A successful read wil set this to true
 	loaded_successfully = false;
 
+	hierarchical_refinement_pending = false;
+	hierarchical_parts_used = false;
+	face_detection_pending = false;
+
 	this->Read(parameters.model_location);
 }
 
@@ -63,20 +69,40 @@ CLNF::CLNF(std::string fname)
 	// A successful read wil set this to true
 	loaded_successfully = false;
 
+	hierarchical_refinement_pending = false;
+	hierarchical_parts_used = false;
+	face_detection_pending = false;
+
 	this->Read(fname);
 }
 
 // Copy constructor (makes a deep copy of CLNF)
 CLNF::CLNF(const CLNF& other): pdm(other.pdm), params_local(other.params_local.clone()), params_global(other.params_global), detected_landmarks(other.detected_landmarks.clone()),
 	landmark_likelihoods(other.landmark_likelihoods.clone()), patch_experts(other.patch_experts), landmark_validator(other.landmark_validator), haar_face_detector_location(other.haar_face_detector_location),
-	mtcnn_face_detector_location(other.mtcnn_face_detector_location), hierarchical_mapping(other.hierarchical_mapping), hierarchical_models(other.hierarchical_models), hierarchical_model_names(other.hierarchical_model_names),
-	hierarchical_params(other.hierarchical_params), eye_model(other.eye_model), face_detector_MTCNN(other.face_detector_MTCNN), preference_det(other.preference_det), loaded_successfully(other.loaded_successfully)
+	mtcnn_face_detector_location(other.mtcnn_face_detector_location), hierarchical_mapping(other.hierarchical_mapping), hierarchical_model_names(other.hierarchical_model_names),
+	eye_model(other.eye_model), preference_det(other.preference_det), loaded_successfully(other.loaded_successfully)
 {
 	this->detection_success = other.detection_success;
 	this->tracking_initialised = other.tracking_initialised;
 	this->detection_certainty = other.detection_certainty;
 	this->model_likelihood = other.model_likelihood;
 	this->failures_in_a_row = other.failures_in_a_row;
+	this->fit_statistics = other.fit_statistics;
+	this->validation_statistics = other.validation_statistics;
+	this->motion_model = other.motion_model;
+
+	// The part models can only be copied once the other model is not refining them in the background, the refinement still has to be incorporated into the copy
+	other.WaitHierarchicalRefinement();
+	this->hierarchical_models = other.hierarchical_models;
+	this->hierarchical_params = other.hierarchical_params;
+	this->hierarchical_refinement_pending = other.hierarchical_refinement_pending;
+	this->hierarchical_parts_used = other.hierarchical_parts_used;
+
+	// The same for the face detectors, the copy picks up the result of the detection
+	other.WaitFaceDetection();
+	this->face_detector_MTCNN = other.face_detector_MTCNN;
+	this->face_detection_pending = other.face_detection_pending;
+	this->face_detection_result = other.face_detection_result;
 
 	// Load the CascadeClassifier (as it does not have a proper copy constructor)
 	if(!haar_face_detector_location.empty())
@@ -105,6 +131,17 @@ CLNF & CLNF::operator= (const CLNF& other)
 {
 	if (this != &other) // protect against invalid self-assignment
 	{
+		this->WaitHierarchicalRefinement();
+		other.WaitHierarchicalRefinement();
+		this->hierarchical_refinement = std::shared_future<void>();
+		this->hierarchical_refinement_pending = other.hierarchical_refinement_pending;
+		this->hierarchical_parts_used = other.hierarchical_parts_used;
+		this->WaitFaceDetection();
+		other.WaitFaceDetection();
+		this->face_detection = std::shared_future<void>();
+		this->face_detection_pending = other.face_detection_pending;
+		this->face_detection_result = other.face_detection_result;
+
 		pdm = PDM(other.pdm);
 		params_local = other.params_local.clone();
 		params_global = other.params_global;
@@ -121,6 +158,9 @@ CLNF & CLNF::operator= (const CLNF& other)
 		this->detection_certainty = other.detection_certainty;
 		this->model_likelihood = other.model_likelihood;
 		this->failures_in_a_row = other.failures_in_a_row;
+		this->fit_statistics = other.fit_statistics;
+		this->validation_statistics = other.validation_statistics;
+		this->motion_model = other.motion_model;
 
 		this->eye_model = other.eye_model;
 		
@@ -164,11 +204,22 @@ CLNF & CLNF::operator= (const CLNF& other)
 // Move constructor
 CLNF::CLNF(const CLNF&& other)
 {
+	other.WaitHierarchicalRefinement();
+	this->hierarchical_refinement_pending = other.hierarchical_refinement_pending;
+	this->hierarchical_parts_used = other.hierarchical_parts_used;
+
+	other.WaitFaceDetection();
+	this->face_detection_pending = other.face_detection_pending;
+	this->face_detection_result = other.face_detection_result;
+
 	this->detection_success = other.detection_success;
 	this->tracking_initialised = other.tracking_initialised;
 	this->detection_certainty = other.detection_certainty;
 	this->model_likelihood = other.model_likelihood;
 	this->failures_in_a_row = other.failures_in_a_row;
+	this->fit_statistics = other.fit_statistics;
+	this->validation_statistics = other.validation_statistics;
+	this->motion_model = other.motion_model;
 
 	pdm = other.pdm;
 	params_local = other.params_local;
@@ -204,11 +255,25 @@ CLNF::CLNF(const CLNF&& other)
 // Assignment operator for rvalues
 CLNF & CLNF::operator= (const CLNF&& other)
 {
+	this->WaitHierarchicalRefinement();
+	other.WaitHierarchicalRefinement();
+	this->hierarchical_refinement = std::shared_future<void>();
+	this->hierarchical_refinement_pending = other.hierarchical_refinement_pending;
+	this->hierarchical_parts_used = other.hierarchical_parts_used;
+	this->WaitFaceDetection();
+	other.WaitFaceDetection();
+	this->face_detection = std::shared_future<void>();
+	this->face_detection_pending = other.face_detection_pending;
+	this->face_detection_result = other.face_detection_result;
+
 	this->detection_success = other.detection_success;
 	this->tracking_initialised = other.tracking_initialised;
 	this->detection_certainty = other.detection_certainty;
 	this->model_likelihood = other.model_likelihood;
 	this->failures_in_a_row = other.failures_in_a_row;
+	this->fit_statistics = other.fit_statistics;
+	this->validation_statistics = other.validation_statistics;
+	this->motion_model = other.motion_model;
 
 	pdm = other.pdm;
 	params_local = other.params_local;
@@ -242,6 +307,27 @@ CLNF & CLNF::operator= (const CLNF&& other)
 	return *this;
 }
 
+CLNF::~CLNF()
+{
+	// The background refinement uses the part models of this model and the background detection its face detectors, an exception thrown by
+	// them cannot be passed on from the destructor
+	try
+	{
+		WaitHierarchicalRefinement();
+	}
+	catch (...)
+	{
+	}
+
+	try
+	{
+		WaitFaceDetection();
+	}
+	catch (...)
+	{
+	}
+}
+
 
 bool CLNF::Read_CLNF(std::string clnf_location)
 {
@@ -590,6 +676,29 @@ void CLNF::Read(std::string main_location)
 // Resetting the model (for a new video, or complet reinitialisation
 void CLNF::Reset()
 {
+	// A pending refinement is of no use any more
+	std::shared_future<void> refinement = hierarchical_refinement;
+	hierarchical_refinement = std::shared_future<void>();
+	hierarchical_refinement_pending = false;
+
+	// Neither is a pending face detection
+	std::shared_future<void> detection = face_detection;
+	face_detection = std::shared_future<void>();
+	face_detection_result.reset();
+	face_detection_pending = false;
+
+	// Both have to be done before the model is changed, even if the first one threw
+	try
+	{
+		TaskScheduler::Wait(refinement);
+	}
+	catch (...)
+	{
+		TaskScheduler::Wait(detection);
+		throw;
+	}
+	TaskScheduler::Wait(detection);
+
 	detected_landmarks.setTo(0);
 
 	detection_success = false;
@@ -605,6 +714,9 @@ void CLNF::Reset()
 
 	failures_in_a_row = -1;
 	face_template = cv::Mat_<uchar>();
+	face_template_pyramid.clear();
+	face_template_scaling = 1;
+	motion_model.Reset();
 }
 
 // Resetting the model, choosing the face nearest (x,y)
@@ -623,6 +735,8 @@ void CLNF::Reset(double x, double y)
 // The main internal landmark detection call (should not be used externally?)
 bool CLNF::DetectLandmarks(const cv::Mat_<uchar> &image, FaceModelParameters& params)
 {
+	// The fit starts from the refined model of the previous frame
+	FinishHierarchicalRefinement();
 
 	// TODO this could be moved out
 	cv::Mat_<float> gray_image_flt;
@@ -631,82 +745,247 @@ bool CLNF::DetectLandmarks(const cv::Mat_<uchar> &image, FaceModelParameters& pa
 	// Fits from the current estimate of local and global parameters in the model
 	bool fit_success = Fit(gray_image_flt, params.window_sizes_current, params);
 
-	// Store the landmarks converged on in detected_landmarks
-	pdm.CalcShape2D(detected_landmarks, params_local, params_global);	
+	return RefineAndValidate(image, fit_success, params);
+}
 
-	if(params.refine_hierarchical && hierarchical_models.size() > 0)
-	{
-		bool parts_used = false;		
+// Fitting several models on the same image, the models are fit in lockstep so that the patch expert responses of all of them are computed together at each scale
+std::vector<bool> CLNF::DetectLandmarks(const cv::Mat_<uchar> &image, const std::vector<CLNF*>& models, const std::vector<FaceModelParameters*>& params)
+{
+	int num_models = models.size();
 
-		// Do the hierarchical models in parallel
-		parallel_for_(cv::Range(0, hierarchical_models.size()), [&](const cv::Range& range) {
-			for (int part_model = range.start; part_model < range.end; part_model++)
-			{
-				
-				int n_part_points = hierarchical_models[part_model].pdm.NumberOfPoints();
+	// The image is only converted once for all of the models
+	cv::Mat_<float> gray_image_flt;
+	image.convertTo(gray_image_flt, CV_32F);
 
-				std::vector<std::pair<int, int>> mappings = this->hierarchical_mapping[part_model];
+	std::vector<FitState> states(num_models);
+	int num_scales = 0;
+	for (int m = 0; m < num_models; ++m)
+	{
+		models[m]->FinishHierarchicalRefinement();
+		models[m]->FitBegin(states[m], *params[m]);
+		num_scales = std::max(num_scales, (int)models[m]->patch_experts.patch_scaling.size());
+	}
 
-				cv::Mat_<float> part_model_locs(n_part_points * 2, 1, 0.0f);
+	for (int scale = 0; scale < num_scales; ++scale)
+	{
+		// Collect the models that are optimised at this scale and the visible landmarks of all of them
+		std::vector<int> scale_models;
+		std::vector<std::pair<int, int> > landmark_work;
 
-				// Extract the corresponding landmarks
-				for (size_t mapping_ind = 0; mapping_ind < mappings.size(); ++mapping_ind)
-				{
-					part_model_locs.at<float>(mappings[mapping_ind].second) = detected_landmarks.at<float>(mappings[mapping_ind].first);
-					part_model_locs.at<float>(mappings[mapping_ind].second + n_part_points) = detected_landmarks.at<float>(mappings[mapping_ind].first + this->pdm.NumberOfPoints());
-				}
+		for (int m = 0; m < num_models; ++m)
+		{
+			CLNF& model = *models[m];
+			const std::vector<int>& window_sizes = params[m]->window_sizes_current;
 
-				// Fit the part based model PDM
-				hierarchical_models[part_model].pdm.CalcParams(hierarchical_models[part_model].params_global, hierarchical_models[part_model].params_local, part_model_locs);
+			if (states[m].finished || scale >= (int)model.patch_experts.patch_scaling.size() || window_sizes[scale] == 0)
+				continue;
 
-				// Only do this if we don't need to upsample
-				if (params_global[0] > 0.9 * hierarchical_models[part_model].patch_experts.patch_scaling[0])
-				{
-					parts_used = true;
+			model.patch_experts.PrepareResponse(states[m].response_context, states[m].sim_ref_to_img, states[m].sim_img_to_ref, model.pdm, model.params_global, model.params_local, window_sizes[scale], scale);
 
-					this->hierarchical_params[part_model].window_sizes_current = this->hierarchical_params[part_model].window_sizes_init;
+			for (size_t i = 0; i < states[m].response_context.visible_landmarks.size(); ++i)
+			{
+				landmark_work.push_back(std::pair<int, int>(m, states[m].response_context.visible_landmarks[i]));
+			}
+			scale_models.push_back(m);
+		}
 
-					// Do the actual landmark detection
-					hierarchical_models[part_model].DetectLandmarks(image, hierarchical_params[part_model]);
+		// The patch expert responses of all the models in a single parallel loop
+		TaskScheduler::ParallelFor(cv::Range(0, landmark_work.size()), [&](const cv::Range& range) {
+			for (int i = range.start; i < range.end; i++)
+			{
+				int m = landmark_work[i].first;
+				models[m]->patch_experts.LandmarkResponse(states[m].patch_expert_responses, states[m].response_context, gray_image_flt, landmark_work[i].second);
+			}
+		});
 
-				}
-				else
-				{
-					hierarchical_models[part_model].pdm.CalcShape2D(hierarchical_models[part_model].detected_landmarks, hierarchical_models[part_model].params_local, hierarchical_models[part_model].params_global);
-				}
-		
+		// The optimisation of the models is independent
+		TaskScheduler::ParallelFor(cv::Range(0, scale_models.size()), [&](const cv::Range& range) {
+			for (int i = range.start; i < range.end; i++)
+			{
+				int m = scale_models[i];
+				models[m]->FitScale(states[m], params[m]->window_sizes_current, scale, *params[m]);
 			}
 		});
+	}
 
-		// Recompute main model based on the fit part models
-		if(parts_used)
+	// Hierarchical refinement of every model
+	TaskScheduler::ParallelFor(cv::Range(0, num_models), [&](const cv::Range& range) {
+		for (int m = range.start; m < range.end; m++)
 		{
+			models[m]->FitEnd(states[m]);
+			models[m]->RefineHierarchical(image, *params[m]);
+		}
+	});
 
-			for (size_t part_model = 0; part_model < hierarchical_models.size(); ++part_model)
+	// The models that need validation are grouped by their validator (e.g. copies of the same model for several faces share one) and each group is validated together
+	std::vector<std::vector<int> > validation_groups;
+	for (int m = 0; m < num_models; ++m)
+	{
+		if (models[m]->ValidationRequired(states[m].success, *params[m]))
+		{
+			size_t group = 0;
+			while (group < validation_groups.size() && models[validation_groups[group][0]]->landmark_validator.location != models[m]->landmark_validator.location)
 			{
-				std::vector<std::pair<int, int>> mappings = this->hierarchical_mapping[part_model];
+				group++;
+			}
 
-				// Reincorporate the models into main tracker
-				for (size_t mapping_ind = 0; mapping_ind < mappings.size(); ++mapping_ind)
-				{
-					detected_landmarks.at<float>(mappings[mapping_ind].first) = hierarchical_models[part_model].detected_landmarks.at<float>(mappings[mapping_ind].second);
-					detected_landmarks.at<float>(mappings[mapping_ind].first + pdm.NumberOfPoints()) = hierarchical_models[part_model].detected_landmarks.at<float>(mappings[mapping_ind].second + hierarchical_models[part_model].pdm.NumberOfPoints());
-				}
+			if (group == validation_groups.size())
+			{
+				validation_groups.push_back(std::vector<int>());
 			}
+			validation_groups[group].push_back(m);
+		}
+	}
+
+	std::vector<float> certainties(num_models, -1.0f);
+	for (size_t group = 0; group < validation_groups.size(); ++group)
+	{
+		const std::vector<int>& validated_models = validation_groups[group];
+
+		std::vector<cv::Vec3d> orientations;
+		std::vector<cv::Mat_<float> > landmarks;
+		for (size_t i = 0; i < validated_models.size(); ++i)
+		{
+			const CLNF& model = *models[validated_models[i]];
+			orientations.push_back(cv::Vec3d(model.params_global[1], model.params_global[2], model.params_global[3]));
+			landmarks.push_back(model.detected_landmarks);
+		}
 
-			pdm.CalcParams(params_global, params_local, detected_landmarks);		
-			pdm.CalcShape2D(detected_landmarks, params_local, params_global);
+		std::vector<float> validated_certainties = models[validated_models[0]]->landmark_validator.Check(orientations, image, landmarks);
+		for (size_t i = 0; i < validated_models.size(); ++i)
+		{
+			certainties[validated_models[i]] = validated_certainties[i];
 		}
+	}
+
+	std::vector<bool> detection_success(num_models, false);
+	for (int m = 0; m < num_models; ++m)
+	{
+		detection_success[m] = models[m]->SetDetectionResult(states[m].success, certainties[m], *params[m]);
+	}
+
+	return detection_success;
+}
+
+// The hierarchical refinement and the validation of the landmarks after the model was fit
+bool CLNF::RefineAndValidate(const cv::Mat_<uchar> &image, bool fit_success, FaceModelParameters& params)
+{
+	RefineHierarchical(image, params);
 
+	return ValidateDetection(image, fit_success, params);
+}
+
+void CLNF::RefineHierarchical(const cv::Mat_<uchar> &image, FaceModelParameters& params)
+{
+	// Store the landmarks converged on in detected_landmarks
+	pdm.CalcShape2D(detected_landmarks, params_local, params_global);	
+
+	if(params.refine_hierarchical && hierarchical_models.size() > 0)
+	{
+		if (params.refine_hierarchical_async)
+		{
+			// The part models are fit in the background from a copy of the image and landmarks, so the caller can reuse them and continue
+			// with the main model fit, the results are incorporated in FinishHierarchicalRefinement
+			cv::Mat_<uchar> image_copy = image.clone();
+			cv::Mat_<float> main_landmarks = detected_landmarks.clone();
+			float main_scale = params_global[0];
+			hierarchical_refinement = TaskScheduler::Async([this, image_copy, main_landmarks, main_scale]() {
+				hierarchical_parts_used = FitHierarchicalModels(image_copy, main_landmarks, main_scale);
+			});
+			hierarchical_refinement_pending = true;
+		}
+		else if (FitHierarchicalModels(image, detected_landmarks, params_global[0]))
+		{
+			// Recompute main model based on the fit part models
+			IncorporateHierarchicalModels();
+		}
 	}
+}
+
+bool CLNF::ValidateDetection(const cv::Mat_<uchar> &image, bool fit_success, const FaceModelParameters& params)
+{
+	float certainty = -1.0f;
 
 	// Check detection correctness
+	if (ValidationRequired(fit_success, params))
+	{
+		cv::Vec3d orientation(params_global[1], params_global[2], params_global[3]);
+
+		certainty = landmark_validator.Check(orientation, image, detected_landmarks);
+	}
+
+	return SetDetectionResult(fit_success, certainty, params);
+}
+
+// The most frames between two validations of a successful track (1 if every frame is validated), the shorter of the two policies if both are used
+static int ValidationPeriod(const FaceModelParameters& params)
+{
+	int period = std::max(1, params.validation_interval);
+
+	if (params.validation_skip_lhood_drop > 0)
+	{
+		int skip_period = std::max(1, params.validation_max_skipped + 1);
+		period = period > 1 ? std::min(period, skip_period) : skip_period;
+	}
+
+	return period;
+}
+
+bool CLNF::ValidationRequired(bool fit_success, const FaceModelParameters& params) const
+{
+	if (!params.validate_detections || !fit_success)
+	{
+		return false;
+	}
+
+	// Every frame is validated, or there was no successful validation to carry over
+	int period = ValidationPeriod(params);
+	if (period <= 1 || !detection_success)
+	{
+		return true;
+	}
+
+	// Time for the periodic validation
+	if (validation_statistics.frames_since_validation + 1 >= period)
+	{
+		return true;
+	}
+
+	// A drop in likelihood or a sharp head rotation since the last validated frame trigger the validation right away, so drift is caught quickly
+	bool lhood_dropped = params.validation_skip_lhood_drop > 0 && model_likelihood < validation_statistics.validated_likelihood - params.validation_skip_lhood_drop;
+
+	cv::Vec3f rotation_change = cv::Vec3f(params_global[1], params_global[2], params_global[3]) - validation_statistics.validated_rotation;
+	bool rotated = cv::norm(rotation_change) * 180.0 / CV_PI > params.validation_rotation_change;
+
+	return lhood_dropped || rotated;
+}
+
+bool CLNF::SetDetectionResult(bool fit_success, float certainty, const FaceModelParameters& params)
+{
 	if(params.validate_detections && fit_success)
 	{
+		if (certainty >= 0)
+		{
+			detection_certainty = certainty;
 
-		cv::Vec3d orientation(params_global[1], params_global[2], params_global[3]);
+			// Validations of a successful track that were triggered before the period was up
+			int period = ValidationPeriod(params);
+			if (period > 1 && detection_success && validation_statistics.frames_since_validation + 1 < period)
+			{
+				validation_statistics.validations_triggered++;
+			}
 
-		detection_certainty = landmark_validator.Check(orientation, image, detected_landmarks);
+			validation_statistics.validations_run++;
+			validation_statistics.validated_likelihood = model_likelihood;
+			validation_statistics.validated_rotation = cv::Vec3f(params_global[1], params_global[2], params_global[3]);
+			validation_statistics.frames_since_validation = 0;
+		}
+		else
+		{
+			// The certainty of the last validated frame is kept
+			validation_statistics.validations_skipped++;
+			validation_statistics.frames_since_validation++;
+		}
 
 		detection_success = detection_certainty > params.validation_boundary;
 
@@ -728,71 +1007,258 @@ bool CLNF::DetectLandmarks(const cv::Mat_<uchar> &image, FaceModelParameters& pa
 	return detection_success;
 }
 
+bool CLNF::FitHierarchicalModels(const cv::Mat_<uchar> &image, const cv::Mat_<float>& main_landmarks, float main_scale)
+{
+	bool parts_used = false;
+
+	// Do the hierarchical models in parallel
+	TaskScheduler::ParallelFor(cv::Range(0, hierarchical_models.size()), [&](const cv::Range& range) {
+		for (int part_model = range.start; part_model < range.end; part_model++)
+		{
+			
+			int n_part_points = hierarchical_models[part_model].pdm.NumberOfPoints();
+
+			std::vector<std::pair<int, int>> mappings = this->hierarchical_mapping[part_model];
+
+			cv::Mat_<float> part_model_locs(n_part_points * 2, 1, 0.0f);
+
+			// Extract the corresponding landmarks
+			for (size_t mapping_ind = 0; mapping_ind < mappings.size(); ++mapping_ind)
+			{
+				part_model_locs.at<float>(mappings[mapping_ind].second) = main_landmarks.at<float>(mappings[mapping_ind].first);
+				part_model_locs.at<float>(mappings[mapping_ind].second + n_part_points) = main_landmarks.at<float>(mappings[mapping_ind].first + this->pdm.NumberOfPoints());
+			}
+
+			// Fit the part based model PDM
+			hierarchical_models[part_model].pdm.CalcParams(hierarchical_models[part_model].params_global, hierarchical_models[part_model].params_local, part_model_locs);
+
+			// Only do this if we don't need to upsample
+			if (main_scale > 0.9 * hierarchical_models[part_model].patch_experts.patch_scaling[0])
+			{
+				parts_used = true;
+
+				this->hierarchical_params[part_model].window_sizes_current = this->hierarchical_params[part_model].window_sizes_init;
+
+				// Do the actual landmark detection
+				hierarchical_models[part_model].DetectLandmarks(image, hierarchical_params[part_model]);
+
+			}
+			else
+			{
+				hierarchical_models[part_model].pdm.CalcShape2D(hierarchical_models[part_model].detected_landmarks, hierarchical_models[part_model].params_local, hierarchical_models[part_model].params_global);
+			}
+	
+		}
+	});
+
+	return parts_used;
+}
+
+void CLNF::IncorporateHierarchicalModels()
+{
+	for (size_t part_model = 0; part_model < hierarchical_models.size(); ++part_model)
+	{
+		std::vector<std::pair<int, int>> mappings = this->hierarchical_mapping[part_model];
+
+		// Reincorporate the models into main tracker
+		for (size_t mapping_ind = 0; mapping_ind < mappings.size(); ++mapping_ind)
+		{
+			detected_landmarks.at<float>(mappings[mapping_ind].first) = hierarchical_models[part_model].detected_landmarks.at<float>(mappings[mapping_ind].second);
+			detected_landmarks.at<float>(mappings[mapping_ind].first + pdm.NumberOfPoints()) = hierarchical_models[part_model].detected_landmarks.at<float>(mappings[mapping_ind].second + hierarchical_models[part_model].pdm.NumberOfPoints());
+		}
+	}
+
+	pdm.CalcParams(params_global, params_local, detected_landmarks);		
+	pdm.CalcShape2D(detected_landmarks, params_local, params_global);
+}
+
+void CLNF::WaitHierarchicalRefinement() const
+{
+	TaskScheduler::Wait(hierarchical_refinement);
+}
+
+void CLNF::FinishHierarchicalRefinement()
+{
+	if (!hierarchical_refinement_pending)
+	{
+		return;
+	}
+
+	// The refinement is no longer pending even if it threw (the exception is passed on by the wait)
+	std::shared_future<void> refinement = hierarchical_refinement;
+	hierarchical_refinement = std::shared_future<void>();
+	hierarchical_refinement_pending = false;
+	TaskScheduler::Wait(refinement);
+
+	if (hierarchical_parts_used)
+	{
+		IncorporateHierarchicalModels();
+	}
+}
+
+void CLNF::StartFaceDetection(const std::function<bool(cv::Rect_<float>&)>& detect)
+{
+	if (face_detection_pending)
+	{
+		return;
+	}
+
+	std::shared_ptr<FaceDetectionResult> result(new FaceDetectionResult());
+	result->success = false;
+
+	face_detection_pending = true;
+	face_detection_result = result;
+	face_detection = TaskScheduler::Async([result, detect]() {
+		result->success = detect(result->box);
+	}, true);
+}
+
+bool CLNF::FinishFaceDetection(bool& success, cv::Rect_<float>& bounding_box)
+{
+	if (!face_detection_pending || !TaskScheduler::Done(face_detection))
+	{
+		return false;
+	}
+
+	std::shared_future<void> detection = face_detection;
+	std::shared_ptr<FaceDetectionResult> result = face_detection_result;
+	face_detection = std::shared_future<void>();
+	face_detection_result.reset();
+	face_detection_pending = false;
+
+	// Passes on the exception if the detection threw
+	TaskScheduler::Wait(detection);
+
+	success = result->success;
+	bounding_box = result->box;
+	return true;
+}
+
+void CLNF::WaitFaceDetection() const
+{
+	TaskScheduler::Wait(face_detection);
+}
+
 //=============================================================================
 bool CLNF::Fit(const cv::Mat_<float>& im, const std::vector<int>& window_sizes, const FaceModelParameters& parameters)
 {
 	// Making sure it is a single channel image
 	assert(im.channels() == 1);	
 	
-	// Placeholder for the landmarks
-	cv::Mat_<float> current_shape(2 * pdm.NumberOfPoints() , 1, 0.0f);
+	FitState state;
+	FitBegin(state, parameters);
 
-	int n = pdm.NumberOfPoints(); 
-		
 	int num_scales = patch_experts.patch_scaling.size();
 
-	// Storing the patch expert response maps
-	std::vector<cv::Mat_<float> > patch_expert_responses(n);
-
-	// Converting from image space to patch expert space (normalised for rotation and scale)
-	cv::Matx22f sim_ref_to_img;
-	cv::Matx22f sim_img_to_ref;
-
-	FaceModelParameters tmp_parameters = parameters;
-
-	// Active scale is there in case we need to upsample too much
-	int active_scale = 0;
-
 	// Optimise the model across a number of areas of interest (usually in descending window size and ascending scale size)
-	for(int scale = 0; scale < num_scales; scale++)
+	for(int scale = 0; scale < num_scales && !state.finished; scale++)
 	{
 		// Control the number of iterations through window size
 		if (window_sizes[scale] == 0)
 			continue;
 
-		int window_size = window_sizes[scale];
-
 		// The patch expert response computation
-		patch_experts.Response(patch_expert_responses, sim_ref_to_img, sim_img_to_ref, im, pdm, params_global, params_local, window_size, scale);
+		patch_experts.Response(state.patch_expert_responses, state.sim_ref_to_img, state.sim_img_to_ref, im, pdm, params_global, params_local, window_sizes[scale], scale);
 
-		if(parameters.refine_parameters == true)
-		{
-			int scale_max = scale >= 2 ? 2 : scale;
+		// The optimisation at the current scale
+		FitScale(state, window_sizes, scale, parameters);
+	}
 
-			// Adapt the parameters based on scale (wan't to reduce regularisation as scale increases, but increase sigma and Tikhonov)
-			tmp_parameters.reg_factor = parameters.reg_factor - 15 * log(patch_experts.patch_scaling[scale_max]/0.25)/log(2);
-			
-			if(tmp_parameters.reg_factor <= 0)
-				tmp_parameters.reg_factor = 0.001;
+	FitEnd(state);
 
-			tmp_parameters.sigma = parameters.sigma + 0.25 * log(patch_experts.patch_scaling[scale_max]/0.25)/log(2);
-			tmp_parameters.weight_factor = parameters.weight_factor + 2 * parameters.weight_factor *  log(patch_experts.patch_scaling[scale_max]/0.25)/log(2);
-		}
+	return state.success;
+}
+
+//=============================================================================
+// Getting ready to fit the model on a new frame
+void CLNF::FitBegin(FitState& state, const FaceModelParameters& parameters)
+{
+	// Storing the patch expert response maps
+	state.patch_expert_responses.resize(pdm.NumberOfPoints());
+
+	state.tmp_parameters = parameters;
+
+	// Active scale is there in case we need to upsample too much
+	state.active_scale = 0;
+
+	// Keep track of how much of the optimisation is used
+	fit_statistics = FitStatistics();
+	state.fit_start = cv::getTickCount();
+
+	// When fitting adaptively any pass can end up being the last one, so all of them compute the model likelihood
+	state.adaptive_fit = parameters.fit_convergence_threshold > 0 || parameters.fit_time_budget > 0;
+
+	state.finished = false;
+	state.success = true;
+}
+
+//=============================================================================
+// The optimisation at one scale, expects the patch expert responses for that scale to be in the state
+void CLNF::FitScale(FitState& state, const std::vector<int>& window_sizes, int scale, const FaceModelParameters& parameters)
+{
+	int num_scales = patch_experts.patch_scaling.size();
+
+	int window_size = window_sizes[scale];
+
+	fit_statistics.scales_used++;
+
+	FaceModelParameters& tmp_parameters = state.tmp_parameters;
+
+	if(parameters.refine_parameters == true)
+	{
+		int scale_max = scale >= 2 ? 2 : scale;
+
+		// Adapt the parameters based on scale (wan't to reduce regularisation as scale increases, but increase sigma and Tikhonov)
+		tmp_parameters.reg_factor = parameters.reg_factor - 15 * log(patch_experts.patch_scaling[scale_max]/0.25)/log(2);
+		
+		if(tmp_parameters.reg_factor <= 0)
+			tmp_parameters.reg_factor = 0.001;
+
+		tmp_parameters.sigma = parameters.sigma + 0.25 * log(patch_experts.patch_scaling[scale_max]/0.25)/log(2);
+		tmp_parameters.weight_factor = parameters.weight_factor + 2 * parameters.weight_factor *  log(patch_experts.patch_scaling[scale_max]/0.25)/log(2);
+	}
+
+	// The iteration budget of the current scale
+	if(!parameters.num_optimisation_iteration_scale.empty())
+	{
+		int scale_iter = std::min(scale, (int)parameters.num_optimisation_iteration_scale.size() - 1);
+		tmp_parameters.num_optimisation_iteration = parameters.num_optimisation_iteration_scale[scale_iter];
+	}
+
+	// Get the current landmark locations
+	cv::Mat_<float> current_shape;
+	pdm.CalcShape2D(current_shape, params_local, params_global);
 
-		// Get the current landmark locations
-		pdm.CalcShape2D(current_shape, params_local, params_global);
+	// Get the view used by patch experts
+	int view_id = patch_experts.GetViewIdx(params_global, scale);
+	this->view_used = view_id;
 
-		// Get the view used by patch experts
-		int view_id = patch_experts.GetViewIdx(params_global, scale);
-		this->view_used = view_id;
+	const std::vector<cv::Mat_<float> >& patch_expert_responses = state.patch_expert_responses;
+	const cv::Matx22f& sim_img_to_ref = state.sim_img_to_ref;
+	const cv::Matx22f& sim_ref_to_img = state.sim_ref_to_img;
+	bool adaptive_fit = state.adaptive_fit;
 
-		// the actual optimisation step
-		this->NU_RLMS(params_global, params_local, patch_expert_responses, cv::Vec6f(params_global), params_local.clone(), current_shape, sim_img_to_ref, sim_ref_to_img, window_size, view_id, true, scale, this->landmark_likelihoods, tmp_parameters, false);
+	// the actual optimisation step
+	float rigid_likelihood = this->NU_RLMS(params_global, params_local, patch_expert_responses, cv::Vec6f(params_global), params_local.clone(), current_shape, sim_img_to_ref, sim_ref_to_img, window_size, view_id, true, scale, this->landmark_likelihoods, tmp_parameters, adaptive_fit);
 
-		// non-rigid optimisation
+	// Skip the non-rigid optimisation and the remaining scales if the rigid one barely moved the model, or if out of time
+	bool stop_fitting = false;
+	cv::Mat_<float> rigid_shape;
+	if(adaptive_fit)
+	{
+		pdm.CalcShape2D(rigid_shape, params_local, params_global);
+		stop_fitting = FitCompleted(rigid_shape, current_shape, state.fit_start, parameters);
+		if(stop_fitting)
+		{
+			this->model_likelihood = rigid_likelihood;
+		}
+	}
 
+	// non-rigid optimisation
+	if(!stop_fitting)
+	{
 		// If we are terminating next iteration, make sure to record the model likelihood
-		if(scale == num_scales - 1 || window_sizes[scale + 1] == 0 || params_global[0] < 0.30)
+		if(adaptive_fit || scale == num_scales - 1 || window_sizes[scale + 1] == 0 || params_global[0] < 0.30)
 		{			
 			this->model_likelihood = this->NU_RLMS(params_global, params_local, patch_expert_responses, cv::Vec6f(params_global), params_local.clone(), current_shape, sim_img_to_ref, sim_ref_to_img, window_size, view_id, false, scale, this->landmark_likelihoods, tmp_parameters, true);
 		}
@@ -801,20 +1267,65 @@ bool CLNF::Fit(const cv::Mat_<float>& im, const std::vector<int>& window_sizes,
 			this->NU_RLMS(params_global, params_local, patch_expert_responses, cv::Vec6f(params_global), params_local.clone(), current_shape, sim_img_to_ref, sim_ref_to_img, window_size, view_id, false, scale, this->landmark_likelihoods, tmp_parameters, false);
 		}
 
-		// Can't track very small images reliably (less than ~30px across)
-		if (params_global[0] < 0.25)
+		// Skip the remaining scales if the non-rigid optimisation barely moved the model, or if out of time
+		if(adaptive_fit)
 		{
-			std::cout << "Face too small for landmark detection" << std::endl;
-			return false;
+			cv::Mat_<float> non_rigid_shape;
+			pdm.CalcShape2D(non_rigid_shape, params_local, params_global);
+			stop_fitting = FitCompleted(non_rigid_shape, rigid_shape, state.fit_start, parameters);
 		}
+	}
+
+	// Can't track very small images reliably (less than ~30px across)
+	if (params_global[0] < 0.25)
+	{
+		std::cout << "Face too small for landmark detection" << std::endl;
+		state.success = false;
+		state.finished = true;
+		return;
+	}
 
-		// Making sure we do not upsample too much
-		if (active_scale < num_scales - 1 && 0.9 * patch_experts.patch_scaling[active_scale + 1] < params_global[0])
-			active_scale = active_scale + 1;
+	// Making sure we do not upsample too much
+	if (state.active_scale < num_scales - 1 && 0.9 * patch_experts.patch_scaling[state.active_scale + 1] < params_global[0])
+		state.active_scale = state.active_scale + 1;
+
+	if(stop_fitting)
+		state.finished = true;
+}
+
+//=============================================================================
+void CLNF::FitEnd(FitState& state)
+{
+	state.finished = true;
+	fit_statistics.fit_time = 1000.0 * (cv::getTickCount() - state.fit_start) / cv::getTickFrequency();
+}
+
+//=============================================================================
+// Checks if the adaptive fitting should stop after a pass, either as the model converged or as the time budget ran out
+bool CLNF::FitCompleted(const cv::Mat_<float>& shape_after, const cv::Mat_<float>& shape_before, int64 fit_start, const FaceModelParameters& parameters)
+{
+	if(parameters.fit_convergence_threshold > 0)
+	{
+		// Root mean square movement of the landmarks during the pass
+		float update = (float)(cv::norm(shape_after, shape_before) / sqrt((double)pdm.NumberOfPoints()));
 
+		if(update < parameters.fit_convergence_threshold && fit_statistics.mean_shift < parameters.fit_convergence_threshold)
+		{
+			fit_statistics.converged_early = true;
+			return true;
+		}
 	}
 
-	return true;
+	if(parameters.fit_time_budget > 0)
+	{
+		double elapsed = 1000.0 * (cv::getTickCount() - fit_start) / cv::getTickFrequency();
+		if(elapsed > parameters.fit_time_budget)
+		{
+			fit_statistics.time_budget_exceeded = true;
+			return true;
+		}
+	}
+	return false;
 }
 
 void CLNF::NonVectorisedMeanShift_precalc_kde(cv::Mat_<float>& out_mean_shifts, const std::vector<cv::Mat_<float> >& patch_expert_responses,
@@ -935,53 +1446,49 @@ void CLNF::NonVectorisedMeanShift_precalc_kde(cv::Mat_<float>& out_mean_shifts,
 }
 
 void CLNF::GetWeightMatrix(cv::Mat_<float>& WeightMatrix, int scale, int view_id, const FaceModelParameters& parameters)
+{
+	cv::Mat_<float> weights;
+	GetWeights(weights, scale, view_id, parameters);
+
+	// The same weight is used for the x and y dimensions
+	cv::Mat_<float> weights_xy;
+	cv::vconcat(weights, weights, weights_xy);
+	WeightMatrix = cv::Mat::diag(weights_xy);
+}
+
+void CLNF::GetWeights(cv::Mat_<float>& weights, int scale, int view_id, const FaceModelParameters& parameters)
 {
 	int n = pdm.NumberOfPoints();  
 
-	// Is the weight matrix needed at all
+	// Are the weights needed at all
 	if(parameters.weight_factor > 0)
 	{
-		WeightMatrix = cv::Mat_<float>::zeros(n*2, n*2);
+		weights = cv::Mat_<float>::zeros(n, 1);
 
 		for (int p=0; p < n; p++)
 		{
 			if (!patch_experts.cen_expert_intensity.empty())
 			{
-
-				// for the x dimension
-				WeightMatrix.at<float>(p, p) = WeightMatrix.at<float>(p, p) + patch_experts.cen_expert_intensity[scale][view_id][p].confidence;
-
-				// for they y dimension
-				WeightMatrix.at<float>(p + n, p + n) = WeightMatrix.at<float>(p, p);
-
+				weights.at<float>(p) = patch_experts.cen_expert_intensity[scale][view_id][p].confidence;
 			}
 			else if(!patch_experts.ccnf_expert_intensity.empty())
 			{
-
-				// for the x dimension
-				WeightMatrix.at<float>(p,p) = WeightMatrix.at<float>(p,p)  + patch_experts.ccnf_expert_intensity[scale][view_id][p].patch_confidence;
-				
-				// for they y dimension
-				WeightMatrix.at<float>(p+n,p+n) = WeightMatrix.at<float>(p,p);
-
+				weights.at<float>(p) = patch_experts.ccnf_expert_intensity[scale][view_id][p].patch_confidence;
 			}
 			else
 			{
 				// Across the modalities add the confidences
 				for(size_t pc=0; pc < patch_experts.svr_expert_intensity[scale][view_id][p].svr_patch_experts.size(); pc++)
 				{
-					// for the x dimension
-					WeightMatrix.at<float>(p,p) = WeightMatrix.at<float>(p,p)  + patch_experts.svr_expert_intensity[scale][view_id][p].svr_patch_experts.at(pc).confidence;
+					weights.at<float>(p) = weights.at<float>(p) + patch_experts.svr_expert_intensity[scale][view_id][p].svr_patch_experts.at(pc).confidence;
 				}	
-				// for the y dimension
-				WeightMatrix.at<float>(p+n,p+n) = WeightMatrix.at<float>(p,p);
 			}
 		}
-		WeightMatrix = parameters.weight_factor * WeightMatrix;
+		weights = parameters.weight_factor * weights;
 	}
 	else
 	{
-		WeightMatrix = cv::Mat_<float>::eye(n*2, n*2);
+		weights = cv::Mat_<float>::ones(n, 1);
 	}
 
 }
@@ -1024,8 +1531,19 @@ float CLNF::NU_RLMS(cv::Vec6f& final_global, cv::Mat_<float>& final_local, const
 		regTerm = cv::Mat::diag(regularisations.t());
 	}	
 
+	// Only the diagonal of the weight matrix is needed by the fixed size solver, the full one is created if the generic solver is used
+	cv::Mat_<float> weights;
+	GetWeights(weights, scale, view_id, parameters);
+
 	cv::Mat_<float> WeightMatrix;
-	GetWeightMatrix(WeightMatrix, scale, view_id, parameters);
+
+	// The common model sizes have a fixed size solver
+	bool fixed_solver = HasFixedRLMSSolver(n, m);
+	cv::Mat_<float> regularisations_local;
+	if(fixed_solver && !rigid)
+	{
+		regularisations_local = regTerm(cv::Rect(6, 6, m, m)).diag().clone();
+	}
 
 	cv::Mat_<float> dxs, dys;
 	
@@ -1033,35 +1551,24 @@ float CLNF::NU_RLMS(cv::Vec6f& final_global, cv::Mat_<float>& final_local, const
 	cv::Mat_<float> mean_shifts(2 * pdm.NumberOfPoints(), 1, 0.0);
 
 	// Number of iterations
-	for(int iter = 0; iter < parameters.num_optimisation_iteration; iter++)
+	int iter = 0;
+	for(; iter < parameters.num_optimisation_iteration; iter++)
 	{
 		// get the current estimates of x
 		pdm.CalcShape2D(current_shape, current_local, current_global);
 		
 		if(iter > 0)
 		{
-			// if the shape hasn't changed terminate
+			// if the shape hasn't changed terminate (the iteration that found this counts in the fit statistics as well)
 			if(norm(current_shape, previous_shape) < 0.01)
 			{				
+				iter++;
 				break;
 			}
 		}
 
 		current_shape.copyTo(previous_shape);
 		
-		// Jacobian, and transposed weighted jacobian
-		cv::Mat_<float> J, J_w_t;
-
-		// calculate the appropriate Jacobians in 2D, even though the actual behaviour is in 3D, using small angle approximation and oriented shape
-		if(rigid)
-		{
-			pdm.ComputeRigidJacobian(current_local, current_global, J, WeightMatrix, J_w_t);
-		}
-		else
-		{
-			pdm.ComputeJacobian(current_local, current_global, J, WeightMatrix, J_w_t);
-		}
-		
 		// useful for mean shift calculation
 		float a = -0.5/(parameters.sigma * parameters.sigma);
 
@@ -1082,50 +1589,85 @@ float CLNF::NU_RLMS(cv::Vec6f& final_global, cv::Mat_<float>& final_local, const
 		mean_shifts_2D = mean_shifts_2D * cv::Mat(sim_ref_to_img).t();
 		mean_shifts = cv::Mat(mean_shifts_2D.t()).reshape(1, n*2);
 
-		// remove non-visible observations
+		// The magnitude of the mean shifts is used to judge convergence when fitting adaptively
+		float mean_shift_sq = 0;
+		int num_visible = 0;
 		for(int i = 0; i < n; ++i)
 		{
-			// if patch unavailable for current index
-			if(patch_experts.visibilities[scale][view_id].at<int>(i,0) == 0)
-			{				
-				cv::Mat Jx = J.row(i);
-				Jx = cvScalar(0);
-				cv::Mat Jy = J.row(i+n);
-				Jy = cvScalar(0);
-
-				Jx = J_w_t.col(i);
-				Jx = cvScalar(0);
-				Jy = J_w_t.col(i + n);
-				Jy = cvScalar(0);
-
-				mean_shifts.at<float>(i,0) = 0.0f;
-				mean_shifts.at<float>(i+n,0) = 0.0f;
+			if(patch_experts.visibilities[scale][view_id].at<int>(i,0) != 0)
+			{
+				mean_shift_sq += mean_shifts.at<float>(i,0) * mean_shifts.at<float>(i,0) + mean_shifts.at<float>(i+n,0) * mean_shifts.at<float>(i+n,0);
+				num_visible++;
 			}
 		}
+		fit_statistics.mean_shift = num_visible > 0 ? sqrt(mean_shift_sq / num_visible) : 0.0f;
 
-		// projection of the meanshifts onto the jacobians (using the weighted Jacobian, see Baltrusaitis 2013)
-		cv::Mat_<float> J_w_t_m = J_w_t * mean_shifts;
+		// Solve for the parameter update (from Baltrusaitis 2013 based on eq (36) Saragih 2011)
+		cv::Mat_<float> param_update;
 
-		// Add the regularisation term
-		if(!rigid)
+		if(!fixed_solver || !SolveRLMSFixed(pdm, current_local, current_global, weights, mean_shifts, patch_experts.visibilities[scale][view_id], regularisations_local, rigid, param_update))
 		{
-			J_w_t_m(cv::Rect(0,6,1, m)) = J_w_t_m(cv::Rect(0,6,1, m)) - regTerm(cv::Rect(6,6, m, m)) * current_local;
-		}
+			if(WeightMatrix.empty())
+			{
+				GetWeightMatrix(WeightMatrix, scale, view_id, parameters);
+			}
+
+			// Jacobian, and transposed weighted jacobian
+			cv::Mat_<float> J, J_w_t;
+
+			// calculate the appropriate Jacobians in 2D, even though the actual behaviour is in 3D, using small angle approximation and oriented shape
+			if(rigid)
+			{
+				pdm.ComputeRigidJacobian(current_local, current_global, J, WeightMatrix, J_w_t);
+			}
+			else
+			{
+				pdm.ComputeJacobian(current_local, current_global, J, WeightMatrix, J_w_t);
+			}
+
+			// remove non-visible observations
+			for(int i = 0; i < n; ++i)
+			{
+				// if patch unavailable for current index
+				if(patch_experts.visibilities[scale][view_id].at<int>(i,0) == 0)
+				{				
+					cv::Mat Jx = J.row(i);
+					Jx = cvScalar(0);
+					cv::Mat Jy = J.row(i+n);
+					Jy = cvScalar(0);
+
+					Jx = J_w_t.col(i);
+					Jx = cvScalar(0);
+					Jy = J_w_t.col(i + n);
+					Jy = cvScalar(0);
+
+					mean_shifts.at<float>(i,0) = 0.0f;
+					mean_shifts.at<float>(i+n,0) = 0.0f;
+				}
+			}
 
-		cv::Mat_<float> Hessian = regTerm.clone();
+			// projection of the meanshifts onto the jacobians (using the weighted Jacobian, see Baltrusaitis 2013)
+			cv::Mat_<float> J_w_t_m = J_w_t * mean_shifts;
 
-		// Perform matrix multiplication in OpenBLAS (fortran call)
-		float alpha1 = 1.0;
-		float beta1 = 1.0;
-		char N[2]; N[0] = 'N';
-		sgemm_(N, N, &J.cols, &J_w_t.rows, &J_w_t.cols, &alpha1, (float*)J.data, &J.cols, (float*)J_w_t.data, &J_w_t.cols, &beta1, (float*)Hessian.data, &J.cols);
+			// Add the regularisation term
+			if(!rigid)
+			{
+				J_w_t_m(cv::Rect(0,6,1, m)) = J_w_t_m(cv::Rect(0,6,1, m)) - regTerm(cv::Rect(6,6, m, m)) * current_local;
+			}
 
-		// Above is a fast (but ugly) version of 
-		// cv::Mat_<float> Hessian = J_w_t * J + regTerm;
+			cv::Mat_<float> Hessian = regTerm.clone();
 
-		// Solve for the parameter update (from Baltrusaitis 2013 based on eq (36) Saragih 2011)
-		cv::Mat_<float> param_update;
-		cv::solve(Hessian, J_w_t_m, param_update, cv::DECOMP_CHOLESKY);
+			// Perform matrix multiplication in OpenBLAS (fortran call)
+			float alpha1 = 1.0;
+			float beta1 = 1.0;
+			char N[2]; N[0] = 'N';
+			sgemm_(N, N, &J.cols, &J_w_t.rows, &J_w_t.cols, &alpha1, (float*)J.data, &J.cols, (float*)J_w_t.data, &J_w_t.cols, &beta1, (float*)Hessian.data, &J.cols);
+
+			// Above is a fast (but ugly) version of 
+			// cv::Mat_<float> Hessian = J_w_t * J + regTerm;
+
+			cv::solve(Hessian, J_w_t_m, param_update, cv::DECOMP_CHOLESKY);
+		}
 		
 		// update the reference
 		pdm.UpdateModelParameters(param_update, current_local, current_global);		
@@ -1135,6 +1677,15 @@ float CLNF::NU_RLMS(cv::Vec6f& final_global, cv::Mat_<float>& final_local, const
 
 	}
 
+	if(rigid)
+	{
+		fit_statistics.rigid_iterations += iter;
+	}
+	else
+	{
+		fit_statistics.non_rigid_iterations += iter;
+	}
+
 	// compute the log likelihood
 	float loglhood = 0;
 	
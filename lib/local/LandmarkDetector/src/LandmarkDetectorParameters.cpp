@@ -135,6 +135,98 @@ FaceModelParameters::FaceModelParameters(std::vector<std::string> &arguments)
 			valid[i + 1] = false;
 			i++;
 		}
+		else if (arguments[i].compare("-validate_every") == 0)
+		{
+			std::stringstream data(arguments[i + 1]);
+			data >> validation_interval;
+			valid[i] = false;
+			valid[i + 1] = false;
+			i++;
+		}
+		else if (arguments[i].compare("-validate_skip_lhood") == 0)
+		{
+			std::stringstream data(arguments[i + 1]);
+			data >> validation_skip_lhood_drop;
+			valid[i] = false;
+			valid[i + 1] = false;
+			i++;
+		}
+		else if (arguments[i].compare("-validate_max_skip") == 0)
+		{
+			std::stringstream data(arguments[i + 1]);
+			data >> validation_max_skipped;
+			valid[i] = false;
+			valid[i + 1] = false;
+			i++;
+		}
+		else if (arguments[i].compare("-validate_rot_change") == 0)
+		{
+			std::stringstream data(arguments[i + 1]);
+			data >> validation_rotation_change;
+			valid[i] = false;
+			valid[i + 1] = false;
+			i++;
+		}
+		else if (arguments[i].compare("-template_refresh") == 0)
+		{
+			std::stringstream data(arguments[i + 1]);
+			data >> face_template_refresh;
+			valid[i] = false;
+			valid[i + 1] = false;
+			i++;
+		}
+		else if (arguments[i].compare("-motion_model") == 0)
+		{
+			std::stringstream data(arguments[i + 1]);
+			int motion_model;
+			data >> motion_model;
+
+			use_motion_model = (bool)(motion_model != 0);
+			valid[i] = false;
+			valid[i + 1] = false;
+			i++;
+		}
+		else if (arguments[i].compare("-motion_max_error") == 0)
+		{
+			std::stringstream data(arguments[i + 1]);
+			data >> motion_model_max_error;
+			valid[i] = false;
+			valid[i + 1] = false;
+			i++;
+		}
+		else if (arguments[i].compare("-refine_hierarchical") == 0)
+		{
+			std::stringstream data(arguments[i + 1]);
+			int refine;
+			data >> refine;
+
+			refine_hierarchical = (bool)(refine != 0);
+			valid[i] = false;
+			valid[i + 1] = false;
+			i++;
+		}
+		else if (arguments[i].compare("-async_detect") == 0)
+		{
+			std::stringstream data(arguments[i + 1]);
+			int async_detect;
+			data >> async_detect;
+
+			async_face_detection = (bool)(async_detect != 0);
+			valid[i] = false;
+			valid[i + 1] = false;
+			i++;
+		}
+		else if (arguments[i].compare("-refine_async") == 0)
+		{
+			std::stringstream data(arguments[i + 1]);
+			int refine_async;
+			data >> refine_async;
+
+			refine_hierarchical_async = (bool)(refine_async != 0);
+			valid[i] = false;
+			valid[i + 1] = false;
+			i++;
+		}
 		else if (arguments[i].compare("-n_iter") == 0)
 		{
 			std::stringstream data(arguments[i + 1]);
@@ -144,6 +236,63 @@ FaceModelParameters::FaceModelParameters(std::vector<std::string> &arguments)
 			valid[i + 1] = false;
 			i++;
 		}
+		else if (arguments[i].compare("-n_iter_scale") == 0)
+		{
+			// Comma separated iterations per scale e.g. 5,5,3,2, values that are not positive numbers are ignored
+			std::stringstream data(arguments[i + 1]);
+			std::string iterations;
+			num_optimisation_iteration_scale.clear();
+			while (std::getline(data, iterations, ','))
+			{
+				std::stringstream iterations_data(iterations);
+				int num_iterations = 0;
+				iterations_data >> num_iterations;
+				if (num_iterations > 0)
+				{
+					num_optimisation_iteration_scale.push_back(num_iterations);
+				}
+			}
+
+			valid[i] = false;
+			valid[i + 1] = false;
+			i++;
+		}
+		else if (arguments[i].compare("-fit_converge") == 0)
+		{
+			std::stringstream data(arguments[i + 1]);
+			data >> fit_convergence_threshold;
+
+			valid[i] = false;
+			valid[i + 1] = false;
+			i++;
+		}
+		else if (arguments[i].compare("-fit_budget") == 0)
+		{
+			std::stringstream data(arguments[i + 1]);
+			data >> fit_time_budget;
+
+			valid[i] = false;
+			valid[i + 1] = false;
+			i++;
+		}
+		else if (arguments[i].compare("-threads") == 0)
+		{
+			std::stringstream data(arguments[i + 1]);
+			data >> num_threads;
+
+			valid[i] = false;
+			valid[i + 1] = false;
+			i++;
+		}
+		else if (arguments[i].compare("-cpu_affinity") == 0)
+		{
+			std::stringstream data(arguments[i + 1]);
+			data >> first_core;
+
+			valid[i] = false;
+			valid[i + 1] = false;
+			i++;
+		}
 		else if (arguments[i].compare("-wild") == 0)
 		{
 			// For in the wild fitting these parameters are suitable
@@ -284,15 +433,26 @@ void FaceModelParameters::init()
 	// number of iterations that will be performed at each scale
 	num_optimisation_iteration = 5;
 
+	// All of the scales are used fully by default
+	fit_convergence_threshold = 0.0f;
+	fit_time_budget = 0.0f;
+
 	// using an external face checker based on SVM
 	validate_detections = true;
 
 	// Using hierarchical refinement by default (can be turned off)
 	refine_hierarchical = true;
 
+	// The hierarchical refinement is finished before the landmarks are returned by default
+	refine_hierarchical_async = false;
+
 	// Refining parameters by default
 	refine_parameters = true;
 
+	// Using all of the cores by default
+	num_threads = 0;
+	first_core = -1;
+
 	window_sizes_small = std::vector<int>(4);
 	window_sizes_init = std::vector<int>(4);
 
@@ -311,10 +471,18 @@ void FaceModelParameters::init()
 	face_template_scale = 0.3f;
 	// Off by default (as it might lead to some slight inaccuracies in slowly moving faces)
 	use_face_template = false;
+	face_template_refresh = 0.9f;
+
+	// Off by default, the tracking starts from the parameters of the last frame
+	use_motion_model = false;
+	motion_model_max_error = 0.05f;
 
 	// For first frame use the initialisation
 	window_sizes_current = window_sizes_init;
 
+	// By default every frame is tracked
+	frame_stride = 1;
+
 	model_location = "model/main_ceclm_general.txt";
 	curr_landmark_detector = CECLM_DETECTOR;
 
@@ -324,11 +492,22 @@ void FaceModelParameters::init()
 
 	validation_boundary = 0.725f;
 
+	// Every frame is validated by default
+	validation_skip_lhood_drop = 0.0f;
+	validation_max_skipped = 5;
+
+	// The rotation trigger is only used when validation can be skipped
+	validation_interval = 1;
+	validation_rotation_change = 10.0f;
+
 	limit_pose = true;
 	multi_view = false;
 
 	reinit_video_every = 2;
 
+	// The tracking waits for the face detection by default
+	async_face_detection = false;
+
 	// Face detection
 	haar_face_detector_location = "classifiers/haarcascade_frontalface_alt.xml";
 	mtcnn_face_detector_location = "model/mtcnn_detector/MTCNN_detector.txt";
@@ -0,0 +1,93 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2017, Carnegie Mellon University and University of Cambridge,
+// all rights reserved.
+//
+// ACADEMIC OR NON-PROFIT ORGANIZATION NONCOMMERCIAL RESEARCH USE ONLY
+//
+// BY USING OR DOWNLOADING THE SOFTWARE, YOU ARE AGREEING TO THE TERMS OF THIS LICENSE AGREEMENT.  
+// IF YOU DO NOT AGREE WITH THESE TERMS, YOU MAY NOT USE OR DOWNLOAD THE SOFTWARE.
+//
+// License can be found in OpenFace-license.txt
+//
+//     * Any publications arising from the use of this software, including but
+//       not limited to academic journal and conference publications, technical
+//       reports and manuals, must cite at least one of the following works:
+//
+//       OpenFace 2.0: Facial Behavior Analysis Toolkit
+//       Tadas Baltruaitis, Amir Zadeh, Yao Chong Lim, and Louis-Philippe Morency
+//       in IEEE International Conference on Automatic Face and Gesture Recognition, 2018  
+//
+//       Convolutional experts constrained local model for facial landmark detection.
+//       A. Zadeh, T. Baltruaitis, and Louis-Philippe Morency,
+//       in Computer Vision and Pattern Recognition Workshops, 2017.    
+//
+//       Rendering of Eyes for Eye-Shape Registration and Gaze Estimation
+//       Erroll Wood, Tadas Baltruaitis, Xucong Zhang, Yusuke Sugano, Peter Robinson, and Andreas Bulling 
+//       in IEEE International. Conference on Computer Vision (ICCV),  2015 
+//
+//       Cross-dataset learning and person-specific normalisation for automatic Action Unit detection
+//       Tadas Baltruaitis, Marwa Mahmoud, and Peter Robinson 
+//       in Facial Expression Recognition and Analysis Challenge, 
+//       IEEE International Conference on Automatic Face and Gesture Recognition, 2015 
+//
+
+#include "stdafx.h"
+
+#include <MotionModel.h>
+
+using namespace LandmarkDetector;
+
+// The gains of the filter, how much of the prediction error goes to the position and to the velocity (the beta is the Benedict-Bordner
+// choice for the alpha, which trades noise reduction against lag on manoeuvres; it is larger than the critically damped gain, so the response is slightly underdamped)
+static const float MOTION_ALPHA = 0.8f;
+static const float MOTION_BETA = MOTION_ALPHA * MOTION_ALPHA / (2.0f - MOTION_ALPHA);
+
+MotionModel::MotionModel()
+{
+	Reset();
+}
+
+void MotionModel::Reset()
+{
+	position = cv::Vec6f(0, 0, 0, 0, 0, 0);
+	velocity = cv::Vec6f(0, 0, 0, 0, 0, 0);
+	num_updates = 0;
+	last_error = 0;
+}
+
+void MotionModel::Update(const cv::Vec6f& params_global, int frame_step, float face_width)
+{
+	frame_step = std::max(frame_step, 1);
+
+	if (num_updates == 0)
+	{
+		position = params_global;
+		velocity = cv::Vec6f(0, 0, 0, 0, 0, 0);
+	}
+	else if (num_updates == 1)
+	{
+		// The first velocity estimate comes directly from two frames
+		cv::Vec6f predicted = Predict(frame_step);
+		last_error = (float)cv::norm(cv::Vec2f(params_global[4] - predicted[4], params_global[5] - predicted[5])) / std::max(face_width, 1.0f);
+
+		velocity = (params_global - position) * (1.0f / frame_step);
+		position = params_global;
+	}
+	else
+	{
+		cv::Vec6f predicted = Predict(frame_step);
+		cv::Vec6f residual = params_global - predicted;
+
+		last_error = (float)cv::norm(cv::Vec2f(residual[4], residual[5])) / std::max(face_width, 1.0f);
+
+		position = predicted + MOTION_ALPHA * residual;
+		velocity = velocity + (MOTION_BETA / frame_step) * residual;
+	}
+
+	num_updates++;
+}
+
+cv::Vec6f MotionModel::Predict(int frame_step) const
+{
+	return position + velocity * (float)std::max(frame_step, 1);
+}
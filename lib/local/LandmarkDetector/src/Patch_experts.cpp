@@ -47,6 +47,7 @@
 #endif
 
 #include "LandmarkDetectorUtils.h"
+#include "TaskScheduler.h"
 
 using namespace LandmarkDetector;
 
@@ -134,15 +135,32 @@ void Patch_experts::Response(std::vector<cv::Mat_<float> >& patch_expert_respons
 	cv::Matx22f& sim_img_to_ref, const cv::Mat_<float>& grayscale_image, const PDM& pdm, const cv::Vec6f& params_global,
 	const cv::Mat_<float>& params_local, int window_size, int scale)
 {
+	ResponseContext context;
+	PrepareResponse(context, sim_ref_to_img, sim_img_to_ref, pdm, params_global, params_local, window_size, scale);
 
-	int view_id = GetViewIdx(params_global, scale);
+	// calculate the patch responses for every landmark (this is the heavy lifting of landmark detection)
+	TaskScheduler::ParallelFor(cv::Range(0, context.visible_landmarks.size()), [&](const cv::Range& range) {
+		for (int i = range.start; i < range.end; i++)
+		{
+			LandmarkResponse(patch_expert_responses, context, grayscale_image, context.visible_landmarks[i]);
+		}
+	});
+}
+
+//=============================================================================
+// Computing everything that is shared by the landmarks before their responses are computed (the view, the similarity transforms, CCNF sigmas and CEN interpolation)
+void Patch_experts::PrepareResponse(ResponseContext& context, cv::Matx22f& sim_ref_to_img, cv::Matx22f& sim_img_to_ref, const PDM& pdm, const cv::Vec6f& params_global,
+	const cv::Mat_<float>& params_local, int window_size, int scale)
+{
+	context.view_id = GetViewIdx(params_global, scale);
+	context.window_size = window_size;
+	context.scale = scale;
 
+	int view_id = context.view_id;
 	int n = pdm.NumberOfPoints();
 
 	// Compute the current landmark locations (around which responses will be computed)
-	cv::Mat_<float> landmark_locations;
-
-	pdm.CalcShape2D(landmark_locations, params_local, params_global);
+	pdm.CalcShape2D(context.landmark_locations, params_local, params_global);
 
 	cv::Mat_<float> reference_shape;
 
@@ -154,13 +172,13 @@ void Patch_experts::Response(std::vector<cv::Mat_<float> >& patch_expert_respons
 
 	// similarity and inverse similarity transform to and from image and reference shape
 	cv::Mat_<float> reference_shape_2D = (reference_shape.reshape(1, 2).t());
-	cv::Mat_<float> image_shape_2D = landmark_locations.reshape(1, 2).t();
+	cv::Mat_<float> image_shape_2D = context.landmark_locations.reshape(1, 2).t();
 
 	sim_img_to_ref = Utilities::AlignShapesWithScale(image_shape_2D, reference_shape_2D);
 	sim_ref_to_img = sim_img_to_ref.inv(cv::DECOMP_LU);
 	
-	float a1 = sim_ref_to_img(0, 0);
-	float b1 = -sim_ref_to_img(0, 1);
+	context.a1 = sim_ref_to_img(0, 0);
+	context.b1 = -sim_ref_to_img(0, 1);
 
 	bool use_ccnf = !this->ccnf_expert_intensity.empty();
 	bool use_cen = !this->cen_expert_intensity.empty();
@@ -196,7 +214,7 @@ void Patch_experts::Response(std::vector<cv::Mat_<float> >& patch_expert_respons
 	}
 
 	// If using CEN precalculate interpolation matrix
-	cv::Mat_<float> interp_mat;
+	context.interp_mat = cv::Mat_<float>();
 	if (use_cen)
 	{
 		// Assuming the same size for all experts
@@ -204,136 +222,146 @@ void Patch_experts::Response(std::vector<cv::Mat_<float> >& patch_expert_respons
 		int area_of_interest_width = window_size + support_region - 1;
 		int area_of_interest_height = window_size + support_region - 1;
 		int resp_size = area_of_interest_height - support_region + 1;
-		interpolationMatrix(interp_mat, resp_size, resp_size, area_of_interest_width, area_of_interest_height);
+		interpolationMatrix(context.interp_mat, resp_size, resp_size, area_of_interest_width, area_of_interest_height);
 	}
 
 	// We do not want to create threads for invisible landmarks, so construct an index of visible ones
-	std::vector<int> vis_lmk = Collect_visible_landmarks(visibilities, scale, view_id, n);
+	context.visible_landmarks = Collect_visible_landmarks(visibilities, scale, view_id, n);
+}
 
-	// calculate the patch responses for every landmark (this is the heavy lifting of landmark detection)
-	parallel_for_(cv::Range(0, vis_lmk.size()), [&](const cv::Range& range) {
-		for (int i = range.start; i < range.end; i++)
-		{
+//=============================================================================
+// The response of a single (visible) landmark, the responses of different landmarks can be computed in parallel
+void Patch_experts::LandmarkResponse(std::vector<cv::Mat_<float> >& patch_expert_responses, const ResponseContext& context, const cv::Mat_<float>& grayscale_image, int ind)
+{
+	int view_id = context.view_id;
+	int window_size = context.window_size;
+	int scale = context.scale;
+	int n = context.landmark_locations.rows / 2;
 
-			// Work out how big the area of interest has to be to get a response of window size
-			int area_of_interest_width;
-			int area_of_interest_height;
-			int ind = vis_lmk.at(i);
+	const cv::Mat_<float>& landmark_locations = context.landmark_locations;
+	cv::Mat_<float> interp_mat = context.interp_mat;
+	float a1 = context.a1;
+	float b1 = context.b1;
 
-			if (use_cen)
-			{
-				area_of_interest_width = window_size + cen_expert_intensity[scale][view_id][ind].width_support - 1;
-				area_of_interest_height = window_size + cen_expert_intensity[scale][view_id][ind].height_support - 1;
-			}
-			else if (use_ccnf)
-			{
-				area_of_interest_width = window_size + ccnf_expert_intensity[scale][view_id][ind].width - 1;
-				area_of_interest_height = window_size + ccnf_expert_intensity[scale][view_id][ind].height - 1;
-			}
-			else
-			{
-				area_of_interest_width = window_size + svr_expert_intensity[scale][view_id][ind].width - 1;
-				area_of_interest_height = window_size + svr_expert_intensity[scale][view_id][ind].height - 1;
-			}
+	bool use_ccnf = !this->ccnf_expert_intensity.empty();
+	bool use_cen = !this->cen_expert_intensity.empty();
 
-			// scale and rotate to mean shape to reference frame
-			cv::Mat sim = (cv::Mat_<float>(2, 3) << a1, -b1, landmark_locations.at<float>(ind, 0) - a1 * (area_of_interest_width - 1.0f) / 2.0f + b1 * (area_of_interest_width - 1.0f) / 2.0f, b1, a1, landmark_locations.at<float>(ind + n, 0) - a1 * (area_of_interest_width - 1.0f) / 2.0f - b1 * (area_of_interest_width - 1.0f) / 2.0f);
+	// Work out how big the area of interest has to be to get a response of window size
+	int area_of_interest_width;
+	int area_of_interest_height;
 
-			// Extract the region of interest around the current landmark location
-			cv::Mat_<float> area_of_interest(area_of_interest_height, area_of_interest_width, 0.0f);
+	if (use_cen)
+	{
+		area_of_interest_width = window_size + cen_expert_intensity[scale][view_id][ind].width_support - 1;
+		area_of_interest_height = window_size + cen_expert_intensity[scale][view_id][ind].height_support - 1;
+	}
+	else if (use_ccnf)
+	{
+		area_of_interest_width = window_size + ccnf_expert_intensity[scale][view_id][ind].width - 1;
+		area_of_interest_height = window_size + ccnf_expert_intensity[scale][view_id][ind].height - 1;
+	}
+	else
+	{
+		area_of_interest_width = window_size + svr_expert_intensity[scale][view_id][ind].width - 1;
+		area_of_interest_height = window_size + svr_expert_intensity[scale][view_id][ind].height - 1;
+	}
 
-			cv::warpAffine(grayscale_image, area_of_interest, sim, area_of_interest.size(), cv::WARP_INVERSE_MAP + cv::INTER_LINEAR);
+	// scale and rotate to mean shape to reference frame
+	cv::Mat sim = (cv::Mat_<float>(2, 3) << a1, -b1, landmark_locations.at<float>(ind, 0) - a1 * (area_of_interest_width - 1.0f) / 2.0f + b1 * (area_of_interest_width - 1.0f) / 2.0f, b1, a1, landmark_locations.at<float>(ind + n, 0) - a1 * (area_of_interest_width - 1.0f) / 2.0f - b1 * (area_of_interest_width - 1.0f) / 2.0f);
 
-			// Get intensity response either from the SVR, CCNF, or CEN patch experts (prefer CEN as they are the most accurate so far)
-			if (!cen_expert_intensity.empty())
-			{
+	// Extract the region of interest around the current landmark location
+	cv::Mat_<float> area_of_interest(area_of_interest_height, area_of_interest_width, 0.0f);
 
-				int im2col_size = (area_of_interest_width * area_of_interest_height - 1) / 2;
+	cv::warpAffine(grayscale_image, area_of_interest, sim, area_of_interest.size(), cv::WARP_INVERSE_MAP + cv::INTER_LINEAR);
 
-				cv::Mat_<float> prealloc_mat = preallocated_im2col[ind][im2col_size];
+	// Get intensity response either from the SVR, CCNF, or CEN patch experts (prefer CEN as they are the most accurate so far)
+	if (!cen_expert_intensity.empty())
+	{
 
-				// If frontal view we can do mirrored landmarks together
-				if (view_id == 0)
-				{
-					// If the patch expert does not have values, means it's a mirrored version and will be done in another part of a loop
-					if (!cen_expert_intensity[scale][view_id][ind].biases.empty())
-					{
-						// No mirrored expert, so do normally
-						int mirror_id = mirror_inds.at<int>(ind);
-						if (mirror_id == ind)
-						{
-							cv::Mat_<float> empty(0, 0, 0.0f);
-							cen_expert_intensity[scale][view_id][ind].ResponseSparse(area_of_interest, empty, patch_expert_responses[ind], empty, interp_mat, prealloc_mat, empty);
-						}
-						else
-						{
+		int im2col_size = (area_of_interest_width * area_of_interest_height - 1) / 2;
 
-							// Grab mirrored area of interest
+		cv::Mat_<float> prealloc_mat = preallocated_im2col[ind][im2col_size];
 
-							// scale and rotate to mean shape to reference frame
-							cv::Mat sim_r = (cv::Mat_<float>(2, 3) << a1, -b1, landmark_locations.at<float>(mirror_id, 0) - a1 * (area_of_interest_width - 1.0f) / 2.0f + b1 * (area_of_interest_width - 1.0f) / 2.0f, b1, a1, landmark_locations.at<float>(mirror_id + n, 0) - a1 * (area_of_interest_width - 1.0f) / 2.0f - b1 * (area_of_interest_width - 1.0f) / 2.0f);
+		// If frontal view we can do mirrored landmarks together
+		if (view_id == 0)
+		{
+			// If the patch expert does not have values, means it's a mirrored version and will be done in another part of a loop
+			if (!cen_expert_intensity[scale][view_id][ind].biases.empty())
+			{
+				// No mirrored expert, so do normally
+				int mirror_id = mirror_inds.at<int>(ind);
+				if (mirror_id == ind)
+				{
+					cv::Mat_<float> empty(0, 0, 0.0f);
+					cen_expert_intensity[scale][view_id][ind].ResponseSparse(area_of_interest, empty, patch_expert_responses[ind], empty, interp_mat, prealloc_mat, empty);
+				}
+				else
+				{
 
-							// Extract the region of interest around the current landmark location
-							cv::Mat_<float> area_of_interest_r(area_of_interest_height, area_of_interest_width, 0.0f);
+					// Grab mirrored area of interest
 
-							cv::warpAffine(grayscale_image, area_of_interest_r, sim_r, area_of_interest_r.size(), cv::WARP_INVERSE_MAP + cv::INTER_LINEAR);
+					// scale and rotate to mean shape to reference frame
+					cv::Mat sim_r = (cv::Mat_<float>(2, 3) << a1, -b1, landmark_locations.at<float>(mirror_id, 0) - a1 * (area_of_interest_width - 1.0f) / 2.0f + b1 * (area_of_interest_width - 1.0f) / 2.0f, b1, a1, landmark_locations.at<float>(mirror_id + n, 0) - a1 * (area_of_interest_width - 1.0f) / 2.0f - b1 * (area_of_interest_width - 1.0f) / 2.0f);
 
-							cv::Mat_<float> prealloc_mat_right = preallocated_im2col[mirror_id][im2col_size];
+					// Extract the region of interest around the current landmark location
+					cv::Mat_<float> area_of_interest_r(area_of_interest_height, area_of_interest_width, 0.0f);
 
-							cen_expert_intensity[scale][view_id][ind].ResponseSparse(area_of_interest, area_of_interest_r, patch_expert_responses[ind], patch_expert_responses[mirror_id], interp_mat, prealloc_mat, prealloc_mat_right);
+					cv::warpAffine(grayscale_image, area_of_interest_r, sim_r, area_of_interest_r.size(), cv::WARP_INVERSE_MAP + cv::INTER_LINEAR);
 
-							preallocated_im2col[mirror_id][im2col_size] = prealloc_mat_right;
+					cv::Mat_<float> prealloc_mat_right = preallocated_im2col[mirror_id][im2col_size];
 
-						}
-					}
-				}
-				else
-				{
-					// For space and memory saving use a mirrored patch expert
-					if (!cen_expert_intensity[scale][view_id][ind].biases.empty())
-					{
-						cv::Mat_<float> empty(0, 0, 0.0f);
-						cen_expert_intensity[scale][view_id][ind].ResponseSparse(area_of_interest, empty, patch_expert_responses[ind], empty, interp_mat, prealloc_mat, empty);
+					cen_expert_intensity[scale][view_id][ind].ResponseSparse(area_of_interest, area_of_interest_r, patch_expert_responses[ind], patch_expert_responses[mirror_id], interp_mat, prealloc_mat, prealloc_mat_right);
 
-						// A slower, but slightly more accurate version
-						//cen_expert_intensity[scale][view_id][ind].Response(area_of_interest, patch_expert_responses[ind]);
-					}
-					else
-					{
-						cv::Mat_<float> empty(0, 0, 0.0f);
-						cen_expert_intensity[scale][mirror_views.at<int>(view_id)][mirror_inds.at<int>(ind)].ResponseSparse(empty, area_of_interest, empty, patch_expert_responses[ind], interp_mat, empty, prealloc_mat);
-					}
-				}
+					preallocated_im2col[mirror_id][im2col_size] = prealloc_mat_right;
 
-				preallocated_im2col[ind][im2col_size] = prealloc_mat;
+				}
+			}
+		}
+		else
+		{
+			// For space and memory saving use a mirrored patch expert
+			if (!cen_expert_intensity[scale][view_id][ind].biases.empty())
+			{
+				cv::Mat_<float> empty(0, 0, 0.0f);
+				cen_expert_intensity[scale][view_id][ind].ResponseSparse(area_of_interest, empty, patch_expert_responses[ind], empty, interp_mat, prealloc_mat, empty);
 
+				// A slower, but slightly more accurate version
+				//cen_expert_intensity[scale][view_id][ind].Response(area_of_interest, patch_expert_responses[ind]);
 			}
-			else if (!ccnf_expert_intensity.empty())
+			else
 			{
-				// get the correct size response window			
-				patch_expert_responses[ind] = cv::Mat_<float>(window_size, window_size);
+				cv::Mat_<float> empty(0, 0, 0.0f);
+				cen_expert_intensity[scale][mirror_views.at<int>(view_id)][mirror_inds.at<int>(ind)].ResponseSparse(empty, area_of_interest, empty, patch_expert_responses[ind], interp_mat, empty, prealloc_mat);
+			}
+		}
 
-				int im2col_size = area_of_interest_width * area_of_interest_height;
+		preallocated_im2col[ind][im2col_size] = prealloc_mat;
 
-				cv::Mat_<float> prealloc_mat = preallocated_im2col[ind][im2col_size];
+	}
+	else if (!ccnf_expert_intensity.empty())
+	{
+		// get the correct size response window			
+		patch_expert_responses[ind] = cv::Mat_<float>(window_size, window_size);
 
-				ccnf_expert_intensity[scale][view_id][ind].ResponseOpenBlas(area_of_interest, patch_expert_responses[ind], prealloc_mat);
+		int im2col_size = area_of_interest_width * area_of_interest_height;
 
-				preallocated_im2col[ind][im2col_size] = prealloc_mat;
+		cv::Mat_<float> prealloc_mat = preallocated_im2col[ind][im2col_size];
 
-				// Below is an alternative way to compute the same, but that uses FFT instead of OpenBLAS
-				// ccnf_expert_intensity[scale][view_id][ind].Response(area_of_interest, patch_expert_responses[ind]);
+		ccnf_expert_intensity[scale][view_id][ind].ResponseOpenBlas(area_of_interest, patch_expert_responses[ind], prealloc_mat);
 
-			}
-			else
-			{
-				// get the correct size response window			
-				patch_expert_responses[ind] = cv::Mat_<float>(window_size, window_size);
+		preallocated_im2col[ind][im2col_size] = prealloc_mat;
 
-				svr_expert_intensity[scale][view_id][ind].Response(area_of_interest, patch_expert_responses[ind]);
-			}
-		}
-	});
+		// Below is an alternative way to compute the same, but that uses FFT instead of OpenBLAS
+		// ccnf_expert_intensity[scale][view_id][ind].Response(area_of_interest, patch_expert_responses[ind]);
+
+	}
+	else
+	{
+		// get the correct size response window			
+		patch_expert_responses[ind] = cv::Mat_<float>(window_size, window_size);
+
+		svr_expert_intensity[scale][view_id][ind].Response(area_of_interest, patch_expert_responses[ind]);
+	}
 }
 
 
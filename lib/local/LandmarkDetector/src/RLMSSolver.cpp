@@ -0,0 +1,282 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2017, Carnegie Mellon University and University of Cambridge,
+// all rights reserved.
+//
+// ACADEMIC OR NON-PROFIT ORGANIZATION NONCOMMERCIAL RESEARCH USE ONLY
+//
+// BY USING OR DOWNLOADING THE SOFTWARE, YOU ARE AGREEING TO THE TERMS OF THIS LICENSE AGREEMENT.  
+// IF YOU DO NOT AGREE WITH THESE TERMS, YOU MAY NOT USE OR DOWNLOAD THE SOFTWARE.
+//
+// License can be found in OpenFace-license.txt
+//
+//     * Any publications arising from the use of this software, including but
+//       not limited to academic journal and conference publications, technical
+//       reports and manuals, must cite at least one of the following works:
+//
+//       OpenFace 2.0: Facial Behavior Analysis Toolkit
+//       Tadas Baltruaitis, Amir Zadeh, Yao Chong Lim, and Louis-Philippe Morency
+//       in IEEE International Conference on Automatic Face and Gesture Recognition, 2018  
+//
+//       Convolutional experts constrained local model for facial landmark detection.
+//       A. Zadeh, T. Baltruaitis, and Louis-Philippe Morency,
+//       in Computer Vision and Pattern Recognition Workshops, 2017.    
+//
+//       Rendering of Eyes for Eye-Shape Registration and Gaze Estimation
+//       Erroll Wood, Tadas Baltruaitis, Xucong Zhang, Yusuke Sugano, Peter Robinson, and Andreas Bulling 
+//       in IEEE International. Conference on Computer Vision (ICCV),  2015 
+//
+//       Cross-dataset learning and person-specific normalisation for automatic Action Unit detection
+//       Tadas Baltruaitis, Marwa Mahmoud, and Peter Robinson 
+//       in Facial Expression Recognition and Analysis Challenge, 
+//       IEEE International Conference on Automatic Face and Gesture Recognition, 2015 
+//
+
+#include "stdafx.h"
+
+#include <RLMSSolver.h>
+#include <RotationHelpers.h>
+
+#include <cmath>
+
+using namespace LandmarkDetector;
+
+namespace
+{
+	//===========================================================================
+	// Solves H x = b in place for a symmetric positive definite H (only the lower triangle is used), x is returned in b. 
+	// The loop bounds are known at compile time so the compiler can unroll them.
+	template<int P>
+	bool CholeskySolve(float* H, float* b)
+	{
+		// The decomposition H = L L^T, L is stored in the lower triangle of H
+		for (int j = 0; j < P; ++j)
+		{
+			float d = H[j * P + j];
+			for (int k = 0; k < j; ++k)
+			{
+				d -= H[j * P + k] * H[j * P + k];
+			}
+
+			if (!(d > 0.0f))
+			{
+				return false;
+			}
+
+			d = std::sqrt(d);
+			H[j * P + j] = d;
+
+			const float inv_d = 1.0f / d;
+			for (int i = j + 1; i < P; ++i)
+			{
+				float sum = H[i * P + j];
+				for (int k = 0; k < j; ++k)
+				{
+					sum -= H[i * P + k] * H[j * P + k];
+				}
+				H[i * P + j] = sum * inv_d;
+			}
+		}
+
+		// Forward substitution L y = b
+		for (int i = 0; i < P; ++i)
+		{
+			float sum = b[i];
+			for (int k = 0; k < i; ++k)
+			{
+				sum -= H[i * P + k] * b[k];
+			}
+			b[i] = sum / H[i * P + i];
+		}
+
+		// Back substitution L^T x = y
+		for (int i = P - 1; i >= 0; --i)
+		{
+			float sum = b[i];
+			for (int k = i + 1; k < P; ++k)
+			{
+				sum -= H[k * P + i] * b[k];
+			}
+			b[i] = sum / H[i * P + i];
+		}
+		return true;
+	}
+
+	//===========================================================================
+	// One NU-RLMS step for a model with N points and M modes, the Jacobian rows of every point are computed as in PDM::ComputeJacobian 
+	// (PDM::ComputeRigidJacobian for the rigid step) and are directly accumulated into the Hessian and the projected mean shifts
+	template<int N, int M, bool Rigid>
+	bool SolveRLMS(const PDM& pdm, const cv::Mat_<float>& params_local, const cv::Vec6f& params_global, const cv::Mat_<float>& weights,
+		const cv::Mat_<float>& mean_shifts, const cv::Mat_<int>& visibilities, const cv::Mat_<float>& regularisation, cv::Mat_<float>& param_update)
+	{
+		const int P = Rigid ? 6 : 6 + M;
+
+		// Hessian (lower triangle) and the projection of mean shifts onto the Jacobian
+		float H[P * P] = {};
+		float b[P] = {};
+
+		float p[M];
+		for (int j = 0; j < M; ++j)
+		{
+			p[j] = params_local.at<float>(j, 0);
+		}
+
+		float s = params_global[0];
+
+		cv::Vec3f euler(params_global[1], params_global[2], params_global[3]);
+		cv::Matx33f currRot = Utilities::Euler2RotationMatrix(euler);
+
+		float r11 = currRot(0, 0);
+		float r12 = currRot(0, 1);
+		float r13 = currRot(0, 2);
+		float r21 = currRot(1, 0);
+		float r22 = currRot(1, 1);
+		float r23 = currRot(1, 2);
+
+		const float* mean = pdm.mean_shape.ptr<float>(0);
+
+		float jx[P];
+		float jy[P];
+
+		for (int i = 0; i < N; ++i)
+		{
+			// Landmarks without a patch expert do not contribute
+			if (visibilities.at<int>(i, 0) == 0)
+			{
+				continue;
+			}
+
+			const float* Vx = pdm.princ_comp.ptr<float>(i);
+			const float* Vy = pdm.princ_comp.ptr<float>(i + N);
+			const float* Vz = pdm.princ_comp.ptr<float>(i + 2 * N);
+
+			// The point in object space (as in PDM::CalcShape3D)
+			float X = mean[i];
+			float Y = mean[i + N];
+			float Z = mean[i + 2 * N];
+			for (int j = 0; j < M; ++j)
+			{
+				X += Vx[j] * p[j];
+				Y += Vy[j] * p[j];
+				Z += Vz[j] * p[j];
+			}
+
+			// scaling term
+			jx[0] = (X * r11 + Y * r12 + Z * r13);
+			jy[0] = (X * r21 + Y * r22 + Z * r23);
+
+			// rotation terms
+			jx[1] = (s * (Y * r13 - Z * r12));
+			jy[1] = (s * (Y * r23 - Z * r22));
+			jx[2] = (-s * (X * r13 - Z * r11));
+			jy[2] = (-s * (X * r23 - Z * r21));
+			jx[3] = (s * (X * r12 - Y * r11));
+			jy[3] = (s * (X * r22 - Y * r21));
+
+			// translation terms
+			jx[4] = 1.0f;
+			jy[4] = 0.0f;
+			jx[5] = 0.0f;
+			jy[5] = 1.0f;
+
+			if (!Rigid)
+			{
+				for (int j = 0; j < P - 6; ++j)
+				{
+					jx[6 + j] = s * (r11 * Vx[j] + r12 * Vy[j] + r13 * Vz[j]);
+					jy[6 + j] = s * (r21 * Vx[j] + r22 * Vy[j] + r23 * Vz[j]);
+				}
+			}
+
+			float w = weights.at<float>(i, 0);
+			float mx = mean_shifts.at<float>(i, 0);
+			float my = mean_shifts.at<float>(i + N, 0);
+
+			for (int a = 0; a < P; ++a)
+			{
+				float wx = w * jx[a];
+				float wy = w * jy[a];
+
+				b[a] += wx * mx + wy * my;
+
+				float* H_row = H + a * P;
+				for (int c = 0; c <= a; ++c)
+				{
+					H_row[c] += wx * jx[c] + wy * jy[c];
+				}
+			}
+		}
+
+		// Add the regularisation term
+		if (!Rigid)
+		{
+			for (int j = 0; j < P - 6; ++j)
+			{
+				float reg = regularisation.at<float>(j, 0);
+				H[(6 + j) * P + 6 + j] += reg;
+				b[6 + j] -= reg * p[j];
+			}
+		}
+
+		if (!CholeskySolve<P>(H, b))
+		{
+			return false;
+		}
+
+		param_update.create(P, 1);
+		for (int j = 0; j < P; ++j)
+		{
+			param_update.at<float>(j, 0) = b[j];
+		}
+		return true;
+	}
+
+	template<int N, int M>
+	bool SolveRLMS(const PDM& pdm, const cv::Mat_<float>& params_local, const cv::Vec6f& params_global, const cv::Mat_<float>& weights,
+		const cv::Mat_<float>& mean_shifts, const cv::Mat_<int>& visibilities, const cv::Mat_<float>& regularisation, bool rigid, cv::Mat_<float>& param_update)
+	{
+		if (rigid)
+		{
+			return SolveRLMS<N, M, true>(pdm, params_local, params_global, weights, mean_shifts, visibilities, regularisation, param_update);
+		}
+		else
+		{
+			return SolveRLMS<N, M, false>(pdm, params_local, params_global, weights, mean_shifts, visibilities, regularisation, param_update);
+		}
+	}
+}
+
+//===========================================================================
+bool LandmarkDetector::HasFixedRLMSSolver(int n, int m)
+{
+	// The 68 point face models, the inner face model and the eye models
+	return (n == 68 && (m == 34 || m == 30 || m == 23)) || (n == 51 && m == 32) || (n == 28 && m == 10);
+}
+
+bool LandmarkDetector::SolveRLMSFixed(const PDM& pdm, const cv::Mat_<float>& params_local, const cv::Vec6f& params_global, const cv::Mat_<float>& weights,
+	const cv::Mat_<float>& mean_shifts, const cv::Mat_<int>& visibilities, const cv::Mat_<float>& regularisation, bool rigid, cv::Mat_<float>& param_update)
+{
+	int n = pdm.NumberOfPoints();
+	int m = pdm.NumberOfModes();
+
+	if (n == 68 && m == 34)
+	{
+		return SolveRLMS<68, 34>(pdm, params_local, params_global, weights, mean_shifts, visibilities, regularisation, rigid, param_update);
+	}
+	else if (n == 68 && m == 30)
+	{
+		return SolveRLMS<68, 30>(pdm, params_local, params_global, weights, mean_shifts, visibilities, regularisation, rigid, param_update);
+	}
+	else if (n == 68 && m == 23)
+	{
+		return SolveRLMS<68, 23>(pdm, params_local, params_global, weights, mean_shifts, visibilities, regularisation, rigid, param_update);
+	}
+	else if (n == 51 && m == 32)
+	{
+		return SolveRLMS<51, 32>(pdm, params_local, params_global, weights, mean_shifts, visibilities, regularisation, rigid, param_update);
+	}
+	else if (n == 28 && m == 10)
+	{
+		return SolveRLMS<28, 10>(pdm, params_local, params_global, weights, mean_shifts, visibilities, regularisation, rigid, param_update);
+	}
+	return false;
+}
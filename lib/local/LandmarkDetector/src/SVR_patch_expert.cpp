@@ -131,20 +131,8 @@ void SVR_patch_expert::Read(std::ifstream &stream)
 }
 
 //===========================================================================
-void SVR_patch_expert::Response(const cv::Mat_<float>& area_of_interest, cv::Mat_<float>& response)
+void SVR_patch_expert::PrepareArea(const cv::Mat_<float>& area_of_interest, int type, cv::Mat_<float>& prepared_area)
 {
-
-	int response_height = area_of_interest.rows - weights.rows + 1;
-	int response_width = area_of_interest.cols - weights.cols + 1;
-	
-	// the patch area on which we will calculate reponses
-	cv::Mat_<float> normalised_area_of_interest;
-  
-	if(response.rows != response_height || response.cols != response_width)
-	{
-		response.create(response_height, response_width);
-	}
-
 	// If type is raw just normalise mean and standard deviation
 	if(type == 0)
 	{
@@ -158,39 +146,57 @@ void SVR_patch_expert::Response(const cv::Mat_<float>& area_of_interest, cv::Mat
 		{
 			std[0] = 1;
 		}
-		normalised_area_of_interest = (area_of_interest - mean[0]) / std[0];
+		prepared_area = (area_of_interest - mean[0]) / std[0];
 	}
 	// If type is gradient, perform the image gradient computation
 	else if(type == 1)
 	{
-		Grad(area_of_interest, normalised_area_of_interest);
+		Grad(area_of_interest, prepared_area);
 	}
   	else
 	{
 		printf("ERROR(%s,%d): Unsupported patch type %d!\n", __FILE__,__LINE__, type);
 		abort();
 	}
-	
-	cv::Mat_<float> svr_response;
+}
 
-	// The empty matrix as we don't pass precomputed dft's of image
-	cv::Mat_<double> empty_matrix_0(0,0,0.0);
-	cv::Mat_<float> empty_matrix_1(0,0,0.0);
-	cv::Mat_<float> empty_matrix_2(0,0,0.0);
+//===========================================================================
+void SVR_patch_expert::Response(const cv::Mat_<float>& area_of_interest, cv::Mat_<float>& response)
+{
+	// the patch area on which we will calculate reponses
+	cv::Mat_<float> normalised_area_of_interest;
+	PrepareArea(area_of_interest, type, normalised_area_of_interest);
 
-	// Efficient calc of patch expert SVR response across the area of interest
-	matchTemplate_m(normalised_area_of_interest, empty_matrix_0, empty_matrix_1, empty_matrix_2, weights, weights_dfts, svr_response, cv::TM_CCOEFF_NORMED);
-	
-	response.create(svr_response.size());
-	cv::MatIterator_<float> p = response.begin();
+	// The empty matrices as we don't have precomputed dft's and integral images of the area
+	cv::Mat_<double> area_dft;
+	cv::Mat integral_img, integral_img_sq;
 
-	cv::MatIterator_<float> q1 = svr_response.begin(); // respone for each pixel
-	cv::MatIterator_<float> q2 = svr_response.end();
+	Response(normalised_area_of_interest, area_dft, integral_img, integral_img_sq, response);
+}
+
+//===========================================================================
+void SVR_patch_expert::Response(const cv::Mat_<float>& prepared_area, cv::Mat_<double>& area_dft, cv::Mat& integral_img, cv::Mat& integral_img_sq, cv::Mat_<float>& response)
+{
+
+	int response_height = prepared_area.rows - weights.rows + 1;
+	int response_width = prepared_area.cols - weights.cols + 1;
+
+	if(response.rows != response_height || response.cols != response_width)
+	{
+		response.create(response_height, response_width);
+	}
+
+	// Efficient calc of patch expert SVR response across the area of interest, written directly into the response
+	matchTemplate_m(prepared_area, area_dft, integral_img, integral_img_sq, weights, weights_dfts, response, cv::TM_CCOEFF_NORMED);
+	
+	cv::MatIterator_<float> q1 = response.begin(); // respone for each pixel
+	cv::MatIterator_<float> q2 = response.end();
 
 	while(q1 != q2)
 	{
-		// the SVR response passed into logistic regressor
-		*p++ = 1.0/(1.0 + exp( -(*q1++ * scaling + bias )));
+		// the SVR response passed into logistic regressor (in place)
+		*q1 = 1.0/(1.0 + exp( -(*q1 * scaling + bias )));
+		q1++;
 	}
 
 }
@@ -308,13 +314,33 @@ void Multi_SVR_patch_expert::Response(const cv::Mat_<float> &area_of_interest, c
 	{
 		// responses from multiple patch experts these can be gradients, LBPs etc.
 		response.setTo(1.0);
-		
+
+		// The prepared area of interest, its DFT, and integral images for every patch type (0=raw, 1=grad), as all of the modalities
+		// share the same support size these are computed once per type and shared by all of the experts operating on it
+		const int num_types = 2;
+		cv::Mat_<float> prepared_areas[num_types];
+		cv::Mat_<double> area_dfts[num_types];
+		cv::Mat integral_imgs[num_types], integral_imgs_sq[num_types];
+
 		cv::Mat_<float> modality_resp(response_height, response_width);
 
 		for(size_t i = 0; i < svr_patch_experts.size(); i++)
-		{			
-			svr_patch_experts[i].Response(area_of_interest, modality_resp);			
-			response = response.mul(modality_resp);	
+		{
+			int type = svr_patch_experts[i].type;
+
+			if(type < 0 || type >= num_types)
+			{
+				printf("ERROR(%s,%d): Unsupported patch type %d!\n", __FILE__,__LINE__, type);
+				abort();
+			}
+
+			if(prepared_areas[type].empty())
+			{
+				SVR_patch_expert::PrepareArea(area_of_interest, type, prepared_areas[type]);
+			}
+
+			svr_patch_experts[i].Response(prepared_areas[type], area_dfts[type], integral_imgs[type], integral_imgs_sq[type], modality_resp);
+			cv::multiply(response, modality_resp, response);
 		}	
 		
 	}
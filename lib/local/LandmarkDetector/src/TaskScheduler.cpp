@@ -0,0 +1,431 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2017, Carnegie Mellon University and University of Cambridge,
+// all rights reserved.
+//
+// ACADEMIC OR NON-PROFIT ORGANIZATION NONCOMMERCIAL RESEARCH USE ONLY
+//
+// BY USING OR DOWNLOADING THE SOFTWARE, YOU ARE AGREEING TO THE TERMS OF THIS LICENSE AGREEMENT.  
+// IF YOU DO NOT AGREE WITH THESE TERMS, YOU MAY NOT USE OR DOWNLOAD THE SOFTWARE.
+//
+// License can be found in OpenFace-license.txt
+//
+//     * Any publications arising from the use of this software, including but
+//       not limited to academic journal and conference publications, technical
+//       reports and manuals, must cite at least one of the following works:
+//
+//       OpenFace 2.0: Facial Behavior Analysis Toolkit
+//       Tadas Baltruaitis, Amir Zadeh, Yao Chong Lim, and Louis-Philippe Morency
+//       in IEEE International Conference on Automatic Face and Gesture Recognition, 2018  
+//
+//       Convolutional experts constrained local model for facial landmark detection.
+//       A. Zadeh, T. Baltruaitis, and Louis-Philippe Morency,
+//       in Computer Vision and Pattern Recognition Workshops, 2017.    
+//
+//       Rendering of Eyes for Eye-Shape Registration and Gaze Estimation
+//       Erroll Wood, Tadas Baltruaitis, Xucong Zhang, Yusuke Sugano, Peter Robinson, and Andreas Bulling 
+//       in IEEE International. Conference on Computer Vision (ICCV),  2015 
+//
+//       Cross-dataset learning and person-specific normalisation for automatic Action Unit detection
+//       Tadas Baltruaitis, Marwa Mahmoud, and Peter Robinson 
+//       in Facial Expression Recognition and Analysis Challenge, 
+//       IEEE International Conference on Automatic Face and Gesture Recognition, 2015 
+//
+
+#include "stdafx.h"
+
+#include <TaskScheduler.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace LandmarkDetector;
+
+thread_local int TaskScheduler::current_worker = -1;
+
+// How many times a waiting thread looks for other work before it blocks
+static const int WAIT_SPINS = 64;
+
+TaskScheduler::TaskScheduler() : pending_tasks(0), next_queue(0), stopping(false)
+{
+	Start(0, -1);
+}
+
+TaskScheduler::~TaskScheduler()
+{
+	Stop();
+}
+
+TaskScheduler& TaskScheduler::Instance()
+{
+	static TaskScheduler scheduler;
+	return scheduler;
+}
+
+void TaskScheduler::Configure(int num_threads, int first_core)
+{
+	TaskScheduler& scheduler = Instance();
+	std::lock_guard<std::mutex> lock(scheduler.configure_mutex);
+	scheduler.Stop();
+	scheduler.Start(num_threads, first_core);
+}
+
+int TaskScheduler::NumThreads()
+{
+	return (int)Instance().threads.size() + 1;
+}
+
+void TaskScheduler::Start(int num_threads, int first_core)
+{
+	if (num_threads <= 0)
+	{
+		num_threads = std::max(1, (int)std::thread::hardware_concurrency());
+	}
+
+	// The parallelism comes from the scheduler, so OpenBLAS should not create threads of its own
+	openblas_set_num_threads(1);
+
+	stopping = false;
+	pending_tasks = 0;
+
+	// The calling thread is the one additional thread
+	int num_workers = num_threads - 1;
+
+	queues.clear();
+	for (int i = 0; i < num_workers; ++i)
+	{
+		queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+	}
+
+	for (int i = 0; i < num_workers; ++i)
+	{
+		int core = first_core >= 0 ? first_core + i + 1 : -1;
+		threads.push_back(std::thread(&TaskScheduler::WorkerLoop, this, i, core));
+	}
+}
+
+void TaskScheduler::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(wake_mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for (size_t i = 0; i < threads.size(); ++i)
+	{
+		threads[i].join();
+	}
+	threads.clear();
+	queues.clear();
+
+	// The tasks that were not started will not run any more (their futures are abandoned)
+	{
+		std::lock_guard<std::mutex> lock(async_queue.mutex);
+		async_queue.tasks.clear();
+	}
+	std::lock_guard<std::mutex> lock(background_queue.mutex);
+	background_queue.tasks.clear();
+}
+
+void TaskScheduler::Push(const std::function<void()>& task)
+{
+	int worker = current_worker;
+	if (worker < 0)
+	{
+		worker = (int)(next_queue++ % queues.size());
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(queues[worker]->mutex);
+		queues[worker]->tasks.push_back(task);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(wake_mutex);
+		pending_tasks++;
+	}
+	wake.notify_one();
+}
+
+void TaskScheduler::PushShared(WorkerQueue& queue, const std::function<void()>& task)
+{
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks.push_back(task);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(wake_mutex);
+		pending_tasks++;
+	}
+	wake.notify_one();
+}
+
+bool TaskScheduler::RunTask(int worker)
+{
+	std::function<void()> task;
+	int num_queues = (int)queues.size();
+
+	// The most recent task of the own queue first (it is the most likely to have its data in cache)
+	if (worker >= 0)
+	{
+		std::lock_guard<std::mutex> lock(queues[worker]->mutex);
+		if (!queues[worker]->tasks.empty())
+		{
+			task = queues[worker]->tasks.back();
+			queues[worker]->tasks.pop_back();
+		}
+	}
+
+	// Otherwise steal the oldest task of another worker
+	for (int i = 1; !task && i <= num_queues; ++i)
+	{
+		int victim = (std::max(worker, 0) + i) % num_queues;
+		if (victim == worker)
+			continue;
+
+		std::lock_guard<std::mutex> lock(queues[victim]->mutex);
+		if (!queues[victim]->tasks.empty())
+		{
+			task = queues[victim]->tasks.front();
+			queues[victim]->tasks.pop_front();
+		}
+	}
+
+	if (!task)
+	{
+		return false;
+	}
+
+	pending_tasks--;
+	task();
+	return true;
+}
+
+bool TaskScheduler::RunSharedTask(WorkerQueue& queue)
+{
+	std::function<void()> task;
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty())
+		{
+			return false;
+		}
+		task = queue.tasks.front();
+		queue.tasks.pop_front();
+	}
+
+	pending_tasks--;
+	task();
+	return true;
+}
+
+void TaskScheduler::WorkerLoop(int worker, int core)
+{
+	current_worker = worker;
+
+	// Binding the worker to a core
+	if (core >= 0)
+	{
+#ifdef _WIN32
+		SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << core);
+#elif defined(__linux__)
+		cpu_set_t cpu_set;
+		CPU_ZERO(&cpu_set);
+		CPU_SET(core, &cpu_set);
+		pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpu_set);
+#endif
+	}
+
+	while (true)
+	{
+		// The parallel loops come first as a frame might be waiting for them
+		if (RunTask(worker) || RunSharedTask(async_queue) || RunSharedTask(background_queue))
+		{
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(wake_mutex);
+		wake.wait(lock, [this] { return stopping || pending_tasks > 0; });
+
+		if (stopping)
+		{
+			break;
+		}
+	}
+}
+
+void TaskScheduler::ParallelFor(const cv::Range& range, const std::function<void(const cv::Range&)>& body)
+{
+	int n = range.end - range.start;
+	if (n <= 0)
+	{
+		return;
+	}
+
+	TaskScheduler& scheduler = Instance();
+
+	int num_workers = (int)scheduler.threads.size();
+	if (num_workers == 0 || n == 1)
+	{
+		body(range);
+		return;
+	}
+
+	// A few chunks per thread so that the load is balanced even if chunks take different time
+	int num_chunks = std::min(n, 4 * (num_workers + 1));
+
+	struct LoopState
+	{
+		std::atomic<int> next_chunk;
+		std::atomic<int> chunks_done;
+		std::atomic<bool> failed;
+
+		// The first exception thrown by the body
+		std::exception_ptr error;
+
+		// Signalled when the last chunk is done
+		std::mutex done_mutex;
+		std::condition_variable done;
+	};
+	std::shared_ptr<LoopState> loop(new LoopState());
+	loop->next_chunk = 0;
+	loop->chunks_done = 0;
+	loop->failed = false;
+
+	// The chunks are taken in order by whichever thread gets to them first, the helper tasks that start after all chunks were taken do nothing
+	const std::function<void(const cv::Range&)>* body_ptr = &body;
+	cv::Range full_range = range;
+	std::function<void()> run_chunks = [loop, body_ptr, full_range, n, num_chunks]()
+	{
+		int chunk;
+		while ((chunk = loop->next_chunk++) < num_chunks)
+		{
+			// Once a chunk failed the rest are only counted as done
+			if (!loop->failed)
+			{
+				int start = full_range.start + (int)((long long)n * chunk / num_chunks);
+				int end = full_range.start + (int)((long long)n * (chunk + 1) / num_chunks);
+				try
+				{
+					(*body_ptr)(cv::Range(start, end));
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock(loop->done_mutex);
+					if (!loop->failed)
+					{
+						loop->error = std::current_exception();
+						loop->failed = true;
+					}
+				}
+			}
+
+			if (++loop->chunks_done == num_chunks)
+			{
+				std::lock_guard<std::mutex> lock(loop->done_mutex);
+				loop->done.notify_all();
+			}
+		}
+	};
+
+	int num_helpers = std::min(num_workers, num_chunks - 1);
+	for (int i = 0; i < num_helpers; ++i)
+	{
+		scheduler.Push(run_chunks);
+	}
+
+	run_chunks();
+
+	// Wait for the chunks being done by other threads, running other chunks in the meantime (this is what lets nested loops progress), and
+	// blocking once there was nothing to run for a while
+	int idle_spins = 0;
+	while (loop->chunks_done < num_chunks && idle_spins < WAIT_SPINS)
+	{
+		if (scheduler.RunTask(current_worker))
+		{
+			idle_spins = 0;
+		}
+		else
+		{
+			idle_spins++;
+			std::this_thread::yield();
+		}
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(loop->done_mutex);
+		loop->done.wait(lock, [&loop, num_chunks] { return loop->chunks_done == num_chunks; });
+	}
+
+	if (loop->error)
+	{
+		std::rethrow_exception(loop->error);
+	}
+}
+
+std::shared_future<void> TaskScheduler::Async(const std::function<void()>& task, bool background)
+{
+	TaskScheduler& scheduler = Instance();
+
+	std::shared_ptr<std::packaged_task<void()> > packaged(new std::packaged_task<void()>(task));
+	std::shared_future<void> result = packaged->get_future().share();
+
+	if (scheduler.threads.empty())
+	{
+		(*packaged)();
+	}
+	else if (background)
+	{
+		scheduler.PushShared(scheduler.background_queue, [packaged]() { (*packaged)(); });
+	}
+	else
+	{
+		scheduler.PushShared(scheduler.async_queue, [packaged]() { (*packaged)(); });
+	}
+
+	return result;
+}
+
+void TaskScheduler::Wait(const std::shared_future<void>& task)
+{
+	if (!task.valid())
+	{
+		return;
+	}
+
+	TaskScheduler& scheduler = Instance();
+
+	// Help with the parallel loops (they might be the ones of the task) and the other Async tasks (the task might still be queued behind them) while the
+	// task is not done. Once there was nothing to run for a while a background task that no worker got to is run as well, and when all of the queues
+	// are empty the task is running on another thread so it is safe to block
+	int idle_spins = 0;
+	while (task.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+	{
+		if (scheduler.RunTask(current_worker) || scheduler.RunSharedTask(scheduler.async_queue))
+		{
+			idle_spins = 0;
+		}
+		else if (idle_spins < WAIT_SPINS)
+		{
+			idle_spins++;
+			std::this_thread::yield();
+		}
+		else if (!scheduler.RunSharedTask(scheduler.background_queue))
+		{
+			break;
+		}
+	}
+
+	// Blocks if the task is still running and rethrows its exception if it threw
+	task.get();
+}
+
+bool TaskScheduler::Done(const std::shared_future<void>& task)
+{
+	return !task.valid() || task.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
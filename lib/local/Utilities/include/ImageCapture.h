@@ -43,6 +43,8 @@
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
+#include <ImageSequenceDecoder.h>
+
 namespace Utilities
 {
 
@@ -90,6 +92,9 @@ namespace Utilities
 
 		bool has_bounding_boxes;
 
+		// The number of threads decoding images ahead (if <= 0 a default based on the hardware is used)
+		int num_decode_threads = -1;
+
 	private:
 
 		// Blocking copy and move, as it doesn't make sense to have several readers pointed at the same source
@@ -106,6 +111,9 @@ namespace Utilities
 		size_t  frame_num;
 		std::vector<std::string> image_files;
 
+		// Decoding the image files in parallel, ahead of them being requested
+		ImageSequenceDecoder image_decoder;
+
 		// Could optionally read the bounding box locations from files (each image could have multiple bounding boxes)
 		std::vector<std::vector<cv::Rect_<float> > > bounding_boxes;
 
@@ -0,0 +1,113 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2017, Tadas Baltrusaitis all rights reserved.
+//
+// ACADEMIC OR NON-PROFIT ORGANIZATION NONCOMMERCIAL RESEARCH USE ONLY
+//
+// BY USING OR DOWNLOADING THE SOFTWARE, YOU ARE AGREEING TO THE TERMS OF THIS LICENSE AGREEMENT.  
+// IF YOU DO NOT AGREE WITH THESE TERMS, YOU MAY NOT USE OR DOWNLOAD THE SOFTWARE.
+//
+// License can be found in OpenFace-license.txt
+//
+//     * Any publications arising from the use of this software, including but
+//       not limited to academic journal and conference publications, technical
+//       reports and manuals, must cite at least one of the following works:
+//
+//       OpenFace 2.0: Facial Behavior Analysis Toolkit
+//       Tadas Baltruaitis, Amir Zadeh, Yao Chong Lim, and Louis-Philippe Morency
+//       in IEEE International Conference on Automatic Face and Gesture Recognition, 2018  
+//
+//       Convolutional experts constrained local model for facial landmark detection.
+//       A. Zadeh, T. Baltruaitis, and Louis-Philippe Morency,
+//       in Computer Vision and Pattern Recognition Workshops, 2017.    
+//
+//       Rendering of Eyes for Eye-Shape Registration and Gaze Estimation
+//       Erroll Wood, Tadas Baltruaitis, Xucong Zhang, Yusuke Sugano, Peter Robinson, and Andreas Bulling 
+//       in IEEE International. Conference on Computer Vision (ICCV),  2015 
+//
+//       Cross-dataset learning and person-specific normalisation for automatic Action Unit detection
+//       Tadas Baltruaitis, Marwa Mahmoud, and Peter Robinson 
+//       in Facial Expression Recognition and Analysis Challenge, 
+//       IEEE International Conference on Automatic Face and Gesture Recognition, 2015 
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef IMAGE_SEQUENCE_DECODER_H
+#define IMAGE_SEQUENCE_DECODER_H
+
+// System includes
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// OpenCV includes
+#include <opencv2/core/core.hpp>
+
+namespace Utilities
+{
+
+	//===========================================================================
+	/**
+	A pool of decoder threads that reads and decodes a list of image files ahead of time, together with their
+	grayscale conversion, while still returning them in the original order
+	*/
+	class ImageSequenceDecoder {
+
+	public:
+
+		ImageSequenceDecoder() {};
+
+		~ImageSequenceDecoder();
+
+		// Start decoding the image files using num_threads decoders (if <= 0 a default based on the hardware is used),
+		// keeping at most max_ahead decoded images in memory (if <= 0 two per decoder thread)
+		void Start(const std::vector<std::string>& image_files, int num_threads = -1, int max_ahead = -1);
+
+		// Retrieve the next image in order, blocking until it is decoded. Returns false once all the images have been retrieved,
+		// if an image could not be read an empty image is returned for it
+		bool Next(cv::Mat& image, cv::Mat_<uchar>& gray_image);
+
+		// Stop the decoder threads, dropping any images that have not been retrieved
+		void Stop();
+
+		// The number of decoder threads used by default
+		static int DefaultNumThreads();
+
+	private:
+
+		// Blocking copy and move, as the decoder threads refer to this object
+		ImageSequenceDecoder & operator= (const ImageSequenceDecoder& other);
+		ImageSequenceDecoder & operator= (const ImageSequenceDecoder&& other);
+		ImageSequenceDecoder(const ImageSequenceDecoder&& other);
+		ImageSequenceDecoder(const ImageSequenceDecoder& other);
+
+		void DecodingTask();
+
+		struct DecodedImage
+		{
+			cv::Mat image;
+			cv::Mat_<uchar> gray_image;
+			bool ready = false;
+		};
+
+		std::vector<std::string> image_files;
+
+		// Ring of decoded images, image i is stored in slot i % slots.size()
+		std::vector<DecodedImage> decoded_images;
+
+		// The next image to be claimed by a decoder and the next one to be retrieved
+		size_t next_to_decode = 0;
+		size_t next_to_retrieve = 0;
+
+		bool stopping = false;
+
+		std::mutex mutex;
+		std::condition_variable cond_decoded;
+		std::condition_variable cond_space;
+
+		std::vector<std::thread> decoder_threads;
+
+	};
+}
+#endif // IMAGE_SEQUENCE_DECODER_H
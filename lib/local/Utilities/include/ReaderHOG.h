@@ -0,0 +1,120 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2017, Tadas Baltrusaitis all rights reserved.
+//
+// ACADEMIC OR NON-PROFIT ORGANIZATION NONCOMMERCIAL RESEARCH USE ONLY
+//
+// BY USING OR DOWNLOADING THE SOFTWARE, YOU ARE AGREEING TO THE TERMS OF THIS LICENSE AGREEMENT.  
+// IF YOU DO NOT AGREE WITH THESE TERMS, YOU MAY NOT USE OR DOWNLOAD THE SOFTWARE.
+//
+// License can be found in OpenFace-license.txt
+//
+//     * Any publications arising from the use of this software, including but
+//       not limited to academic journal and conference publications, technical
+//       reports and manuals, must cite at least one of the following works:
+//
+//       OpenFace 2.0: Facial Behavior Analysis Toolkit
+//       Tadas Baltruaitis, Amir Zadeh, Yao Chong Lim, and Louis-Philippe Morency
+//       in IEEE International Conference on Automatic Face and Gesture Recognition, 2018  
+//
+//       Convolutional experts constrained local model for facial landmark detection.
+//       A. Zadeh, T. Baltruaitis, and Louis-Philippe Morency,
+//       in Computer Vision and Pattern Recognition Workshops, 2017.    
+//
+//       Rendering of Eyes for Eye-Shape Registration and Gaze Estimation
+//       Erroll Wood, Tadas Baltruaitis, Xucong Zhang, Yusuke Sugano, Peter Robinson, and Andreas Bulling 
+//       in IEEE International. Conference on Computer Vision (ICCV),  2015 
+//
+//       Cross-dataset learning and person-specific normalisation for automatic Action Unit detection
+//       Tadas Baltruaitis, Marwa Mahmoud, and Peter Robinson 
+//       in Facial Expression Recognition and Analysis Challenge, 
+//       IEEE International Conference on Automatic Face and Gesture Recognition, 2015 
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef READER_HOG_H
+#define READER_HOG_H
+
+// System includes
+#include <vector>
+#include <string>
+
+// OpenCV includes
+#include <opencv2/core/core.hpp>
+
+#include <iostream>
+#include <fstream>
+
+namespace Utilities
+{
+
+	//===========================================================================
+	/**
+	A class for reading HOG files recorded by RecorderHOG (in either the default or the chunked format), individual frames can be read in any order.
+	*/
+	class ReaderHOG {
+
+	public:
+
+		// The constructor for the reader, by default does not do anything
+		ReaderHOG();
+
+		// Opening the file and reading its layout (the frame index in case of a chunked file)
+		bool Open(const std::string& file_name);
+
+		void Close();
+
+		bool isOpen() const { return hog_file.is_open(); }
+
+		// Reading the descriptor of a frame (as a row vector of num_cols * num_rows * num_channels values) and if the frame was a successful one
+		bool ReadFrame(int frame, cv::Mat_<float>& descriptor, bool& good_frame);
+
+		int GetNumFrames() const { return num_frames; }
+		int GetNumCols() const { return num_cols; }
+		int GetNumRows() const { return num_rows; }
+		int GetNumChannels() const { return num_channels; }
+
+		bool IsChunked() const { return chunked; }
+		bool IsHalfPrecision() const { return half_precision; }
+
+		// The layout of a chunked file, the offset, first frame and number of frames of every chunk (empty for the default format)
+		const std::vector<long long>& GetChunkOffsets() const { return chunk_offsets; }
+		const std::vector<int>& GetChunkFirstFrames() const { return chunk_first_frames; }
+		const std::vector<int>& GetChunkNumFrames() const { return chunk_num_frames; }
+
+		// Where the frame data ends (the index of a chunked file follows it)
+		long long GetChunksEnd() const { return chunks_end; }
+
+	private:
+
+		// Blocking copy and move, as it doesn't make sense to read from the same file
+		ReaderHOG & operator= (const ReaderHOG& other);
+		ReaderHOG & operator= (const ReaderHOG&& other);
+		ReaderHOG(const ReaderHOG&& other);
+		ReaderHOG(const ReaderHOG& other);
+
+		bool OpenChunked(long long file_size);
+		bool OpenDefault(long long file_size);
+
+		std::ifstream hog_file;
+
+		bool chunked;
+		bool half_precision;
+
+		int num_frames;
+		int num_cols;
+		int num_rows;
+		int num_channels;
+
+		// Size of a frame record in the default format
+		long long record_size;
+
+		std::vector<long long> chunk_offsets;
+		std::vector<int> chunk_first_frames;
+		std::vector<int> chunk_num_frames;
+		long long chunks_end;
+
+		std::vector<char> value_buffer;
+
+	};
+}
+#endif // READER_HOG_H
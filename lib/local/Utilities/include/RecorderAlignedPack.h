@@ -0,0 +1,113 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2017, Tadas Baltrusaitis all rights reserved.
+//
+// ACADEMIC OR NON-PROFIT ORGANIZATION NONCOMMERCIAL RESEARCH USE ONLY
+//
+// BY USING OR DOWNLOADING THE SOFTWARE, YOU ARE AGREEING TO THE TERMS OF THIS LICENSE AGREEMENT.  
+// IF YOU DO NOT AGREE WITH THESE TERMS, YOU MAY NOT USE OR DOWNLOAD THE SOFTWARE.
+//
+// License can be found in OpenFace-license.txt
+//
+//     * Any publications arising from the use of this software, including but
+//       not limited to academic journal and conference publications, technical
+//       reports and manuals, must cite at least one of the following works:
+//
+//       OpenFace 2.0: Facial Behavior Analysis Toolkit
+//       Tadas Baltruaitis, Amir Zadeh, Yao Chong Lim, and Louis-Philippe Morency
+//       in IEEE International Conference on Automatic Face and Gesture Recognition, 2018  
+//
+//       Convolutional experts constrained local model for facial landmark detection.
+//       A. Zadeh, T. Baltruaitis, and Louis-Philippe Morency,
+//       in Computer Vision and Pattern Recognition Workshops, 2017.    
+//
+//       Rendering of Eyes for Eye-Shape Registration and Gaze Estimation
+//       Erroll Wood, Tadas Baltruaitis, Xucong Zhang, Yusuke Sugano, Peter Robinson, and Andreas Bulling 
+//       in IEEE International. Conference on Computer Vision (ICCV),  2015 
+//
+//       Cross-dataset learning and person-specific normalisation for automatic Action Unit detection
+//       Tadas Baltruaitis, Marwa Mahmoud, and Peter Robinson 
+//       in Facial Expression Recognition and Analysis Challenge, 
+//       IEEE International Conference on Automatic Face and Gesture Recognition, 2015 
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef RECORDER_ALIGNED_PACK_H
+#define RECORDER_ALIGNED_PACK_H
+
+// System includes
+#include <vector>
+#include <string>
+#include <mutex>
+
+// OpenCV includes
+#include <opencv2/core/core.hpp>
+
+#include <iostream>
+#include <fstream>
+
+namespace Utilities
+{
+
+	//===========================================================================
+	/**
+	A class for packing aligned face images into a single file instead of writing a file per image.
+
+	The file starts with the "OFALNPCK" tag and the format version, followed by the images, each stored as the length of its name, the name, the size of the
+	encoded image (a 64 bit integer) and the encoded image (in the same format as it would be written to a separate file). The file ends with an index of the
+	images (the length of the name, the name, the offset and the size of each image), the number of images, the offset of the index, and the "OFALNIDX" tag.
+	*/
+	class RecorderAlignedPack {
+
+	public:
+
+		// The constructor for the recorder, by default does not do anything
+		RecorderAlignedPack();
+
+		bool Open(std::string output_file_name);
+
+		bool isOpen() const { return output_file.is_open(); }
+
+		// Closing the file (writing out the index)
+		void Close();
+
+		// Adding an encoded image to the file, can be called from multiple threads
+		void Write(const std::string& name, const std::vector<uchar>& encoded_image);
+
+		// Reading the names of the images in a file
+		static bool ReadNames(const std::string& file_name, std::vector<std::string>& names);
+
+		// Reading and decoding an image from a file
+		static bool ReadImage(const std::string& file_name, const std::string& name, cv::Mat& image);
+
+		// Appending the images of another file (e.g. when output was recorded in parts)
+		static bool AppendFile(const std::string& file_name, const std::string& other_file_name);
+
+		static const int VERSION = 1;
+		static const int HEADER_SIZE = 12;
+		static const int FOOTER_SIZE = 20;
+
+	private:
+
+		// Blocking copy and move, as it doesn't make sense to read to write to the same file
+		RecorderAlignedPack & operator= (const RecorderAlignedPack& other);
+		RecorderAlignedPack & operator= (const RecorderAlignedPack&& other);
+		RecorderAlignedPack(const RecorderAlignedPack&& other);
+		RecorderAlignedPack(const RecorderAlignedPack& other);
+
+		// Reading the index of a file, returns where the images end (the offset of the index) or -1 on failure
+		static long long ReadIndex(std::ifstream& input_file, std::vector<std::string>& names, std::vector<long long>& offsets, std::vector<long long>& sizes);
+
+		static void WriteIndex(std::ofstream& output_file, const std::vector<std::string>& names, const std::vector<long long>& offsets, const std::vector<long long>& sizes);
+
+		std::ofstream output_file;
+
+		// Images can be added by several encoding threads
+		std::mutex write_mutex;
+
+		std::vector<std::string> image_names;
+		std::vector<long long> image_offsets;
+		std::vector<long long> image_sizes;
+
+	};
+}
+#endif // RECORDER_ALIGNED_PACK_H
@@ -56,9 +56,10 @@ namespace Utilities
 		// The constructor for the recorder, need to specify if we are recording a sequence or not
 		RecorderCSV();
 
-		// Opening the file and preparing the header for it
+		// Opening the file and preparing the header for it, with fixed_width_AUs the AUs are written so that they can be overwritten in place by the post-processing
 		bool Open(std::string output_file_name, bool is_sequence, bool output_2D_landmarks, bool output_3D_landmarks, bool output_model_params, bool output_pose, bool output_AUs, bool output_gaze,
-			int num_face_landmarks, int num_model_modes, int num_eye_landmarks, const std::vector<std::string>& au_names_class, const std::vector<std::string>& au_names_reg);
+			int num_face_landmarks, int num_model_modes, int num_eye_landmarks, const std::vector<std::string>& au_names_class, const std::vector<std::string>& au_names_reg,
+			bool fixed_width_AUs = false);
 
 		bool isOpen() const { return output_file.is_open(); }
 
@@ -92,9 +93,15 @@ namespace Utilities
 		bool output_AUs;
 		bool output_gaze;
 
+		// The AUs are written at a fixed width (intensities clamped to 0-5, two decimals)
+		bool fixed_width_AUs;
+
 		std::vector<std::string> au_names_class;
 		std::vector<std::string> au_names_reg;
 
+		// Each line is formatted into this buffer before writing it out
+		std::string line_buffer;
+
 	};
 }
 #endif // RECORDER_CSV_H
\ No newline at end of file
@@ -0,0 +1,138 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2017, Tadas Baltrusaitis all rights reserved.
+//
+// ACADEMIC OR NON-PROFIT ORGANIZATION NONCOMMERCIAL RESEARCH USE ONLY
+//
+// BY USING OR DOWNLOADING THE SOFTWARE, YOU ARE AGREEING TO THE TERMS OF THIS LICENSE AGREEMENT.  
+// IF YOU DO NOT AGREE WITH THESE TERMS, YOU MAY NOT USE OR DOWNLOAD THE SOFTWARE.
+//
+// License can be found in OpenFace-license.txt
+//
+//     * Any publications arising from the use of this software, including but
+//       not limited to academic journal and conference publications, technical
+//       reports and manuals, must cite at least one of the following works:
+//
+//       OpenFace 2.0: Facial Behavior Analysis Toolkit
+//       Tadas Baltruaitis, Amir Zadeh, Yao Chong Lim, and Louis-Philippe Morency
+//       in IEEE International Conference on Automatic Face and Gesture Recognition, 2018  
+//
+//       Convolutional experts constrained local model for facial landmark detection.
+//       A. Zadeh, T. Baltruaitis, and Louis-Philippe Morency,
+//       in Computer Vision and Pattern Recognition Workshops, 2017.    
+//
+//       Rendering of Eyes for Eye-Shape Registration and Gaze Estimation
+//       Erroll Wood, Tadas Baltruaitis, Xucong Zhang, Yusuke Sugano, Peter Robinson, and Andreas Bulling 
+//       in IEEE International. Conference on Computer Vision (ICCV),  2015 
+//
+//       Cross-dataset learning and person-specific normalisation for automatic Action Unit detection
+//       Tadas Baltruaitis, Marwa Mahmoud, and Peter Robinson 
+//       in Facial Expression Recognition and Analysis Challenge, 
+//       IEEE International Conference on Automatic Face and Gesture Recognition, 2015 
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef RECORDER_COLUMNAR_H
+#define RECORDER_COLUMNAR_H
+
+// System includes
+#include <vector>
+#include <string>
+
+// OpenCV includes
+#include <opencv2/core/core.hpp>
+
+#include <iostream>
+#include <fstream>
+
+namespace Utilities
+{
+
+	//===========================================================================
+	/**
+	A class for recording the same data as RecorderCSV in a columnar binary format, allowing to load individual columns without parsing the whole file.
+
+	The file starts with a header: the "OFCOLUMN" tag, the size of the header in bytes, the format version, the number of columns, the number of rows per chunk,
+	and for every column the length of its name followed by the name (the names are the same as the CSV header). The header is followed by chunks of rows,
+	each chunk consisting of the number of rows in it followed by the values of every column for those rows (all values are stored as 32 bit floats).
+	*/
+	class RecorderColumnar {
+
+	public:
+
+		// The constructor for the recorder, by default does not do anything
+		RecorderColumnar();
+
+		// Opening the file and preparing the header for it (takes the same arguments as RecorderCSV)
+		bool Open(std::string output_file_name, bool is_sequence, bool output_2D_landmarks, bool output_3D_landmarks, bool output_model_params, bool output_pose, bool output_AUs, bool output_gaze,
+			int num_face_landmarks, int num_model_modes, int num_eye_landmarks, const std::vector<std::string>& au_names_class, const std::vector<std::string>& au_names_reg);
+
+		bool isOpen() const { return output_file.is_open(); }
+
+		// Closing the file (writing out the last chunk) and cleaning up
+		void Close();
+
+		void WriteLine(int face_id, int frame_num, double time_stamp, bool landmark_detection_success, double landmark_confidence,
+			const cv::Mat_<float>& landmarks_2D, const cv::Mat_<float>& landmarks_3D, const cv::Mat_<float>& pdm_model_params, const cv::Vec6f& rigid_shape_params, cv::Vec6f& pose_estimate,
+			const cv::Point3f& gazeDirection0, const cv::Point3f& gazeDirection1, const cv::Vec2f& gaze_angle, const std::vector<cv::Point2f>& eye_landmarks2d, const std::vector<cv::Point3f>& eye_landmarks3d,
+			const std::vector<std::pair<std::string, double> >& au_intensities, const std::vector<std::pair<std::string, double> >& au_occurences);
+
+		// Reading the names of the columns in a file
+		static bool ReadColumnNames(const std::string& file_name, std::vector<std::string>& column_names);
+
+		// Reading all of the values of a single column in a file (only the values of that column are read)
+		static bool ReadColumn(const std::string& file_name, const std::string& column_name, std::vector<float>& values);
+
+		// Overwriting all of the values of a single column in a file in place (e.g. with post-processed values), the number of values has to match the number of rows
+		static bool OverwriteColumn(const std::string& file_name, const std::string& column_name, const std::vector<float>& values);
+
+		// Appending the rows of another file with the same columns (e.g. when output was recorded in parts)
+		static bool AppendFile(const std::string& file_name, const std::string& other_file_name);
+
+		// The number of rows in a chunk
+		static const int CHUNK_ROWS = 1024;
+
+	private:
+
+		// Blocking copy and move, as it doesn't make sense to read to write to the same file
+		RecorderColumnar & operator= (const RecorderColumnar& other);
+		RecorderColumnar & operator= (const RecorderColumnar&& other);
+		RecorderColumnar(const RecorderColumnar&& other);
+		RecorderColumnar(const RecorderColumnar& other);
+
+		// Write out the rows collected so far
+		void WriteChunk();
+
+		// Reading the header of a file, returns the size of the header in bytes (or -1 on failure)
+		static int ReadHeader(std::ifstream& input_file, std::vector<std::string>& column_names);
+
+		// The actual output file stream that will be written
+		std::ofstream output_file;
+
+		// If we are recording results from a sequence each row refers to a frame, if we are recording an image each row is a face
+		bool is_sequence;
+
+		// Keep track of what we are recording
+		bool output_2D_landmarks;
+		bool output_3D_landmarks;
+		bool output_model_params;
+		bool output_pose;
+		bool output_AUs;
+		bool output_gaze;
+
+		std::vector<std::string> au_names_class;
+		std::vector<std::string> au_names_reg;
+
+		std::vector<std::string> column_names;
+
+		// The values of the current chunk, stored column by column
+		std::vector<float> chunk;
+		int chunk_num_rows;
+
+		// The column being filled in the current row
+		int curr_column;
+
+		void AddValue(float value) { chunk[curr_column++ * CHUNK_ROWS + chunk_num_rows] = value; }
+
+	};
+}
+#endif // RECORDER_COLUMNAR_H
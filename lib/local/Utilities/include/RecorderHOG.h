@@ -36,6 +36,8 @@
 
 // System includes
 #include <vector>
+#include <string>
+#include <thread>
 
 // OpenCV includes
 #include <opencv2/core/core.hpp>
@@ -43,12 +45,21 @@
 #include <iostream>
 #include <fstream>
 
+#include "SPSCQueue.h"
+
 namespace Utilities
 {
 
 	//===========================================================================
 	/**
-	A class for recording CSV file from OpenFace
+	A class for recording HOG features from OpenFace.
+
+	By default every frame is written as a record of the number of columns, rows and channels, a frame success flag (1 or -1), followed by the 32 bit float values.
+	In the chunked format the file starts with a header: the "OFHOGCHK" tag, the format version, the number of columns, rows and channels, the value type (0 for 32 bit
+	floats, 1 for 16 bit floats), and the number of frames per chunk. The header is followed by chunks of frames, each consisting of the number of frames in it, the
+	success flags of those frames (as 32 bit floats) and their values. The file ends with an index of the chunks (the offset, first frame and number of frames of each
+	chunk as a 64 bit and two 32 bit integers), the number of chunks, the offset of the index, and the "OFHOGIDX" tag. Chunks are converted and written by a background
+	thread, and ReaderHOG can be used to read a frame from either format.
 	*/
 	class RecorderHOG {
 
@@ -62,10 +73,20 @@ namespace Utilities
 
 		void Write();
 
-		bool Open(std::string filename);
+		bool Open(std::string filename, bool chunked = false, bool half_precision = false);
 
 		void Close();
 
+		// Appending the frames of another HOG file in the same format (e.g. when output was recorded in parts)
+		static bool AppendFile(const std::string& file_name, const std::string& other_file_name);
+
+		// Constants of the chunked format
+		static const int CHUNK_FRAMES = 256;
+		static const int CHUNKED_VERSION = 1;
+		static const int CHUNKED_HEADER_SIZE = 32;
+		static const int CHUNKED_FOOTER_SIZE = 20;
+		static const int CHUNKED_INDEX_ENTRY_SIZE = 16;
+
 	private:
 
 		// Blocking copy and move, as it doesn't make sense to read to write to the same file
@@ -74,8 +95,46 @@ namespace Utilities
 		RecorderHOG(const RecorderHOG&& other);
 		RecorderHOG(const RecorderHOG& other);
 
+		// The frame data handed over to the writing thread of the chunked format
+		struct HOGFrame
+		{
+			int num_cols = 0;
+			int num_rows = 0;
+			int num_channels = 0;
+			bool good_frame = false;
+			bool last = false;
+			cv::Mat_<float> descriptor;
+		};
+
+		// Converting and writing the frames of the chunked format
+		void ChunkWriterThread();
+		void WriteChunkedHeader(int num_cols, int num_rows, int num_channels);
+		void WriteChunk();
+
+		// Writing the index of the chunks and the footer at the current position of a chunked file
+		static void WriteChunkedIndex(std::ofstream& output_file, const std::vector<long long>& chunk_offsets, const std::vector<int>& chunk_first_frames,
+			const std::vector<int>& chunk_num_frames);
+
 		std::ofstream hog_file;
 
+		bool chunked;
+		bool half_precision;
+
+		SPSCQueue<HOGFrame> chunk_queue;
+		std::thread chunk_writer;
+
+		// The state of the chunked file, only used by the writing thread
+		bool header_written;
+		int chunk_num_cols;
+		int chunk_num_rows;
+		int chunk_num_channels;
+		int num_frames_written;
+		std::vector<float> chunk_good_frames;
+		std::vector<char> chunk_values;
+		std::vector<long long> chunk_offsets;
+		std::vector<int> chunk_first_frames;
+		std::vector<int> chunk_num_frames;
+
 		// Internals for recording
 		int num_cols;
 		int num_rows;
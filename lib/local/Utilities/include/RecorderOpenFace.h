@@ -36,6 +36,8 @@
 
 #include "RecorderCSV.h"
 #include "RecorderHOG.h"
+#include "RecorderColumnar.h"
+#include "RecorderAlignedPack.h"
 #include "RecorderOpenFaceParameters.h"
 
 // System includes
@@ -46,8 +48,9 @@
 #include <opencv2/highgui/highgui.hpp>
 
 #include <thread>
+#include <memory>
 
-#include <ConcurrentQueue.h>
+#include <SPSCQueue.h>
 
 namespace Utilities
 {
@@ -111,6 +114,17 @@ namespace Utilities
 
 		std::string GetCSVFile() { return csv_filename; }
 
+		// The columnar output file (if that output is requested)
+		std::string GetColumnarFile() { return columnar_filename; }
+
+		// The directory the output is written to and the short name the output files are based on
+		std::string GetOutputDirectory() { return record_root; }
+		std::string GetOutputName() { return out_name; }
+
+		// Appending the output of a recording of a later part of the same sequence (e.g. when processing a video in segments), both recorders have to be closed,
+		// the CSV, HOG, and aligned face output is moved to this recording and the output files of the other recorder are removed
+		void MergeRecording(const RecorderOpenFace& other);
+
 	private:
 
 		// Blocking copy, assignment and move operators, as it does not make sense to save to the same location
@@ -123,7 +137,7 @@ namespace Utilities
 
 		// A thread that will write image and video output (the slowest parts of output_
 		void VideoWritingTask(bool is_sequence);
-		void AlignedImageWritingTask();
+		void AlignedImageWritingTask(int writer);
 
 		// Keeping track of what to output and how to output it
 		const RecorderOpenFaceParameters params;
@@ -133,12 +147,18 @@ namespace Utilities
 		std::string default_record_directory = "processed"; // By default we are writing in the processed directory in the working directory, if no output parameters provided
 		std::string out_name; // Short name, based on which other names are constructed
 		std::string csv_filename;
+		std::string columnar_filename;
+		std::string hog_filename;
 		std::string aligned_output_directory;
+		std::string aligned_pack_filename;
+		std::string metadata_filename;
 		std::ofstream metadata_file;
 
 		// The actual output file stream that will be written
 		RecorderCSV csv_recorder;
 		RecorderHOG hog_recorder;
+		RecorderColumnar columnar_recorder;
+		RecorderAlignedPack aligned_pack_recorder;
 
 		// The actual temporary storage for the observations
 		
@@ -175,17 +195,30 @@ namespace Utilities
 		// Do not exceed 100MB in the concurrent queue
 		const int TRACKED_QUEUE_CAPACITY = 100;
 		bool tracked_writing_thread_started;
+
+		// Statistics of the tracked video output (under the chosen output policy), reported when the recording is closed
+		int tracked_frames_queued;
+		int tracked_frames_dropped;
+		size_t tracked_max_queue_depth;
+		double tracked_stall_time;
+
+		// The intermediate file of uncompressed frames when using the raw output policy, it does not grow beyond 2GB (the frames buffered until
+		// then are encoded and the rest are encoded directly)
+		std::string raw_tracked_filename;
+		const int RAW_TRACKED_MAX_SIZE = 2048;
+		bool raw_tracked_overflow;
 		cv::Mat vis_to_out;
-		ConcurrentQueue<std::pair<std::string, cv::Mat> > vis_to_out_queue;
+		SPSCQueue<std::pair<std::string, cv::Mat> > vis_to_out_queue;
 
-		// For aligned face writing
+		// For aligned face writing, the faces are distributed over a pool of writing threads (each with its own queue)
 		const int ALIGNED_QUEUE_CAPACITY = 100;
 		bool aligned_writing_thread_started;
 		cv::Mat aligned_face;
-		ConcurrentQueue<std::pair<std::string, cv::Mat> > aligned_face_queue;
+		size_t next_aligned_writer;
+		std::vector<std::unique_ptr<SPSCQueue<std::pair<std::string, cv::Mat> > > > aligned_face_queues;
 
 		std::thread video_writing_thread;
-		std::thread aligned_writing_thread;
+		std::vector<std::thread> aligned_writing_threads;
 
 	};
 }
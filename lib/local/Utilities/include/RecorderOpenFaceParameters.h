@@ -63,6 +63,13 @@ namespace Utilities
 		bool outputHOG() const { return output_hog; }
 		bool outputTracked() const { return output_tracked; }
 		bool outputAlignedFaces() const { return output_aligned_faces; }
+		bool outputColumnar() const { return output_columnar; }
+		bool postprocessAUs() const { return postprocess_AUs; }
+		bool hogChunked() const { return hog_chunked; }
+		bool hogHalfPrecision() const { return hog_half_precision; }
+		bool alignedPacked() const { return aligned_packed; }
+		int alignedWriterThreads() const { return aligned_writer_threads; }
+		std::string trackedOutputPolicy() const { return tracked_output_policy; }
 		std::string outputCodec() const { return output_codec; }
 		std::string imageFormatAligned() const { return image_format_aligned; }
 		std::string imageFormatVisualization() const { return image_format_visualization; }
@@ -77,6 +84,13 @@ namespace Utilities
 
 		void setOutputAUs(bool output_AUs) { this->output_AUs = output_AUs; }
 		void setOutputGaze(bool output_gaze) { this->output_gaze = output_gaze; }
+		void setOutputColumnar(bool output_columnar) { this->output_columnar = output_columnar; }
+		void setPostprocessAUs(bool postprocess_AUs) { this->postprocess_AUs = postprocess_AUs; }
+		void setHOGChunked(bool hog_chunked) { this->hog_chunked = hog_chunked; }
+		void setHOGHalfPrecision(bool hog_half_precision) { this->hog_half_precision = hog_half_precision; }
+		void setAlignedPacked(bool aligned_packed) { this->aligned_packed = aligned_packed; }
+		void setAlignedWriterThreads(int aligned_writer_threads) { this->aligned_writer_threads = aligned_writer_threads; }
+		void setTrackedOutputPolicy(std::string tracked_output_policy) { this->tracked_output_policy = tracked_output_policy; }
 
 	private:
 		
@@ -95,12 +109,35 @@ namespace Utilities
 		bool output_hog;
 		bool output_tracked;
 		bool output_aligned_faces;
+
+		// If the CSV data should also be written in a columnar binary format
+		bool output_columnar;
+
+		// If the AUs in the CSV file will be post-processed (offline), they are then written at a fixed width (clamped intensities, two decimals)
+		// so that the post-processing can overwrite them in place, otherwise they are written as they are predicted
+		bool postprocess_AUs;
+
+		// If the HOG features should be written in a chunked and indexed format (allowing to seek to a frame), optionally stored as 16 bit floats
+		bool hog_chunked;
+		bool hog_half_precision;
 		
+		// If the aligned faces should be packed into a single file instead of a file per image
+		bool aligned_packed;
+
+		// The number of threads encoding and writing the aligned faces
+		int aligned_writer_threads;
+
 		// Should the algined faces be recorded even if the detection failed (blank images)
 		bool record_aligned_bad;
 
 		// Some video recording parameters
 		std::string output_codec;
+
+		// What to do when the tracked video cannot be encoded as fast as it is produced: "block" waits for the encoder, "drop" skips frames
+		// while the output queue is full, and "raw" writes uncompressed frames to an intermediate file that is encoded when the recording is closed.
+		// The raw file takes width * height * 3 bytes per frame (about 6MB at 1080p) next to the output video and is capped at 2GB, after which
+		// the frames are encoded directly, and closing the recording blocks until all of the buffered frames have been encoded
+		std::string tracked_output_policy;
 		double fps_vid_out;
 
 		// Image recording parameters
@@ -0,0 +1,182 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2017, Tadas Baltrusaitis all rights reserved.
+//
+// ACADEMIC OR NON-PROFIT ORGANIZATION NONCOMMERCIAL RESEARCH USE ONLY
+//
+// BY USING OR DOWNLOADING THE SOFTWARE, YOU ARE AGREEING TO THE TERMS OF THIS LICENSE AGREEMENT.  
+// IF YOU DO NOT AGREE WITH THESE TERMS, YOU MAY NOT USE OR DOWNLOAD THE SOFTWARE.
+//
+// License can be found in OpenFace-license.txt
+//
+//     * Any publications arising from the use of this software, including but
+//       not limited to academic journal and conference publications, technical
+//       reports and manuals, must cite at least one of the following works:
+//
+//       OpenFace 2.0: Facial Behavior Analysis Toolkit
+//       Tadas Baltruaitis, Amir Zadeh, Yao Chong Lim, and Louis-Philippe Morency
+//       in IEEE International Conference on Automatic Face and Gesture Recognition, 2018  
+//
+//       Convolutional experts constrained local model for facial landmark detection.
+//       A. Zadeh, T. Baltruaitis, and Louis-Philippe Morency,
+//       in Computer Vision and Pattern Recognition Workshops, 2017.    
+//
+//       Rendering of Eyes for Eye-Shape Registration and Gaze Estimation
+//       Erroll Wood, Tadas Baltruaitis, Xucong Zhang, Yusuke Sugano, Peter Robinson, and Andreas Bulling 
+//       in IEEE International. Conference on Computer Vision (ICCV),  2015 
+//
+//       Cross-dataset learning and person-specific normalisation for automatic Action Unit detection
+//       Tadas Baltruaitis, Marwa Mahmoud, and Peter Robinson 
+//       in Facial Expression Recognition and Analysis Challenge, 
+//       IEEE International Conference on Automatic Face and Gesture Recognition, 2015 
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <utility>
+
+namespace Utilities
+{
+
+	//===========================================================================
+	/**
+	A bounded lock-free queue for handing data from a single producer thread to a single consumer thread.
+	The slots are allocated up front, items are moved in and out of them, and a blocked push or pop spins
+	before backing off, so a handoff at high frame rates does not involve locks, syscalls or allocations.
+	*/
+	template <typename T>
+	class SPSCQueue
+	{
+	public:
+
+		SPSCQueue() { set_capacity(1); }
+		SPSCQueue(const SPSCQueue&) = delete;            // disable copying
+		SPSCQueue& operator=(const SPSCQueue&) = delete; // disable assignment
+
+		// Allocates the slots and clears the queue, should only be called when neither the producer nor the consumer are active
+		void set_capacity(int capacity)
+		{
+			if (capacity < 1)
+				capacity = 1;
+
+			// One slot is always kept free to tell a full queue from an empty one
+			slots_.clear();
+			slots_.resize(capacity + 1);
+			head_.store(0, std::memory_order_relaxed);
+			tail_.store(0, std::memory_order_relaxed);
+		}
+
+		int capacity() const { return (int)slots_.size() - 1; }
+
+		// Producer side, blocks while the queue is full
+		void push(T&& item)
+		{
+			int spins = 0;
+			while (!try_push(std::move(item)))
+			{
+				Backoff(spins);
+			}
+		}
+
+		void push(const T& item)
+		{
+			push(T(item));
+		}
+
+		// Does not block, returns false if the queue is full (in which case the item is left untouched)
+		bool try_push(T&& item)
+		{
+			const size_t tail = tail_.load(std::memory_order_relaxed);
+			const size_t next = Next(tail);
+
+			if (next == head_.load(std::memory_order_acquire))
+				return false;
+
+			slots_[tail] = std::move(item);
+			tail_.store(next, std::memory_order_release);
+			return true;
+		}
+
+		// Consumer side, blocks while the queue is empty
+		void pop(T& item)
+		{
+			int spins = 0;
+			while (!try_pop(item))
+			{
+				Backoff(spins);
+			}
+		}
+
+		T pop()
+		{
+			T item;
+			pop(item);
+			return item;
+		}
+
+		// Does not block, returns false if the queue is empty
+		bool try_pop(T& item)
+		{
+			const size_t head = head_.load(std::memory_order_relaxed);
+
+			if (head == tail_.load(std::memory_order_acquire))
+				return false;
+
+			// Move out so the slot does not keep a reference to the data (e.g. image buffers) after it has been consumed
+			item = std::move(slots_[head]);
+			slots_[head] = T();
+			head_.store(Next(head), std::memory_order_release);
+			return true;
+		}
+
+		bool empty() const
+		{
+			return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+		}
+
+		// Number of items currently in the queue (only approximate while the other side is active)
+		size_t size() const
+		{
+			const size_t head = head_.load(std::memory_order_acquire);
+			const size_t tail = tail_.load(std::memory_order_acquire);
+			return tail >= head ? tail - head : tail + slots_.size() - head;
+		}
+
+	private:
+
+		size_t Next(size_t idx) const
+		{
+			return idx + 1 == slots_.size() ? 0 : idx + 1;
+		}
+
+		// Spin first as the other side is usually about to make progress, only yield the thread on longer waits
+		static void Backoff(int& spins)
+		{
+			if (spins < 64)
+			{
+				++spins;
+			}
+			else if (spins < 128)
+			{
+				++spins;
+				std::this_thread::yield();
+			}
+			else
+			{
+				std::this_thread::sleep_for(std::chrono::microseconds(200));
+			}
+		}
+
+		std::vector<T> slots_;
+
+		// Consumer and producer positions are kept on separate cache lines to avoid false sharing
+		alignas(64) std::atomic<size_t> head_{ 0 };
+		alignas(64) std::atomic<size_t> tail_{ 0 };
+	};
+}
+#endif // SPSC_QUEUE_H
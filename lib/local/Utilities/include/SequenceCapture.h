@@ -45,7 +45,8 @@
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
-#include <ConcurrentQueue.h>
+#include <SPSCQueue.h>
+#include <ImageSequenceDecoder.h>
 
 namespace Utilities
 {
@@ -78,8 +79,13 @@ namespace Utilities
 		// Video file
 		bool OpenVideoFile(std::string video_file, float fx = -1, float fy = -1, float cx = -1, float cy = -1);
 
+		// A part of a video file, reading source frames in [start_frame, end_frame) (end_frame < 0 reads until the end of the video)
+		bool OpenVideoFileSegment(std::string video_file, int start_frame, int end_frame, float fx = -1, float fy = -1, float cx = -1, float cy = -1);
+
 		bool IsWebcam() { return is_webcam; }
 
+		bool IsImageSequence() { return is_image_seq; }
+
 		// Getting the next frame
 		cv::Mat GetNextFrame();
 
@@ -91,6 +97,12 @@ namespace Utilities
 
 		size_t GetFrameNumber() { return frame_num; }
 
+		// The number of frames in the source video or image sequence
+		size_t GetNumberOfFrames() { return vid_length; }
+
+		// The number of source frames between consecutive returned frames (1 unless a stride or target fps is used for a video or image sequence)
+		int GetFrameStride() { return curr_frame_stride; }
+
 		bool IsOpened();
 
 		void Close();
@@ -113,6 +125,14 @@ namespace Utilities
 				// Storing the captured data queue
 		static const int CAPTURE_CAPACITY = 200; // 200 MB
 
+		// The number of threads decoding images ahead when reading image sequences (if <= 0 a default based on the hardware is used)
+		int num_decode_threads = -1;
+
+		// For offline processing only every n-th frame can be returned (skipped frames are not decoded), alternatively a target fps
+		// can be specified for video files from which the stride is worked out (ignored for webcams)
+		int frame_stride = 1;
+		double target_fps = -1;
+
 	private:
 
 		// For faster input, multi-thread the capture so it is not waiting for processing to be done
@@ -139,13 +159,23 @@ namespace Utilities
 		cv::Mat latest_frame;
 		cv::Mat_<uchar> latest_gray_frame;
 		
-		// Storing capture timestamp, RGB image, gray image
-		ConcurrentQueue<std::tuple<double, cv::Mat, cv::Mat_<uchar> > > capture_queue;
+		// Storing capture timestamp, RGB image, gray image, and the index of the frame in the source sequence
+		SPSCQueue<std::tuple<double, cv::Mat, cv::Mat_<uchar>, size_t> > capture_queue;
 
-		// Keeping track of frame number and the files in the image sequence
+		// Keeping track of frame number (in the source sequence) and the files in the image sequence
 		size_t  frame_num;
+
+		// The stride used for the currently open sequence
+		int curr_frame_stride = 1;
+
+		// The part of the video being read, when only processing a segment of it
+		int segment_start_frame = 0;
+		int segment_end_frame = -1;
 		std::vector<std::string> image_files;
 
+		// Decoding the image sequence files in parallel
+		ImageSequenceDecoder image_decoder;
+
 		// Length of video allowing to assess progress
 		size_t vid_length;
 
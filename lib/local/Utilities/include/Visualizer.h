@@ -36,6 +36,8 @@
 
 // System includes
 #include <vector>
+#include <string>
+#include <functional>
 
 // OpenCV includes
 #include <opencv2/core/core.hpp>
@@ -46,7 +48,9 @@ namespace Utilities
 
 	//===========================================================================
 	/**
-	A class for recording data processed by OpenFace (facial landmarks, head pose, facial action units, aligned face, HOG features, and tracked video
+	A class for visualizing data processed by OpenFace (facial landmarks, head pose, facial action units, aligned face, HOG features, and tracked video).
+	Observations are only stored when they are set, the drawing (and copying of the image) happens when a visualization is shown or requested, so nothing
+	is rendered when no visualization is used.
 	*/
 	class Visualizer {
 
@@ -58,7 +62,7 @@ namespace Utilities
 
 		// Adding observations to the visualizer
 		
-		// Pose related observations
+		// The image to draw on, it is only copied when the tracking visualization is rendered so should not be modified until then
 		void SetImage(const cv::Mat& canvas, float fx, float fy, float cx, float cy);
 
 		// All observations relevant to facial landmarks (optional visibilities parameter to not display all landmarks)
@@ -86,6 +90,9 @@ namespace Utilities
 		cv::Mat GetVisImage();
 		cv::Mat GetHOGVis();
 
+		// If any of the visualizations are shown
+		bool IsVisualizing() const { return vis_track || vis_hog || vis_align || vis_aus; }
+
 		// Keeping track of what we're visualizing
 		bool vis_track;
 		bool vis_hog;
@@ -97,6 +104,29 @@ namespace Utilities
 
 	private:
 
+		// Rendering the visualizations from the observations collected since the last image was set
+		void RenderTracked();
+		void RenderHOG();
+		void RenderAlignedFaces();
+		void RenderActionUnits();
+
+		void DrawLandmarks(const cv::Mat_<float>& landmarks_2D, double confidence, const cv::Mat_<int>& visibilities);
+		void DrawPose(const cv::Vec6f& pose, double confidence);
+		void DrawGaze(const cv::Point3f& gazeDirection0, const cv::Point3f& gazeDirection1, const std::vector<cv::Point2f>& eye_landmarks, const std::vector<cv::Point3f>& eye_landmarks3d, double confidence);
+		void DrawFps(double fps);
+
+		// The observations waiting to be drawn on the image (in the order they were set)
+		cv::Mat source_image;
+		std::vector<std::function<void()> > pending_tracked_draws;
+		bool tracked_rendered;
+
+		std::vector<cv::Mat_<double> > pending_hog_descriptors;
+		std::vector<std::pair<int, int> > pending_hog_sizes;
+		std::vector<cv::Mat> pending_aligned_faces;
+		std::vector<std::pair<std::string, double> > pending_au_intensities;
+		std::vector<std::pair<std::string, double> > pending_au_occurences;
+		bool au_observed;
+
 		// Temporary variables for visualization
 		cv::Mat captured_image; // out canvas
 		cv::Mat tracked_image;
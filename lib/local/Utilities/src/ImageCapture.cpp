@@ -142,6 +142,14 @@ bool ImageCapture::Open(std::vector<std::string>& arguments)
 			data >> cy;
 			i++;
 		}
+		else if (arguments[i].compare("-decode_threads") == 0)
+		{
+			std::stringstream data(arguments[i + 1]);
+			data >> num_decode_threads;
+			valid[i] = false;
+			valid[i + 1] = false;
+			i++;
+		}
 	}
 
 	for (int i = (int)arguments.size() - 1; i >= 0; --i)
@@ -202,6 +210,9 @@ bool ImageCapture::OpenImageFiles(const std::vector<std::string>& image_files, f
 		image_optical_center_set = false;
 	}
 
+	// Start decoding the images ahead of them being requested
+	image_decoder.Start(this->image_files, num_decode_threads);
+
 	return true;
 
 }
@@ -306,6 +317,9 @@ bool ImageCapture::OpenDirectory(std::string directory, std::string bbox_directo
 		image_optical_center_set = false;
 	}
 
+	// Start decoding the images ahead of them being requested
+	image_decoder.Start(this->image_files, num_decode_threads);
+
 	return true;
 
 }
@@ -349,8 +363,8 @@ cv::Mat ImageCapture::GetNextImage()
 		return latest_frame;
 	}
 		
-	// Load the image as an 8 bit RGB
-	latest_frame = cv::imread(image_files[frame_num], cv::IMREAD_COLOR);
+	// Retrieve the image as an 8 bit RGB together with its grayscale version (decoded ahead of time by the decoder threads)
+	image_decoder.Next(latest_frame, latest_gray_frame);
 
 	if (latest_frame.empty())
 	{
@@ -382,9 +396,6 @@ cv::Mat ImageCapture::GetNextImage()
 
 	SetCameraIntrinsics(_fx, _fy, _cx, _cy);
 
-	// Set the grayscale frame
-	ConvertToGrayscale_8bit(latest_frame, latest_gray_frame);
-
 	this->name = image_files[frame_num];
 
 	frame_num++;
@@ -0,0 +1,170 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2017, Tadas Baltrusaitis, all rights reserved.
+//
+// ACADEMIC OR NON-PROFIT ORGANIZATION NONCOMMERCIAL RESEARCH USE ONLY
+//
+// BY USING OR DOWNLOADING THE SOFTWARE, YOU ARE AGREEING TO THE TERMS OF THIS LICENSE AGREEMENT.  
+// IF YOU DO NOT AGREE WITH THESE TERMS, YOU MAY NOT USE OR DOWNLOAD THE SOFTWARE.
+//
+// License can be found in OpenFace-license.txt
+//
+//     * Any publications arising from the use of this software, including but
+//       not limited to academic journal and conference publications, technical
+//       reports and manuals, must cite at least one of the following works:
+//
+//       OpenFace 2.0: Facial Behavior Analysis Toolkit
+//       Tadas Baltrušaitis, Amir Zadeh, Yao Chong Lim, and Louis-Philippe Morency
+//       in IEEE International Conference on Automatic Face and Gesture Recognition, 2018  
+//
+//       Convolutional experts constrained local model for facial landmark detection.
+//       A. Zadeh, T. Baltrušaitis, and Louis-Philippe Morency,
+//       in Computer Vision and Pattern Recognition Workshops, 2017.    
+//
+//       Rendering of Eyes for Eye-Shape Registration and Gaze Estimation
+//       Erroll Wood, Tadas Baltrušaitis, Xucong Zhang, Yusuke Sugano, Peter Robinson, and Andreas Bulling 
+//       in IEEE International. Conference on Computer Vision (ICCV),  2015 
+//
+//       Cross-dataset learning and person-specific normalisation for automatic Action Unit detection
+//       Tadas Baltrušaitis, Marwa Mahmoud, and Peter Robinson 
+//       in Facial Expression Recognition and Analysis Challenge, 
+//       IEEE International Conference on Automatic Face and Gesture Recognition, 2015 
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "stdafx_ut.h"
+
+#include "ImageSequenceDecoder.h"
+#include "ImageManipulationHelpers.h"
+
+using namespace Utilities;
+
+ImageSequenceDecoder::~ImageSequenceDecoder()
+{
+	Stop();
+}
+
+int ImageSequenceDecoder::DefaultNumThreads()
+{
+	// Leave the rest of the cores for tracking, decoding rarely needs more than a few threads to keep up
+	int num_cores = (int)std::thread::hardware_concurrency();
+	return std::max(1, std::min(4, num_cores / 2));
+}
+
+void ImageSequenceDecoder::Start(const std::vector<std::string>& image_files, int num_threads, int max_ahead)
+{
+	// Make sure any previous decoding is finished
+	Stop();
+
+	if (num_threads <= 0)
+	{
+		num_threads = DefaultNumThreads();
+	}
+	if (max_ahead <= 0)
+	{
+		max_ahead = 2 * num_threads;
+	}
+
+	this->image_files = image_files;
+	decoded_images.clear();
+	decoded_images.resize(max_ahead);
+	next_to_decode = 0;
+	next_to_retrieve = 0;
+	stopping = false;
+
+	for (int i = 0; i < num_threads; ++i)
+	{
+		decoder_threads.push_back(std::thread(&ImageSequenceDecoder::DecodingTask, this));
+	}
+}
+
+void ImageSequenceDecoder::DecodingTask()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while (true)
+	{
+		// Do not get too far ahead of the reader, as a slot is only free once the image previously in it is retrieved
+		while (!stopping && next_to_decode < image_files.size() && next_to_decode >= next_to_retrieve + decoded_images.size())
+		{
+			cond_space.wait(lock);
+		}
+
+		if (stopping || next_to_decode >= image_files.size())
+		{
+			break;
+		}
+
+		size_t idx = next_to_decode++;
+
+		// The decoding itself happens without holding the lock
+		lock.unlock();
+
+		cv::Mat image = cv::imread(image_files[idx], cv::IMREAD_COLOR);
+		cv::Mat_<uchar> gray_image;
+		if (!image.empty())
+		{
+			ConvertToGrayscale_8bit(image, gray_image);
+		}
+
+		lock.lock();
+
+		DecodedImage& decoded = decoded_images[idx % decoded_images.size()];
+		decoded.image = std::move(image);
+		decoded.gray_image = std::move(gray_image);
+		decoded.ready = true;
+
+		cond_decoded.notify_all();
+	}
+}
+
+bool ImageSequenceDecoder::Next(cv::Mat& image, cv::Mat_<uchar>& gray_image)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	if (decoded_images.empty() || next_to_retrieve >= image_files.size())
+	{
+		return false;
+	}
+
+	DecodedImage& decoded = decoded_images[next_to_retrieve % decoded_images.size()];
+
+	while (!decoded.ready && !stopping)
+	{
+		cond_decoded.wait(lock);
+	}
+
+	if (!decoded.ready)
+	{
+		return false;
+	}
+
+	image = std::move(decoded.image);
+	gray_image = std::move(decoded.gray_image);
+	decoded.image = cv::Mat();
+	decoded.gray_image = cv::Mat_<uchar>();
+	decoded.ready = false;
+
+	next_to_retrieve++;
+
+	lock.unlock();
+	cond_space.notify_all();
+
+	return true;
+}
+
+void ImageSequenceDecoder::Stop()
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	cond_space.notify_all();
+	cond_decoded.notify_all();
+
+	for (size_t i = 0; i < decoder_threads.size(); ++i)
+	{
+		if (decoder_threads[i].joinable())
+			decoder_threads[i].join();
+	}
+	decoder_threads.clear();
+}
@@ -0,0 +1,257 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2017, Tadas Baltrusaitis, all rights reserved.
+//
+// ACADEMIC OR NON-PROFIT ORGANIZATION NONCOMMERCIAL RESEARCH USE ONLY
+//
+// BY USING OR DOWNLOADING THE SOFTWARE, YOU ARE AGREEING TO THE TERMS OF THIS LICENSE AGREEMENT.  
+// IF YOU DO NOT AGREE WITH THESE TERMS, YOU MAY NOT USE OR DOWNLOAD THE SOFTWARE.
+//
+// License can be found in OpenFace-license.txt
+//
+//     * Any publications arising from the use of this software, including but
+//       not limited to academic journal and conference publications, technical
+//       reports and manuals, must cite at least one of the following works:
+//
+//       OpenFace 2.0: Facial Behavior Analysis Toolkit
+//       Tadas Baltruaitis, Amir Zadeh, Yao Chong Lim, and Louis-Philippe Morency
+//       in IEEE International Conference on Automatic Face and Gesture Recognition, 2018  
+//
+//       Convolutional experts constrained local model for facial landmark detection.
+//       A. Zadeh, T. Baltruaitis, and Louis-Philippe Morency,
+//       in Computer Vision and Pattern Recognition Workshops, 2017.    
+//
+//       Rendering of Eyes for Eye-Shape Registration and Gaze Estimation
+//       Erroll Wood, Tadas Baltruaitis, Xucong Zhang, Yusuke Sugano, Peter Robinson, and Andreas Bulling 
+//       in IEEE International. Conference on Computer Vision (ICCV),  2015 
+//
+//       Cross-dataset learning and person-specific normalisation for automatic Action Unit detection
+//       Tadas Baltruaitis, Marwa Mahmoud, and Peter Robinson 
+//       in Facial Expression Recognition and Analysis Challenge, 
+//       IEEE International Conference on Automatic Face and Gesture Recognition, 2015 
+//
+///////////////////////////////////////////////////////////////////////////////
+#include "stdafx_ut.h"
+
+#include "ReaderHOG.h"
+#include "RecorderHOG.h"
+
+using namespace Utilities;
+
+// Default constructor initializes the variables
+ReaderHOG::ReaderHOG() :hog_file(), chunked(false), half_precision(false), num_frames(0), num_cols(0), num_rows(0), num_channels(0), record_size(0), chunks_end(0) {};
+
+bool ReaderHOG::Open(const std::string& file_name)
+{
+	Close();
+
+	hog_file.open(file_name, std::ios_base::in | std::ios_base::binary);
+
+	if (!hog_file.is_open())
+		return false;
+
+	hog_file.seekg(0, std::ios_base::end);
+	long long file_size = (long long)hog_file.tellg();
+	hog_file.seekg(0, std::ios_base::beg);
+
+	char tag[8] = { 0 };
+	hog_file.read(tag, 8);
+	chunked = hog_file.gcount() == 8 && std::string(tag, 8) == "OFHOGCHK";
+	hog_file.clear();
+
+	bool success = chunked ? OpenChunked(file_size) : OpenDefault(file_size);
+
+	if (!success)
+		Close();
+
+	return success;
+}
+
+void ReaderHOG::Close()
+{
+	hog_file.close();
+	hog_file.clear();
+
+	chunked = false;
+	half_precision = false;
+	num_frames = 0;
+	num_cols = 0;
+	num_rows = 0;
+	num_channels = 0;
+	record_size = 0;
+	chunks_end = 0;
+	chunk_offsets.clear();
+	chunk_first_frames.clear();
+	chunk_num_frames.clear();
+}
+
+bool ReaderHOG::OpenDefault(long long file_size)
+{
+	// Every frame record has the same size, so the number of frames follows from the file size
+	hog_file.seekg(0, std::ios_base::beg);
+
+	chunks_end = file_size;
+
+	if (file_size == 0)
+		return true;
+
+	hog_file.read((char*)&num_cols, 4);
+	hog_file.read((char*)&num_rows, 4);
+	hog_file.read((char*)&num_channels, 4);
+
+	if (!hog_file || num_cols < 0 || num_rows < 0 || num_channels < 0)
+		return false;
+
+	record_size = 16 + 4 * (long long)num_cols * num_rows * num_channels;
+	num_frames = (int)(file_size / record_size);
+
+	return true;
+}
+
+bool ReaderHOG::OpenChunked(long long file_size)
+{
+	int version, value_type, chunk_frames;
+	hog_file.seekg(8, std::ios_base::beg);
+	hog_file.read((char*)&version, 4);
+	hog_file.read((char*)&num_cols, 4);
+	hog_file.read((char*)&num_rows, 4);
+	hog_file.read((char*)&num_channels, 4);
+	hog_file.read((char*)&value_type, 4);
+	hog_file.read((char*)&chunk_frames, 4);
+
+	if (!hog_file || version != RecorderHOG::CHUNKED_VERSION || (value_type != 0 && value_type != 1))
+	{
+		std::cout << "Unsupported HOG file format" << std::endl;
+		return false;
+	}
+
+	half_precision = value_type == 1;
+	const long long frame_size = (long long)num_cols * num_rows * num_channels * (half_precision ? 2 : 4);
+
+	// Reading the index from the end of the file
+	if (file_size >= RecorderHOG::CHUNKED_HEADER_SIZE + RecorderHOG::CHUNKED_FOOTER_SIZE)
+	{
+		int num_chunks = 0;
+		long long index_offset = 0;
+		char tag[8] = { 0 };
+
+		hog_file.seekg(file_size - RecorderHOG::CHUNKED_FOOTER_SIZE, std::ios_base::beg);
+		hog_file.read((char*)&num_chunks, 4);
+		hog_file.read((char*)&index_offset, 8);
+		hog_file.read(tag, 8);
+
+		if (hog_file && std::string(tag, 8) == "OFHOGIDX" && num_chunks >= 0 &&
+			index_offset + (long long)num_chunks * RecorderHOG::CHUNKED_INDEX_ENTRY_SIZE + RecorderHOG::CHUNKED_FOOTER_SIZE == file_size)
+		{
+			hog_file.seekg(index_offset, std::ios_base::beg);
+
+			chunk_offsets.resize(num_chunks);
+			chunk_first_frames.resize(num_chunks);
+			chunk_num_frames.resize(num_chunks);
+
+			for (int i = 0; i < num_chunks; ++i)
+			{
+				hog_file.read((char*)&chunk_offsets[i], 8);
+				hog_file.read((char*)&chunk_first_frames[i], 4);
+				hog_file.read((char*)&chunk_num_frames[i], 4);
+			}
+
+			if (hog_file)
+			{
+				num_frames = num_chunks == 0 ? 0 : chunk_first_frames.back() + chunk_num_frames.back();
+				chunks_end = index_offset;
+				return true;
+			}
+		}
+		hog_file.clear();
+	}
+
+	// Without an index (e.g. the recording was interrupted) the complete chunks are found by walking through the file
+	std::cout << "WARNING: the HOG file has no index, reading the chunks sequentially" << std::endl;
+
+	chunk_offsets.clear();
+	chunk_first_frames.clear();
+	chunk_num_frames.clear();
+	num_frames = 0;
+
+	long long offset = RecorderHOG::CHUNKED_HEADER_SIZE;
+	while (offset + 4 <= file_size)
+	{
+		int chunk_size = 0;
+		hog_file.seekg(offset, std::ios_base::beg);
+		hog_file.read((char*)&chunk_size, 4);
+
+		long long chunk_end = offset + 4 + (long long)chunk_size * (4 + frame_size);
+		if (!hog_file || chunk_size <= 0 || chunk_end > file_size)
+			break;
+
+		chunk_offsets.push_back(offset);
+		chunk_first_frames.push_back(num_frames);
+		chunk_num_frames.push_back(chunk_size);
+		num_frames += chunk_size;
+		offset = chunk_end;
+	}
+	hog_file.clear();
+
+	chunks_end = offset;
+
+	return true;
+}
+
+bool ReaderHOG::ReadFrame(int frame, cv::Mat_<float>& descriptor, bool& good_frame)
+{
+	if (!hog_file.is_open() || frame < 0 || frame >= num_frames)
+		return false;
+
+	const int num_values = num_cols * num_rows * num_channels;
+	float good_frame_float = -1;
+
+	descriptor.create(1, num_values);
+
+	if (!chunked)
+	{
+		int frame_cols, frame_rows, frame_channels;
+		hog_file.seekg((long long)frame * record_size, std::ios_base::beg);
+		hog_file.read((char*)&frame_cols, 4);
+		hog_file.read((char*)&frame_rows, 4);
+		hog_file.read((char*)&frame_channels, 4);
+		hog_file.read((char*)&good_frame_float, 4);
+
+		if (frame_cols != num_cols || frame_rows != num_rows || frame_channels != num_channels)
+			return false;
+
+		hog_file.read((char*)descriptor.data, 4 * (long long)num_values);
+	}
+	else
+	{
+		// Find the chunk containing the frame
+		int chunk = (int)(std::upper_bound(chunk_first_frames.begin(), chunk_first_frames.end(), frame) - chunk_first_frames.begin()) - 1;
+		const int frame_in_chunk = frame - chunk_first_frames[chunk];
+		const int value_size = half_precision ? 2 : 4;
+
+		hog_file.seekg(chunk_offsets[chunk] + 4 + 4 * (long long)frame_in_chunk, std::ios_base::beg);
+		hog_file.read((char*)&good_frame_float, 4);
+
+		hog_file.seekg(chunk_offsets[chunk] + 4 + 4 * (long long)chunk_num_frames[chunk] + (long long)frame_in_chunk * num_values * value_size, std::ios_base::beg);
+
+		if (half_precision)
+		{
+			value_buffer.resize((size_t)num_values * value_size);
+			hog_file.read(value_buffer.data(), value_buffer.size());
+			cv::Mat(1, num_values, CV_16F, value_buffer.data()).convertTo(descriptor, CV_32F);
+		}
+		else
+		{
+			hog_file.read((char*)descriptor.data, 4 * (long long)num_values);
+		}
+	}
+
+	good_frame = good_frame_float > 0;
+
+	if (!hog_file)
+	{
+		hog_file.clear();
+		return false;
+	}
+
+	return true;
+}
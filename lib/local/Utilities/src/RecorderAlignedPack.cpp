@@ -0,0 +1,295 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2017, Tadas Baltrusaitis, all rights reserved.
+//
+// ACADEMIC OR NON-PROFIT ORGANIZATION NONCOMMERCIAL RESEARCH USE ONLY
+//
+// BY USING OR DOWNLOADING THE SOFTWARE, YOU ARE AGREEING TO THE TERMS OF THIS LICENSE AGREEMENT.  
+// IF YOU DO NOT AGREE WITH THESE TERMS, YOU MAY NOT USE OR DOWNLOAD THE SOFTWARE.
+//
+// License can be found in OpenFace-license.txt
+//
+//     * Any publications arising from the use of this software, including but
+//       not limited to academic journal and conference publications, technical
+//       reports and manuals, must cite at least one of the following works:
+//
+//       OpenFace 2.0: Facial Behavior Analysis Toolkit
+//       Tadas Baltruaitis, Amir Zadeh, Yao Chong Lim, and Louis-Philippe Morency
+//       in IEEE International Conference on Automatic Face and Gesture Recognition, 2018  
+//
+//       Convolutional experts constrained local model for facial landmark detection.
+//       A. Zadeh, T. Baltruaitis, and Louis-Philippe Morency,
+//       in Computer Vision and Pattern Recognition Workshops, 2017.    
+//
+//       Rendering of Eyes for Eye-Shape Registration and Gaze Estimation
+//       Erroll Wood, Tadas Baltruaitis, Xucong Zhang, Yusuke Sugano, Peter Robinson, and Andreas Bulling 
+//       in IEEE International. Conference on Computer Vision (ICCV),  2015 
+//
+//       Cross-dataset learning and person-specific normalisation for automatic Action Unit detection
+//       Tadas Baltruaitis, Marwa Mahmoud, and Peter Robinson 
+//       in Facial Expression Recognition and Analysis Challenge, 
+//       IEEE International Conference on Automatic Face and Gesture Recognition, 2015 
+//
+///////////////////////////////////////////////////////////////////////////////
+#include "stdafx_ut.h"
+
+#include "RecorderAlignedPack.h"
+
+// OpenCV includes
+#include <opencv2/imgcodecs.hpp>
+
+using namespace Utilities;
+
+// Default constructor initializes the variables
+RecorderAlignedPack::RecorderAlignedPack() :output_file() {};
+
+bool RecorderAlignedPack::Open(std::string output_file_name)
+{
+	image_names.clear();
+	image_offsets.clear();
+	image_sizes.clear();
+
+	output_file.open(output_file_name, std::ios_base::out | std::ios_base::binary);
+
+	if (!output_file.is_open())
+		return false;
+
+	int version = VERSION;
+	output_file.write("OFALNPCK", 8);
+	output_file.write((char*)&version, 4);
+
+	return true;
+}
+
+void RecorderAlignedPack::Close()
+{
+	std::lock_guard<std::mutex> lock(write_mutex);
+
+	if (output_file.is_open())
+	{
+		WriteIndex(output_file, image_names, image_offsets, image_sizes);
+		output_file.close();
+	}
+}
+
+void RecorderAlignedPack::Write(const std::string& name, const std::vector<uchar>& encoded_image)
+{
+	std::lock_guard<std::mutex> lock(write_mutex);
+
+	if (!output_file.is_open())
+		return;
+
+	int name_length = (int)name.size();
+	long long image_size = (long long)encoded_image.size();
+
+	output_file.write((char*)&name_length, 4);
+	output_file.write(name.data(), name_length);
+	output_file.write((char*)&image_size, 8);
+
+	image_names.push_back(name);
+	image_offsets.push_back((long long)output_file.tellp());
+	image_sizes.push_back(image_size);
+
+	output_file.write((const char*)encoded_image.data(), image_size);
+}
+
+void RecorderAlignedPack::WriteIndex(std::ofstream& output_file, const std::vector<std::string>& names, const std::vector<long long>& offsets, const std::vector<long long>& sizes)
+{
+	long long index_offset = (long long)output_file.tellp();
+
+	for (size_t i = 0; i < names.size(); ++i)
+	{
+		int name_length = (int)names[i].size();
+		output_file.write((char*)&name_length, 4);
+		output_file.write(names[i].data(), name_length);
+		output_file.write((char*)&offsets[i], 8);
+		output_file.write((char*)&sizes[i], 8);
+	}
+
+	int num_images = (int)names.size();
+	output_file.write((char*)&num_images, 4);
+	output_file.write((char*)&index_offset, 8);
+	output_file.write("OFALNIDX", 8);
+}
+
+long long RecorderAlignedPack::ReadIndex(std::ifstream& input_file, std::vector<std::string>& names, std::vector<long long>& offsets, std::vector<long long>& sizes)
+{
+	names.clear();
+	offsets.clear();
+	sizes.clear();
+
+	input_file.seekg(0, std::ios_base::end);
+	long long file_size = (long long)input_file.tellg();
+	input_file.seekg(0, std::ios_base::beg);
+
+	char tag[8] = { 0 };
+	int version = 0;
+	input_file.read(tag, 8);
+	input_file.read((char*)&version, 4);
+
+	if (!input_file || std::string(tag, 8) != "OFALNPCK" || version != VERSION)
+	{
+		std::cout << "Unsupported aligned face file format" << std::endl;
+		return -1;
+	}
+
+	if (file_size >= HEADER_SIZE + FOOTER_SIZE)
+	{
+		int num_images = 0;
+		long long index_offset = 0;
+
+		input_file.seekg(file_size - FOOTER_SIZE, std::ios_base::beg);
+		input_file.read((char*)&num_images, 4);
+		input_file.read((char*)&index_offset, 8);
+		input_file.read(tag, 8);
+
+		if (input_file && std::string(tag, 8) == "OFALNIDX" && num_images >= 0 && index_offset >= HEADER_SIZE && index_offset <= file_size - FOOTER_SIZE)
+		{
+			input_file.seekg(index_offset, std::ios_base::beg);
+
+			for (int i = 0; i < num_images && input_file; ++i)
+			{
+				int name_length = 0;
+				long long offset = 0, size = 0;
+				input_file.read((char*)&name_length, 4);
+				std::string name(std::max(name_length, 0), ' ');
+				input_file.read(&name[0], name.size());
+				input_file.read((char*)&offset, 8);
+				input_file.read((char*)&size, 8);
+
+				names.push_back(name);
+				offsets.push_back(offset);
+				sizes.push_back(size);
+			}
+
+			if (input_file)
+				return index_offset;
+		}
+		input_file.clear();
+	}
+
+	// Without an index (e.g. the recording was interrupted) the complete images are found by walking through the file
+	std::cout << "WARNING: the aligned face file has no index, reading the images sequentially" << std::endl;
+
+	names.clear();
+	offsets.clear();
+	sizes.clear();
+
+	long long offset = HEADER_SIZE;
+	while (offset + 12 <= file_size)
+	{
+		int name_length = 0;
+		long long size = 0;
+
+		input_file.seekg(offset, std::ios_base::beg);
+		input_file.read((char*)&name_length, 4);
+		if (!input_file || name_length < 0 || offset + 12 + name_length > file_size)
+			break;
+
+		std::string name(name_length, ' ');
+		input_file.read(&name[0], name_length);
+		input_file.read((char*)&size, 8);
+
+		long long image_end = offset + 12 + name_length + size;
+		if (!input_file || size < 0 || image_end > file_size)
+			break;
+
+		names.push_back(name);
+		offsets.push_back(offset + 12 + name_length);
+		sizes.push_back(size);
+		offset = image_end;
+	}
+	input_file.clear();
+
+	return offset;
+}
+
+bool RecorderAlignedPack::ReadNames(const std::string& file_name, std::vector<std::string>& names)
+{
+	std::ifstream input_file(file_name, std::ios_base::in | std::ios_base::binary);
+
+	std::vector<long long> offsets, sizes;
+	return input_file.is_open() && ReadIndex(input_file, names, offsets, sizes) >= 0;
+}
+
+bool RecorderAlignedPack::ReadImage(const std::string& file_name, const std::string& name, cv::Mat& image)
+{
+	std::ifstream input_file(file_name, std::ios_base::in | std::ios_base::binary);
+
+	std::vector<std::string> names;
+	std::vector<long long> offsets, sizes;
+	if (!input_file.is_open() || ReadIndex(input_file, names, offsets, sizes) < 0)
+		return false;
+
+	size_t idx = std::find(names.begin(), names.end(), name) - names.begin();
+	if (idx == names.size())
+		return false;
+
+	std::vector<uchar> encoded_image((size_t)sizes[idx]);
+	input_file.seekg(offsets[idx], std::ios_base::beg);
+	input_file.read((char*)encoded_image.data(), encoded_image.size());
+
+	if (!input_file)
+		return false;
+
+	image = cv::imdecode(encoded_image, cv::IMREAD_UNCHANGED);
+
+	return !image.empty();
+}
+
+bool RecorderAlignedPack::AppendFile(const std::string& file_name, const std::string& other_file_name)
+{
+	std::vector<std::string> names, other_names;
+	std::vector<long long> offsets, sizes, other_offsets, other_sizes;
+
+	std::ifstream other_file(other_file_name, std::ios_base::in | std::ios_base::binary);
+	long long other_data_end = other_file.is_open() ? ReadIndex(other_file, other_names, other_offsets, other_sizes) : -1;
+
+	if (other_data_end < 0)
+	{
+		std::cout << "Could not read the aligned face file " << other_file_name << std::endl;
+		return false;
+	}
+
+	long long data_end;
+	{
+		std::ifstream input_file(file_name, std::ios_base::in | std::ios_base::binary);
+		data_end = input_file.is_open() ? ReadIndex(input_file, names, offsets, sizes) : -1;
+	}
+
+	if (data_end < 0)
+	{
+		std::cout << "Could not read the aligned face file " << file_name << std::endl;
+		return false;
+	}
+
+	// The images of the other file take the place of the current index
+	for (size_t i = 0; i < other_names.size(); ++i)
+	{
+		names.push_back(other_names[i]);
+		offsets.push_back(other_offsets[i] - HEADER_SIZE + data_end);
+		sizes.push_back(other_sizes[i]);
+	}
+
+	fs::resize_file(file_name, data_end);
+
+	std::ofstream output_file(file_name, std::ios_base::out | std::ios_base::app | std::ios_base::binary);
+	if (!output_file.is_open())
+		return false;
+
+	other_file.clear();
+	other_file.seekg(HEADER_SIZE, std::ios_base::beg);
+
+	std::vector<char> buffer(1 << 20);
+	long long remaining = other_data_end - HEADER_SIZE;
+	while (remaining > 0 && other_file)
+	{
+		std::streamsize block = (std::streamsize)std::min<long long>(remaining, (long long)buffer.size());
+		other_file.read(buffer.data(), block);
+		output_file.write(buffer.data(), other_file.gcount());
+		remaining -= other_file.gcount();
+	}
+
+	WriteIndex(output_file, names, offsets, sizes);
+
+	return remaining == 0 && output_file.good();
+}
@@ -34,6 +34,12 @@
 
 #include "RecorderCSV.h"
 
+#include <cmath>
+
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+
 using namespace Utilities;
 
 // Default constructor initializes the variables
@@ -46,7 +52,8 @@ struct fullstop : std::numpunct<char> {
 
 // Opening the file and preparing the header for it
 bool RecorderCSV::Open(std::string output_file_name, bool is_sequence, bool output_2D_landmarks, bool output_3D_landmarks, bool output_model_params, bool output_pose, bool output_AUs, bool output_gaze,
-	int num_face_landmarks, int num_model_modes, int num_eye_landmarks, const std::vector<std::string>& au_names_class, const std::vector<std::string>& au_names_reg)
+	int num_face_landmarks, int num_model_modes, int num_eye_landmarks, const std::vector<std::string>& au_names_class, const std::vector<std::string>& au_names_reg,
+	bool fixed_width_AUs)
 {
 
 	output_file.open(output_file_name, std::ios_base::out);
@@ -56,6 +63,7 @@ bool RecorderCSV::Open(std::string output_file_name, bool is_sequence, bool outp
 		return false;
 
 	this->is_sequence = is_sequence;
+	this->fixed_width_AUs = fixed_width_AUs;
 
 	// Set up what we are recording
 	this->output_2D_landmarks = output_2D_landmarks;
@@ -169,6 +177,55 @@ bool RecorderCSV::Open(std::string output_file_name, bool is_sequence, bool outp
 
 }
 
+// Appending values to the line being written, the output matches that of a stream with std::fixed and the given precision
+static void AppendValue(std::string& line, double value, int precision)
+{
+	char buffer[64];
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+	std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::fixed, precision);
+	if (result.ec == std::errc())
+	{
+		line.push_back(',');
+		line.append(buffer, result.ptr);
+		return;
+	}
+#endif
+	int length = std::snprintf(buffer, sizeof(buffer), "%.*f", precision, value);
+	if (length > 0 && length < (int)sizeof(buffer) && std::isfinite(value))
+	{
+		// snprintf uses the decimal point of the C locale, which might not be a full stop, the output only has the sign, digits and the decimal point
+		line.push_back(',');
+		bool decimal_point = false;
+		for (int i = 0; i < length; ++i)
+		{
+			if (buffer[i] == '-' || (buffer[i] >= '0' && buffer[i] <= '9'))
+			{
+				line.push_back(buffer[i]);
+			}
+			else if (!decimal_point)
+			{
+				line.push_back('.');
+				decimal_point = true;
+			}
+		}
+	}
+	else
+	{
+		// Very large values, and NaN or infinity
+		std::ostringstream stream;
+		stream.imbue(std::locale(stream.getloc(), new fullstop));
+		stream << std::fixed << std::setprecision(precision) << "," << value;
+		line.append(stream.str());
+	}
+}
+
+static void AppendValue(std::string& line, int value)
+{
+	char buffer[16];
+	int length = std::snprintf(buffer, sizeof(buffer), ",%d", value);
+	line.append(buffer, length);
+}
+
 void RecorderCSV::WriteLine(int face_id, int frame_num, double time_stamp, bool landmark_detection_success, double landmark_confidence,
 	const cv::Mat_<float>& landmarks_2D, const cv::Mat_<float>& landmarks_3D, const cv::Mat_<float>& pdm_model_params, const cv::Vec6f& rigid_shape_params, cv::Vec6f& pose_estimate,
 	const cv::Point3f& gazeDirection0, const cv::Point3f& gazeDirection1, const cv::Vec2f& gaze_angle, const std::vector<cv::Point2f>& eye_landmarks2d, const std::vector<cv::Point3f>& eye_landmarks3d,
@@ -181,121 +238,121 @@ void RecorderCSV::WriteLine(int face_id, int frame_num, double time_stamp, bool
 		exit(1);
 	}
 
-	// Making sure fixed and not scientific notation is used
-	output_file << std::fixed;
-	output_file << std::noshowpoint;
+	// The line is formatted into a buffer (reused across lines) and written out in one go, every value is preceded by a comma which is dropped for the first one
+	line_buffer.clear();
+
 	if(is_sequence)
 	{
-		
-		output_file << std::setprecision(3);
-		output_file << frame_num << "," << face_id << "," << time_stamp;
-		output_file << std::setprecision(2);
-		output_file << "," << landmark_confidence;
-		output_file << std::setprecision(0);
-		output_file << "," << landmark_detection_success;
+		AppendValue(line_buffer, frame_num);
+		AppendValue(line_buffer, face_id);
+		AppendValue(line_buffer, time_stamp, 3);
+		AppendValue(line_buffer, landmark_confidence, 2);
+		AppendValue(line_buffer, (int)landmark_detection_success);
 	}
 	else
 	{
-		output_file << std::setprecision(3);
-		output_file << face_id << "," << landmark_confidence;
+		AppendValue(line_buffer, face_id);
+		AppendValue(line_buffer, landmark_confidence, 3);
 	}
 	// Output the estimated gaze
 	if (output_gaze)
 	{
-		output_file << std::setprecision(6);
-		output_file << "," << gazeDirection0.x << "," << gazeDirection0.y << "," << gazeDirection0.z
-			<< "," << gazeDirection1.x << "," << gazeDirection1.y << "," << gazeDirection1.z;
+		AppendValue(line_buffer, gazeDirection0.x, 6);
+		AppendValue(line_buffer, gazeDirection0.y, 6);
+		AppendValue(line_buffer, gazeDirection0.z, 6);
+		AppendValue(line_buffer, gazeDirection1.x, 6);
+		AppendValue(line_buffer, gazeDirection1.y, 6);
+		AppendValue(line_buffer, gazeDirection1.z, 6);
 
 		// Output gaze angle (same format as head pose angle)
-		output_file << std::setprecision(3);
-		output_file << "," << gaze_angle[0] << "," << gaze_angle[1];
+		AppendValue(line_buffer, gaze_angle[0], 3);
+		AppendValue(line_buffer, gaze_angle[1], 3);
 
 		// Output the 2D eye landmarks
-		output_file << std::setprecision(1);
 		for (auto eye_lmk : eye_landmarks2d)
 		{
-			output_file << "," << eye_lmk.x;
+			AppendValue(line_buffer, eye_lmk.x, 1);
 		}
 
 		for (auto eye_lmk : eye_landmarks2d)
 		{
-			output_file << "," << eye_lmk.y;
+			AppendValue(line_buffer, eye_lmk.y, 1);
 		}
 
 		// Output the 3D eye landmarks
 		for (auto eye_lmk : eye_landmarks3d)
 		{
-			output_file << "," << eye_lmk.x;
+			AppendValue(line_buffer, eye_lmk.x, 1);
 		}
 
 		for (auto eye_lmk : eye_landmarks3d)
 		{
-			output_file << "," << eye_lmk.y;
+			AppendValue(line_buffer, eye_lmk.y, 1);
 		}
 
 		for (auto eye_lmk : eye_landmarks3d)
 		{
-			output_file << "," << eye_lmk.z;
+			AppendValue(line_buffer, eye_lmk.z, 1);
 		}
 	}
 
 	// Output the estimated head pose
 	if (output_pose)
 	{
-		output_file << std::setprecision(1);
-		output_file << "," << pose_estimate[0] << "," << pose_estimate[1] << "," << pose_estimate[2];
-		output_file << std::setprecision(3);
-		output_file << "," << pose_estimate[3] << "," << pose_estimate[4] << "," << pose_estimate[5];
+		AppendValue(line_buffer, pose_estimate[0], 1);
+		AppendValue(line_buffer, pose_estimate[1], 1);
+		AppendValue(line_buffer, pose_estimate[2], 1);
+		AppendValue(line_buffer, pose_estimate[3], 3);
+		AppendValue(line_buffer, pose_estimate[4], 3);
+		AppendValue(line_buffer, pose_estimate[5], 3);
 	}
 
 	// Output the detected 2D facial landmarks
 	if (output_2D_landmarks)
 	{
-		output_file.precision(1);
-		// Output the 2D eye landmarks
 		for (auto lmk : landmarks_2D)
 		{
-			output_file << "," << lmk;
+			AppendValue(line_buffer, lmk, 1);
 		}
 	}
 
 	// Output the detected 3D facial landmarks
 	if (output_3D_landmarks)
 	{
-		output_file.precision(1);
-		// Output the 2D eye landmarks
 		for (auto lmk : landmarks_3D)
 		{
-			output_file << "," << lmk;
+			AppendValue(line_buffer, lmk, 1);
 		}
 	}
 
 	if (output_model_params)
 	{
-		output_file.precision(3);
 		for (int i = 0; i < 6; ++i)
 		{
-			output_file << "," << rigid_shape_params[i];
+			AppendValue(line_buffer, rigid_shape_params[i], 3);
 		}
 		// Output the non_rigid shape parameters
 		for (auto lmk : pdm_model_params)
 		{
-			output_file << "," << lmk;
+			AppendValue(line_buffer, lmk, 3);
 		}
 	}
 
 	if (output_AUs)
 	{
+		// If the AUs are post-processed they are written at a fixed width (intensities are clamped to 0-5), so that the offline post-processing
+		// of AUs can overwrite them in place without rewriting the whole file
+		const char* missing_AU = fixed_width_AUs ? ",0.00" : ",0";
 
 		// write out ar the correct index
-		output_file.precision(2);
 		for (std::string au_name : au_names_reg)
 		{
 			for (auto au_reg : au_intensities)
 			{
 				if (au_name.compare(au_reg.first) == 0)
 				{
-					output_file << "," << au_reg.second;
+					// Adding 0 turns -0 (which std::max keeps) into 0, so that it is not written as -0.00 breaking the fixed width
+					AppendValue(line_buffer, fixed_width_AUs ? std::min(std::max(au_reg.second, 0.0), 5.0) + 0.0 : au_reg.second, 2);
 					break;
 				}
 			}
@@ -305,11 +362,10 @@ void RecorderCSV::WriteLine(int face_id, int frame_num, double time_stamp, bool
 		{
 			for (size_t p = 0; p < au_names_reg.size(); ++p)
 			{
-				output_file << ",0";
+				line_buffer.append(missing_AU);
 			}
 		}
 
-		output_file.precision(1);
 		// write out ar the correct index
 		for (std::string au_name : au_names_class)
 		{
@@ -317,7 +373,7 @@ void RecorderCSV::WriteLine(int face_id, int frame_num, double time_stamp, bool
 			{
 				if (au_name.compare(au_class.first) == 0)
 				{
-					output_file << "," << au_class.second;
+					AppendValue(line_buffer, au_class.second, fixed_width_AUs ? 2 : 1);
 					break;
 				}
 			}
@@ -327,11 +383,14 @@ void RecorderCSV::WriteLine(int face_id, int frame_num, double time_stamp, bool
 		{
 			for (size_t p = 0; p < au_names_class.size(); ++p)
 			{
-				output_file << ",0";
+				line_buffer.append(missing_AU);
 			}
 		}
 	}
-	output_file << "\n";
+	line_buffer.push_back('\n');
+
+	// Skip the leading comma
+	output_file.write(line_buffer.data() + 1, line_buffer.size() - 1);
 }
 
 // Closing the file and cleaning up
@@ -0,0 +1,464 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2017, Tadas Baltrusaitis all rights reserved.
+//
+// ACADEMIC OR NON-PROFIT ORGANIZATION NONCOMMERCIAL RESEARCH USE ONLY
+//
+// BY USING OR DOWNLOADING THE SOFTWARE, YOU ARE AGREEING TO THE TERMS OF THIS LICENSE AGREEMENT.  
+// IF YOU DO NOT AGREE WITH THESE TERMS, YOU MAY NOT USE OR DOWNLOAD THE SOFTWARE.
+//
+// License can be found in OpenFace-license.txt
+//
+//     * Any publications arising from the use of this software, including but
+//       not limited to academic journal and conference publications, technical
+//       reports and manuals, must cite at least one of the following works:
+//
+//       OpenFace 2.0: Facial Behavior Analysis Toolkit
+//       Tadas Baltruaitis, Amir Zadeh, Yao Chong Lim, and Louis-Philippe Morency
+//       in IEEE International Conference on Automatic Face and Gesture Recognition, 2018  
+//
+//       Convolutional experts constrained local model for facial landmark detection.
+//       A. Zadeh, T. Baltruaitis, and Louis-Philippe Morency,
+//       in Computer Vision and Pattern Recognition Workshops, 2017.    
+//
+//       Rendering of Eyes for Eye-Shape Registration and Gaze Estimation
+//       Erroll Wood, Tadas Baltruaitis, Xucong Zhang, Yusuke Sugano, Peter Robinson, and Andreas Bulling 
+//       in IEEE International. Conference on Computer Vision (ICCV),  2015 
+//
+//       Cross-dataset learning and person-specific normalisation for automatic Action Unit detection
+//       Tadas Baltruaitis, Marwa Mahmoud, and Peter Robinson 
+//       in Facial Expression Recognition and Analysis Challenge, 
+//       IEEE International Conference on Automatic Face and Gesture Recognition, 2015 
+//
+///////////////////////////////////////////////////////////////////////////////
+#include "stdafx_ut.h"
+
+#include "RecorderColumnar.h"
+
+using namespace Utilities;
+
+// Identifying the file type and version
+static const char COLUMNAR_TAG[8] = { 'O', 'F', 'C', 'O', 'L', 'U', 'M', 'N' };
+static const int COLUMNAR_VERSION = 1;
+
+// Default constructor initializes the variables
+RecorderColumnar::RecorderColumnar() :output_file(), chunk_num_rows(0), curr_column(0) {};
+
+// Opening the file and preparing the header for it
+bool RecorderColumnar::Open(std::string output_file_name, bool is_sequence, bool output_2D_landmarks, bool output_3D_landmarks, bool output_model_params, bool output_pose, bool output_AUs, bool output_gaze,
+	int num_face_landmarks, int num_model_modes, int num_eye_landmarks, const std::vector<std::string>& au_names_class, const std::vector<std::string>& au_names_reg)
+{
+	output_file.open(output_file_name, std::ios_base::out | std::ios_base::binary);
+
+	if (!output_file.is_open())
+		return false;
+
+	this->is_sequence = is_sequence;
+
+	// Set up what we are recording
+	this->output_2D_landmarks = output_2D_landmarks;
+	this->output_3D_landmarks = output_3D_landmarks;
+	this->output_AUs = output_AUs;
+	this->output_gaze = output_gaze;
+	this->output_model_params = output_model_params;
+	this->output_pose = output_pose;
+
+	this->au_names_class = au_names_class;
+	this->au_names_reg = au_names_reg;
+
+	// The columns are the same as in the CSV output
+	column_names.clear();
+	if (this->is_sequence)
+	{
+		column_names.insert(column_names.end(), { "frame", "face_id", "timestamp", "confidence", "success" });
+	}
+	else
+	{
+		column_names.insert(column_names.end(), { "face", "confidence" });
+	}
+
+	if (output_gaze)
+	{
+		column_names.insert(column_names.end(), { "gaze_0_x", "gaze_0_y", "gaze_0_z", "gaze_1_x", "gaze_1_y", "gaze_1_z", "gaze_angle_x", "gaze_angle_y" });
+
+		const char* eye_prefixes[5] = { "eye_lmk_x_", "eye_lmk_y_", "eye_lmk_X_", "eye_lmk_Y_", "eye_lmk_Z_" };
+		for (const char* prefix : eye_prefixes)
+		{
+			for (int i = 0; i < num_eye_landmarks; ++i)
+			{
+				column_names.push_back(prefix + std::to_string(i));
+			}
+		}
+	}
+
+	if (output_pose)
+	{
+		column_names.insert(column_names.end(), { "pose_Tx", "pose_Ty", "pose_Tz", "pose_Rx", "pose_Ry", "pose_Rz" });
+	}
+
+	if (output_2D_landmarks)
+	{
+		for (const char* prefix : { "x_", "y_" })
+		{
+			for (int i = 0; i < num_face_landmarks; ++i)
+			{
+				column_names.push_back(prefix + std::to_string(i));
+			}
+		}
+	}
+
+	if (output_3D_landmarks)
+	{
+		for (const char* prefix : { "X_", "Y_", "Z_" })
+		{
+			for (int i = 0; i < num_face_landmarks; ++i)
+			{
+				column_names.push_back(prefix + std::to_string(i));
+			}
+		}
+	}
+
+	// Outputting model parameters (rigid and non-rigid), the first parameters are the 6 rigid shape parameters, they are followed by the non rigid shape parameters
+	if (output_model_params)
+	{
+		column_names.insert(column_names.end(), { "p_scale", "p_rx", "p_ry", "p_rz", "p_tx", "p_ty" });
+		for (int i = 0; i < num_model_modes; ++i)
+		{
+			column_names.push_back("p_" + std::to_string(i));
+		}
+	}
+
+	if (output_AUs)
+	{
+		std::sort(this->au_names_reg.begin(), this->au_names_reg.end());
+		for (std::string reg_name : this->au_names_reg)
+		{
+			column_names.push_back(reg_name + "_r");
+		}
+
+		std::sort(this->au_names_class.begin(), this->au_names_class.end());
+		for (std::string class_name : this->au_names_class)
+		{
+			column_names.push_back(class_name + "_c");
+		}
+	}
+
+	// Work out the header size
+	int num_columns = (int)column_names.size();
+	int header_size = sizeof(COLUMNAR_TAG) + 4 * 4;
+	for (const std::string& name : column_names)
+	{
+		header_size += 4 + (int)name.size();
+	}
+
+	output_file.write(COLUMNAR_TAG, sizeof(COLUMNAR_TAG));
+	output_file.write((char*)&header_size, 4);
+	output_file.write((char*)&COLUMNAR_VERSION, 4);
+	output_file.write((char*)&num_columns, 4);
+	int chunk_rows = CHUNK_ROWS;
+	output_file.write((char*)&chunk_rows, 4);
+	for (const std::string& name : column_names)
+	{
+		int name_length = (int)name.size();
+		output_file.write((char*)&name_length, 4);
+		output_file.write(name.data(), name_length);
+	}
+
+	chunk.assign(num_columns * CHUNK_ROWS, 0.0f);
+	chunk_num_rows = 0;
+
+	return true;
+}
+
+void RecorderColumnar::WriteLine(int face_id, int frame_num, double time_stamp, bool landmark_detection_success, double landmark_confidence,
+	const cv::Mat_<float>& landmarks_2D, const cv::Mat_<float>& landmarks_3D, const cv::Mat_<float>& pdm_model_params, const cv::Vec6f& rigid_shape_params, cv::Vec6f& pose_estimate,
+	const cv::Point3f& gazeDirection0, const cv::Point3f& gazeDirection1, const cv::Vec2f& gaze_angle, const std::vector<cv::Point2f>& eye_landmarks2d, const std::vector<cv::Point3f>& eye_landmarks3d,
+	const std::vector<std::pair<std::string, double> >& au_intensities, const std::vector<std::pair<std::string, double> >& au_occurences)
+{
+	if (!output_file.is_open())
+	{
+		std::cout << "The output columnar file is not open, exiting" << std::endl;
+		exit(1);
+	}
+
+	curr_column = 0;
+
+	if (is_sequence)
+	{
+		AddValue((float)frame_num);
+		AddValue((float)face_id);
+		AddValue((float)time_stamp);
+		AddValue((float)landmark_confidence);
+		AddValue(landmark_detection_success ? 1.0f : 0.0f);
+	}
+	else
+	{
+		AddValue((float)face_id);
+		AddValue((float)landmark_confidence);
+	}
+
+	if (output_gaze)
+	{
+		AddValue(gazeDirection0.x); AddValue(gazeDirection0.y); AddValue(gazeDirection0.z);
+		AddValue(gazeDirection1.x); AddValue(gazeDirection1.y); AddValue(gazeDirection1.z);
+		AddValue(gaze_angle[0]); AddValue(gaze_angle[1]);
+
+		for (auto eye_lmk : eye_landmarks2d)
+			AddValue(eye_lmk.x);
+		for (auto eye_lmk : eye_landmarks2d)
+			AddValue(eye_lmk.y);
+		for (auto eye_lmk : eye_landmarks3d)
+			AddValue(eye_lmk.x);
+		for (auto eye_lmk : eye_landmarks3d)
+			AddValue(eye_lmk.y);
+		for (auto eye_lmk : eye_landmarks3d)
+			AddValue(eye_lmk.z);
+	}
+
+	if (output_pose)
+	{
+		for (int i = 0; i < 6; ++i)
+			AddValue(pose_estimate[i]);
+	}
+
+	if (output_2D_landmarks)
+	{
+		for (auto lmk : landmarks_2D)
+			AddValue(lmk);
+	}
+
+	if (output_3D_landmarks)
+	{
+		for (auto lmk : landmarks_3D)
+			AddValue(lmk);
+	}
+
+	if (output_model_params)
+	{
+		for (int i = 0; i < 6; ++i)
+			AddValue(rigid_shape_params[i]);
+		for (auto lmk : pdm_model_params)
+			AddValue(lmk);
+	}
+
+	if (output_AUs)
+	{
+		for (std::string au_name : au_names_reg)
+		{
+			float value = 0;
+			for (auto au_reg : au_intensities)
+			{
+				if (au_name.compare(au_reg.first) == 0)
+				{
+					value = (float)au_reg.second;
+					break;
+				}
+			}
+			AddValue(value);
+		}
+
+		for (std::string au_name : au_names_class)
+		{
+			float value = 0;
+			for (auto au_class : au_occurences)
+			{
+				if (au_name.compare(au_class.first) == 0)
+				{
+					value = (float)au_class.second;
+					break;
+				}
+			}
+			AddValue(value);
+		}
+	}
+
+	if (curr_column != (int)column_names.size())
+	{
+		std::cout << "The number of values does not match the columnar file header, exiting" << std::endl;
+		exit(1);
+	}
+
+	chunk_num_rows++;
+	if (chunk_num_rows == CHUNK_ROWS)
+	{
+		WriteChunk();
+	}
+}
+
+void RecorderColumnar::WriteChunk()
+{
+	if (chunk_num_rows == 0)
+		return;
+
+	// The values of each column are contiguous in the chunk
+	output_file.write((char*)&chunk_num_rows, 4);
+	for (size_t c = 0; c < column_names.size(); ++c)
+	{
+		output_file.write((char*)&chunk[c * CHUNK_ROWS], 4 * chunk_num_rows);
+	}
+	chunk_num_rows = 0;
+}
+
+// Closing the file and cleaning up
+void RecorderColumnar::Close()
+{
+	if (output_file.is_open())
+	{
+		WriteChunk();
+		output_file.close();
+	}
+}
+
+int RecorderColumnar::ReadHeader(std::ifstream& input_file, std::vector<std::string>& column_names)
+{
+	char tag[sizeof(COLUMNAR_TAG)];
+	int header_size, version, num_columns, chunk_rows;
+
+	input_file.read(tag, sizeof(tag));
+	input_file.read((char*)&header_size, 4);
+	input_file.read((char*)&version, 4);
+	input_file.read((char*)&num_columns, 4);
+	input_file.read((char*)&chunk_rows, 4);
+
+	if (!input_file || !std::equal(tag, tag + sizeof(tag), COLUMNAR_TAG) || version != COLUMNAR_VERSION || num_columns < 0)
+	{
+		return -1;
+	}
+
+	column_names.resize(num_columns);
+	for (int c = 0; c < num_columns; ++c)
+	{
+		int name_length;
+		input_file.read((char*)&name_length, 4);
+		if (!input_file || name_length < 0 || name_length > header_size)
+		{
+			return -1;
+		}
+		column_names[c].resize(name_length);
+		input_file.read(&column_names[c][0], name_length);
+	}
+
+	if (!input_file)
+	{
+		return -1;
+	}
+
+	return header_size;
+}
+
+bool RecorderColumnar::ReadColumnNames(const std::string& file_name, std::vector<std::string>& column_names)
+{
+	std::ifstream input_file(file_name, std::ios_base::in | std::ios_base::binary);
+
+	return input_file.is_open() && ReadHeader(input_file, column_names) >= 0;
+}
+
+bool RecorderColumnar::ReadColumn(const std::string& file_name, const std::string& column_name, std::vector<float>& values)
+{
+	values.clear();
+
+	std::ifstream input_file(file_name, std::ios_base::in | std::ios_base::binary);
+	if (!input_file.is_open())
+		return false;
+
+	std::vector<std::string> column_names;
+	int header_size = ReadHeader(input_file, column_names);
+	if (header_size < 0)
+		return false;
+
+	int column = (int)(std::find(column_names.begin(), column_names.end(), column_name) - column_names.begin());
+	if (column == (int)column_names.size())
+		return false;
+
+	// Go through the chunks only reading the requested column
+	std::streamoff chunk_start = header_size;
+	int num_rows;
+	input_file.seekg(chunk_start);
+	while (input_file.read((char*)&num_rows, 4))
+	{
+		size_t curr_size = values.size();
+		values.resize(curr_size + num_rows);
+
+		input_file.seekg(chunk_start + 4 + (std::streamoff)column * num_rows * 4);
+		input_file.read((char*)&values[curr_size], 4 * (std::streamsize)num_rows);
+
+		chunk_start += 4 + (std::streamoff)column_names.size() * num_rows * 4;
+		input_file.seekg(chunk_start);
+	}
+
+	return true;
+}
+
+bool RecorderColumnar::OverwriteColumn(const std::string& file_name, const std::string& column_name, const std::vector<float>& values)
+{
+	std::fstream file(file_name, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+	if (!file.is_open())
+		return false;
+
+	std::vector<std::string> column_names;
+	std::ifstream input_file(file_name, std::ios_base::in | std::ios_base::binary);
+	int header_size = ReadHeader(input_file, column_names);
+	if (header_size < 0)
+		return false;
+
+	int column = (int)(std::find(column_names.begin(), column_names.end(), column_name) - column_names.begin());
+	if (column == (int)column_names.size())
+		return false;
+
+	// Find the chunks first, to make sure the number of rows matches before writing anything
+	std::vector<std::pair<std::streamoff, int> > chunks;
+	std::streamoff chunk_start = header_size;
+	size_t num_rows_total = 0;
+	int num_rows;
+	input_file.seekg(chunk_start);
+	while (input_file.read((char*)&num_rows, 4))
+	{
+		chunks.push_back(std::make_pair(chunk_start, num_rows));
+		num_rows_total += num_rows;
+		chunk_start += 4 + (std::streamoff)column_names.size() * num_rows * 4;
+		input_file.seekg(chunk_start);
+	}
+
+	if (num_rows_total != values.size())
+		return false;
+
+	size_t row = 0;
+	for (auto chunk : chunks)
+	{
+		file.seekp(chunk.first + 4 + (std::streamoff)column * chunk.second * 4);
+		file.write((char*)&values[row], 4 * (std::streamsize)chunk.second);
+		row += chunk.second;
+	}
+
+	return file.good();
+}
+
+bool RecorderColumnar::AppendFile(const std::string& file_name, const std::string& other_file_name)
+{
+	std::ifstream other_file(other_file_name, std::ios_base::in | std::ios_base::binary);
+	if (!other_file.is_open())
+		return false;
+
+	std::vector<std::string> other_column_names;
+	int other_header_size = ReadHeader(other_file, other_column_names);
+	if (other_header_size < 0)
+		return false;
+
+	// If there is nothing to append to yet, just copy the whole file
+	std::ifstream input_file(file_name, std::ios_base::in | std::ios_base::binary);
+	std::vector<std::string> column_names;
+	bool has_header = input_file.is_open() && ReadHeader(input_file, column_names) >= 0;
+	input_file.close();
+
+	if (has_header && column_names != other_column_names)
+		return false;
+
+	other_file.seekg(has_header ? other_header_size : 0);
+
+	std::ofstream output_file(file_name, std::ios_base::out | std::ios_base::app | std::ios_base::binary);
+	if (other_file.peek() != std::char_traits<char>::eof())
+	{
+		output_file << other_file.rdbuf();
+	}
+
+	return output_file.good();
+}
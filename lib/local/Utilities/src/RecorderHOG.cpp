@@ -33,27 +33,72 @@
 #include "stdafx_ut.h"
 
 #include "RecorderHOG.h"
+#include "ReaderHOG.h"
 
 using namespace Utilities;
 
 // Default constructor initializes the variables
-RecorderHOG::RecorderHOG() :hog_file() {};
+RecorderHOG::RecorderHOG() :hog_file(), chunked(false), half_precision(false), header_written(false), num_frames_written(0) {};
 
 // Opening the file and preparing the header for it
-bool RecorderHOG::Open(std::string output_file_name)
+bool RecorderHOG::Open(std::string output_file_name, bool chunked, bool half_precision)
 {
+	this->chunked = chunked;
+	this->half_precision = half_precision;
+
 	hog_file.open(output_file_name, std::ios_base::out | std::ios_base::binary);
 
+	if (hog_file.is_open() && chunked)
+	{
+		header_written = false;
+		num_frames_written = 0;
+		chunk_good_frames.clear();
+		chunk_values.clear();
+		chunk_offsets.clear();
+		chunk_first_frames.clear();
+		chunk_num_frames.clear();
+
+		// A couple of chunks can be waiting for the writing thread before the recording blocks
+		chunk_queue.set_capacity(2 * CHUNK_FRAMES);
+		chunk_writer = std::thread(&RecorderHOG::ChunkWriterThread, this);
+	}
+
 	return hog_file.is_open();
 }
 
 void RecorderHOG::Close()
 {
+	// Let the writing thread finish the last chunk and the index
+	if (chunk_writer.joinable())
+	{
+		HOGFrame last_frame;
+		last_frame.last = true;
+		chunk_queue.push(std::move(last_frame));
+		chunk_writer.join();
+	}
+
 	hog_file.close();
 }
 
 void RecorderHOG::Write()
 {
+	if (chunked)
+	{
+		if (!chunk_writer.joinable())
+			return;
+
+		// The conversion copies the descriptor, so the caller is free to reuse it
+		HOGFrame frame;
+		frame.num_cols = num_cols;
+		frame.num_rows = num_rows;
+		frame.num_channels = num_channels;
+		frame.good_frame = good_frame;
+		hog_descriptor.convertTo(frame.descriptor, CV_32F);
+
+		chunk_queue.push(std::move(frame));
+		return;
+	}
+
 	hog_file.write((char*)(&num_cols), 4);
 	hog_file.write((char*)(&num_rows), 4);
 	hog_file.write((char*)(&num_channels), 4);
@@ -91,6 +136,207 @@ void RecorderHOG::Write()
 	}
 }
 
+void RecorderHOG::ChunkWriterThread()
+{
+	while (true)
+	{
+		HOGFrame frame;
+		chunk_queue.pop(frame);
+
+		if (frame.last)
+			break;
+
+		// The dimensions of the first frame are used for the whole file
+		if (!header_written)
+			WriteChunkedHeader(frame.num_cols, frame.num_rows, frame.num_channels);
+
+		const int num_values = chunk_num_cols * chunk_num_rows * chunk_num_channels;
+		const size_t value_size = half_precision ? 2 : 4;
+
+		// A frame that does not match the dimensions of the file is recorded as a failed one (with zero values), to keep the frame numbering intact
+		bool valid = frame.num_cols == chunk_num_cols && frame.num_rows == chunk_num_rows && frame.num_channels == chunk_num_channels &&
+			frame.descriptor.total() == (size_t)num_values;
+
+		if (!valid)
+		{
+			std::cout << "WARNING: HOG descriptor dimensions do not match the ones of the file, recording it as a failed frame" << std::endl;
+		}
+
+		chunk_good_frames.push_back(frame.good_frame && valid ? 1.0f : -1.0f);
+
+		size_t offset = chunk_values.size();
+		chunk_values.resize(offset + num_values * value_size, 0);
+
+		if (valid)
+		{
+			if (half_precision)
+			{
+				cv::Mat half_values(1, num_values, CV_16F, chunk_values.data() + offset);
+				frame.descriptor.reshape(1, 1).convertTo(half_values, CV_16F);
+			}
+			else
+			{
+				memcpy(chunk_values.data() + offset, frame.descriptor.data, num_values * value_size);
+			}
+		}
+
+		num_frames_written++;
+
+		if ((int)chunk_good_frames.size() == CHUNK_FRAMES)
+		{
+			WriteChunk();
+		}
+	}
+
+	if (!header_written)
+		WriteChunkedHeader(0, 0, 0);
+
+	WriteChunk();
+
+	WriteChunkedIndex(hog_file, chunk_offsets, chunk_first_frames, chunk_num_frames);
+}
+
+void RecorderHOG::WriteChunkedHeader(int num_cols, int num_rows, int num_channels)
+{
+	chunk_num_cols = num_cols;
+	chunk_num_rows = num_rows;
+	chunk_num_channels = num_channels;
+
+	int version = CHUNKED_VERSION;
+	int value_type = half_precision ? 1 : 0;
+	int chunk_frames = CHUNK_FRAMES;
+
+	hog_file.write("OFHOGCHK", 8);
+	hog_file.write((char*)&version, 4);
+	hog_file.write((char*)&num_cols, 4);
+	hog_file.write((char*)&num_rows, 4);
+	hog_file.write((char*)&num_channels, 4);
+	hog_file.write((char*)&value_type, 4);
+	hog_file.write((char*)&chunk_frames, 4);
+
+	chunk_values.reserve((size_t)CHUNK_FRAMES * num_cols * num_rows * num_channels * (half_precision ? 2 : 4));
+
+	header_written = true;
+}
+
+void RecorderHOG::WriteChunk()
+{
+	int num_frames = (int)chunk_good_frames.size();
+
+	if (num_frames == 0)
+		return;
+
+	chunk_offsets.push_back((long long)hog_file.tellp());
+	chunk_first_frames.push_back(num_frames_written - num_frames);
+	chunk_num_frames.push_back(num_frames);
+
+	hog_file.write((char*)&num_frames, 4);
+	hog_file.write((char*)chunk_good_frames.data(), 4 * num_frames);
+	hog_file.write(chunk_values.data(), chunk_values.size());
+
+	chunk_good_frames.clear();
+	chunk_values.clear();
+}
+
+void RecorderHOG::WriteChunkedIndex(std::ofstream& output_file, const std::vector<long long>& chunk_offsets, const std::vector<int>& chunk_first_frames,
+	const std::vector<int>& chunk_num_frames)
+{
+	long long index_offset = (long long)output_file.tellp();
+
+	for (size_t i = 0; i < chunk_offsets.size(); ++i)
+	{
+		output_file.write((char*)&chunk_offsets[i], 8);
+		output_file.write((char*)&chunk_first_frames[i], 4);
+		output_file.write((char*)&chunk_num_frames[i], 4);
+	}
+
+	int num_chunks = (int)chunk_offsets.size();
+	output_file.write((char*)&num_chunks, 4);
+	output_file.write((char*)&index_offset, 8);
+	output_file.write("OFHOGIDX", 8);
+}
+
+bool RecorderHOG::AppendFile(const std::string& file_name, const std::string& other_file_name)
+{
+	ReaderHOG other_reader;
+	if (!other_reader.Open(other_file_name))
+	{
+		std::cout << "Could not read the HOG file " << other_file_name << std::endl;
+		return false;
+	}
+
+	if (other_reader.GetNumFrames() == 0)
+		return true;
+
+	// Nothing recorded yet, so the other file can simply take the place of this one
+	ReaderHOG reader;
+	if (!reader.Open(file_name) || reader.GetNumFrames() == 0)
+	{
+		reader.Close();
+		other_reader.Close();
+		if (fs::exists(file_name))
+			fs::remove(file_name);
+		fs::copy_file(other_file_name, file_name);
+		return true;
+	}
+
+	if (reader.IsChunked() != other_reader.IsChunked() || reader.IsHalfPrecision() != other_reader.IsHalfPrecision() ||
+		reader.GetNumCols() != other_reader.GetNumCols() || reader.GetNumRows() != other_reader.GetNumRows() || reader.GetNumChannels() != other_reader.GetNumChannels())
+	{
+		std::cout << "The HOG files " << file_name << " and " << other_file_name << " have a different format and cannot be merged" << std::endl;
+		return false;
+	}
+
+	// The frame records (or chunks) of the other file are appended, for a chunked file they take the place of the current index
+	long long data_end = reader.GetChunksEnd();
+	long long other_data_begin = other_reader.IsChunked() ? CHUNKED_HEADER_SIZE : 0;
+	long long other_data_end = other_reader.GetChunksEnd();
+	int num_frames = reader.GetNumFrames();
+	bool is_chunked = reader.IsChunked();
+
+	std::vector<long long> chunk_offsets = reader.GetChunkOffsets();
+	std::vector<int> chunk_first_frames = reader.GetChunkFirstFrames();
+	std::vector<int> chunk_num_frames = reader.GetChunkNumFrames();
+
+	for (size_t i = 0; i < other_reader.GetChunkOffsets().size(); ++i)
+	{
+		chunk_offsets.push_back(other_reader.GetChunkOffsets()[i] - other_data_begin + data_end);
+		chunk_first_frames.push_back(other_reader.GetChunkFirstFrames()[i] + num_frames);
+		chunk_num_frames.push_back(other_reader.GetChunkNumFrames()[i]);
+	}
+
+	reader.Close();
+	other_reader.Close();
+
+	if (data_end != (long long)fs::file_size(file_name))
+		fs::resize_file(file_name, data_end);
+
+	std::ifstream other_file(other_file_name, std::ios_base::in | std::ios_base::binary);
+	std::ofstream output_file(file_name, std::ios_base::out | std::ios_base::app | std::ios_base::binary);
+
+	if (!other_file.is_open() || !output_file.is_open())
+		return false;
+
+	other_file.seekg(other_data_begin);
+
+	std::vector<char> buffer(1 << 20);
+	long long remaining = other_data_end - other_data_begin;
+	while (remaining > 0 && other_file)
+	{
+		std::streamsize block = (std::streamsize)std::min<long long>(remaining, (long long)buffer.size());
+		other_file.read(buffer.data(), block);
+		output_file.write(buffer.data(), other_file.gcount());
+		remaining -= other_file.gcount();
+	}
+
+	if (is_chunked)
+	{
+		WriteChunkedIndex(output_file, chunk_offsets, chunk_first_frames, chunk_num_frames);
+	}
+
+	return remaining == 0 && output_file.good();
+}
+
 // Writing to a HOG file
 void RecorderHOG::SetObservationHOG(bool good_frame, const cv::Mat_<double>& hog_descriptor, int num_cols, int num_rows, int num_channels)
 {
@@ -99,4 +345,4 @@ void RecorderHOG::SetObservationHOG(bool good_frame, const cv::Mat_<double>& hog
 	this->num_channels = num_channels;
 	this->hog_descriptor = hog_descriptor;
 	this->good_frame = good_frame;
-}
\ No newline at end of file
+}
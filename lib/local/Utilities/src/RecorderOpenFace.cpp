@@ -36,6 +36,9 @@
 
 using namespace Utilities;
 
+#define INFO_STREAM( stream ) \
+std::cout << stream << std::endl
+
 #define WARN_STREAM( stream ) \
 std::cout << "Warning: " << stream << std::endl
 
@@ -65,6 +68,47 @@ void RecorderOpenFace::VideoWritingTask(bool is_sequence)
 
 	std::pair<std::string, cv::Mat> tracked_data;
 
+	// With the raw output policy the frames are only copied to an intermediate file, and encoded once all of them have been produced
+	bool write_raw = is_sequence && params.trackedOutputPolicy().compare("raw") == 0;
+	std::ofstream raw_file;
+	cv::Size raw_size;
+	int raw_type = -1;
+	int num_raw_frames = 0;
+	size_t raw_file_size = 0;
+	const size_t max_raw_file_size = (size_t)RAW_TRACKED_MAX_SIZE * 1024 * 1024;
+
+	// Encodes the frames buffered in the intermediate file and removes it
+	auto encode_raw = [&]()
+	{
+		raw_file.close();
+
+		std::ifstream raw_input(raw_tracked_filename, std::ios_base::in | std::ios_base::binary);
+		if (raw_type != -1)
+		{
+			cv::Mat frame(raw_size, raw_type);
+			for (int i = 0; i < num_raw_frames && raw_input; ++i)
+			{
+				raw_input.read((char*)frame.data, frame.total() * frame.elemSize());
+				if (raw_input && video_writer.isOpened())
+				{
+					video_writer.write(frame);
+				}
+			}
+		}
+		raw_input.close();
+		fs::remove(raw_tracked_filename);
+	};
+
+	if (write_raw)
+	{
+		raw_file.open(raw_tracked_filename, std::ios_base::out | std::ios_base::binary);
+		if (!raw_file.is_open())
+		{
+			WARN_STREAM("Could not open the intermediate tracked video file, encoding the frames directly");
+			write_raw = false;
+		}
+	}
+
 	while (true)
 	{
 		vis_to_out_queue.pop(tracked_data);
@@ -75,9 +119,34 @@ void RecorderOpenFace::VideoWritingTask(bool is_sequence)
 			break;
 		}
 
+		if (is_sequence && write_raw)
+		{
+			if (raw_type == -1)
+			{
+				raw_size = tracked_data.second.size();
+				raw_type = tracked_data.second.type();
+			}
+
+			size_t frame_size = tracked_data.second.total() * tracked_data.second.elemSize();
+			if (raw_file_size + frame_size > max_raw_file_size)
+			{
+				// The intermediate file is full, encode what it holds and then the rest of the frames as they come
+				encode_raw();
+				write_raw = false;
+				raw_tracked_overflow = true;
+			}
+			else if (tracked_data.second.size() == raw_size && tracked_data.second.type() == raw_type)
+			{
+				cv::Mat frame = tracked_data.second.isContinuous() ? tracked_data.second : tracked_data.second.clone();
+				raw_file.write((char*)frame.data, frame_size);
+				raw_file_size += frame_size;
+				num_raw_frames++;
+			}
+		}
+
 		if (is_sequence)
 		{
-			if (video_writer.isOpened())
+			if (!write_raw && video_writer.isOpened())
 			{
 				video_writer.write(tracked_data.second);
 			}
@@ -91,22 +160,43 @@ void RecorderOpenFace::VideoWritingTask(bool is_sequence)
 			}
 		}		
 	}
+
+	// Encoding the intermediate frames now that tracking is done
+	if (write_raw)
+	{
+		encode_raw();
+	}
 }
 
-void RecorderOpenFace::AlignedImageWritingTask()
+void RecorderOpenFace::AlignedImageWritingTask(int writer)
 {
 
 	std::pair<std::string, cv::Mat> tracked_data;
+	std::vector<uchar> encoded_image;
+	const std::string image_extension = "." + params.imageFormatAligned();
 
 	while (true)
 	{
-		aligned_face_queue.pop(tracked_data);
+		aligned_face_queues[writer]->pop(tracked_data);
 
 		// Empty frame indicates termination
 		if (tracked_data.second.empty())
 			break;
 
-		bool write_success = cv::imwrite(tracked_data.first, tracked_data.second);
+		bool write_success;
+		if (params.alignedPacked())
+		{
+			// The images are encoded in parallel, only adding them to the packed file is serialized
+			write_success = cv::imencode(image_extension, tracked_data.second, encoded_image);
+			if (write_success)
+			{
+				aligned_pack_recorder.Write(tracked_data.first, encoded_image);
+			}
+		}
+		else
+		{
+			write_success = cv::imwrite(tracked_data.first, tracked_data.second);
+		}
 
 		if (!write_success)
 		{
@@ -126,7 +216,8 @@ void RecorderOpenFace::PrepareRecording(const std::string& in_filename)
 	of_det_name = fs::path(record_root) / fs::path(out_name + "_of_details.txt");
 
 	// Write in the of file what we are outputing what is the input etc.
-	metadata_file.open(of_det_name.string(), std::ios_base::out);
+	metadata_filename = of_det_name.string();
+	metadata_file.open(metadata_filename, std::ios_base::out);
 	if (!metadata_file.is_open())
 	{
 		std::cout << "ERROR: could not open the output file:" << of_det_name << ", either the path of the output directory is wrong or you do not have the permissions to write to it" << std::endl;
@@ -156,15 +247,16 @@ void RecorderOpenFace::PrepareRecording(const std::string& in_filename)
 
 	// Create the required individual recorders, CSV, HOG, aligned, video
 	csv_filename = out_name + ".csv";
+	columnar_filename = out_name + ".ofcol";
 
 	// Consruct HOG recorder here
 	if (params.outputHOG())
 	{
 		// Output the data based on record_root, but do not include record_root in the meta file, as it is also in that directory
-		std::string hog_filename = out_name + ".hog";
+		hog_filename = out_name + ".hog";
 		metadata_file << "Output HOG:" << hog_filename << std::endl;
 		hog_filename = (fs::path(record_root) / hog_filename).string();
-		hog_recorder.Open(hog_filename);
+		hog_recorder.Open(hog_filename, params.hogChunked(), params.hogHalfPrecision());
 	}
 		
 	// saving the videos	
@@ -186,7 +278,18 @@ void RecorderOpenFace::PrepareRecording(const std::string& in_filename)
 	}
 
 	// Prepare image recording
-	if (params.outputAlignedFaces())
+	if (params.outputAlignedFaces() && params.alignedPacked())
+	{
+		aligned_pack_filename = out_name + "_aligned.ofaln";
+		metadata_file << "Output aligned pack:" << this->aligned_pack_filename << std::endl;
+		this->aligned_pack_filename = (fs::path(record_root) / this->aligned_pack_filename).string();
+		if (!aligned_pack_recorder.Open(aligned_pack_filename))
+		{
+			std::cout << "ERROR: could not open the output file:" << aligned_pack_filename << ", either the path of the output directory is wrong or you do not have the permissions to write to it" << std::endl;
+			exit(1);
+		}
+	}
+	else if (params.outputAlignedFaces())
 	{
 		aligned_output_directory = out_name + "_aligned";
 		metadata_file << "Output aligned directory:" << this->aligned_output_directory << std::endl;
@@ -196,7 +299,9 @@ void RecorderOpenFace::PrepareRecording(const std::string& in_filename)
 
 	this->frame_number = 0;
 	this->tracked_writing_thread_started = false;
+	this->raw_tracked_overflow = false;
 	this->aligned_writing_thread_started = false;
+	this->next_aligned_writer = 0;
 }
 
 RecorderOpenFace::RecorderOpenFace(const std::string in_filename, const RecorderOpenFaceParameters& parameters, std::vector<std::string>& arguments):video_writer(), params(parameters)
@@ -332,13 +437,29 @@ void RecorderOpenFace::WriteObservation()
 
 		csv_filename = (fs::path(record_root) / csv_filename).string();
 		csv_recorder.Open(csv_filename, params.isSequence(), params.output2DLandmarks(), params.output3DLandmarks(), params.outputPDMParams(), params.outputPose(),
-			params.outputAUs(), params.outputGaze(), num_face_landmarks, num_model_modes, num_eye_landmarks, au_names_class, au_names_reg);
+			params.outputAUs(), params.outputGaze(), num_face_landmarks, num_model_modes, num_eye_landmarks, au_names_class, au_names_reg, params.postprocessAUs());
+
+		// The same data in a columnar format
+		if (params.outputColumnar())
+		{
+			metadata_file << "Output columnar:" << columnar_filename << std::endl;
+			columnar_filename = (fs::path(record_root) / columnar_filename).string();
+			columnar_recorder.Open(columnar_filename, params.isSequence(), params.output2DLandmarks(), params.output3DLandmarks(), params.outputPDMParams(), params.outputPose(),
+				params.outputAUs(), params.outputGaze(), num_face_landmarks, num_model_modes, num_eye_landmarks, au_names_class, au_names_reg);
+		}
 	}
 
 	this->csv_recorder.WriteLine(face_id, frame_number, timestamp, landmark_detection_success, 
 		landmark_detection_confidence, landmarks_2D, landmarks_3D, pdm_params_local, pdm_params_global, head_pose,
 		gaze_direction0, gaze_direction1, gaze_angle, eye_landmarks2D, eye_landmarks3D, au_intensities, au_occurences);
 
+	if (params.outputColumnar())
+	{
+		this->columnar_recorder.WriteLine(face_id, frame_number, timestamp, landmark_detection_success,
+			landmark_detection_confidence, landmarks_2D, landmarks_3D, pdm_params_local, pdm_params_global, head_pose,
+			gaze_direction0, gaze_direction1, gaze_angle, eye_landmarks2D, eye_landmarks3D, au_intensities, au_occurences);
+	}
+
 	if(params.outputHOG())
 	{
 		this->hog_recorder.Write();
@@ -351,11 +472,22 @@ void RecorderOpenFace::WriteObservation()
 		if (!aligned_writing_thread_started)
 		{
 			aligned_writing_thread_started = true;
-			int capacity = (1024 * 1024 * ALIGNED_QUEUE_CAPACITY) / (aligned_face.size().width *aligned_face.size().height * aligned_face.channels()) + 1;
-			aligned_face_queue.set_capacity(capacity);
+			int num_writers = params.alignedWriterThreads();
+			int capacity = (1024 * 1024 * ALIGNED_QUEUE_CAPACITY) / (aligned_face.size().width *aligned_face.size().height * aligned_face.channels() * num_writers) + 1;
+
+			aligned_face_queues.clear();
+			for (int i = 0; i < num_writers; ++i)
+			{
+				aligned_face_queues.push_back(std::unique_ptr<SPSCQueue<std::pair<std::string, cv::Mat> > >(new SPSCQueue<std::pair<std::string, cv::Mat> >()));
+				aligned_face_queues.back()->set_capacity(capacity);
+			}
+			next_aligned_writer = 0;
 
-			// Start the alignment output thread			
-			aligned_writing_thread = std::thread(&RecorderOpenFace::AlignedImageWritingTask, this);
+			// Start the alignment output threads
+			for (int i = 0; i < num_writers; ++i)
+			{
+				aligned_writing_threads.push_back(std::thread(&RecorderOpenFace::AlignedImageWritingTask, this, i));
+			}
 		}
 
 		char name[100];
@@ -366,12 +498,16 @@ void RecorderOpenFace::WriteObservation()
 		else
 			std::sprintf(name, "face_det_%06d.", face_id);
 
-		// Construct the output filename
-		std::string out_file = (fs::path(aligned_output_directory) / fs::path(std::string(name) + params.imageFormatAligned())).string();
+		// Construct the output filename (just the name when packing the images)
+		std::string out_file = std::string(name) + params.imageFormatAligned();
+		if (!params.alignedPacked())
+			out_file = (fs::path(aligned_output_directory) / fs::path(out_file)).string();
 
+		// The writers are used in turn, so each of them gets an equal share of the images
 		if(params.outputBadAligned() || landmark_detection_success)
 		{
-			aligned_face_queue.push(std::pair<std::string, cv::Mat>(out_file, aligned_face));
+			aligned_face_queues[next_aligned_writer]->push(std::pair<std::string, cv::Mat>(out_file, std::move(aligned_face)));
+			next_aligned_writer = (next_aligned_writer + 1) % aligned_face_queues.size();
 		}
 
 		// Clear the image
@@ -394,6 +530,13 @@ void RecorderOpenFace::WriteObservationTracked()
 			int capacity = (1024 * 1024 * TRACKED_QUEUE_CAPACITY) / (vis_to_out.size().width * vis_to_out.size().height * vis_to_out.channels()) + 1;
 			vis_to_out_queue.set_capacity(capacity);
 
+			tracked_frames_queued = 0;
+			tracked_frames_dropped = 0;
+			tracked_max_queue_depth = 0;
+			tracked_stall_time = 0;
+			raw_tracked_filename = media_filename + ".raw";
+			raw_tracked_overflow = false;
+
 			// Initialize the video writer if it has not been opened yet
 			if (params.isSequence())
 			{
@@ -423,13 +566,25 @@ void RecorderOpenFace::WriteObservationTracked()
 			WARN_STREAM("Output tracked video frame is not set");
 		}
 
-		if (params.isSequence())
+		std::pair<std::string, cv::Mat> tracked_data(params.isSequence() ? "" : media_filename, std::move(vis_to_out));
+
+		tracked_max_queue_depth = std::max(tracked_max_queue_depth, vis_to_out_queue.size());
+
+		// Only block when the queue is full, and then either wait for the writer or skip the frame (individual images are never skipped)
+		if (vis_to_out_queue.try_push(std::move(tracked_data)))
 		{
-			vis_to_out_queue.push(std::pair<std::string, cv::Mat>("", vis_to_out));
+			tracked_frames_queued++;
+		}
+		else if (params.isSequence() && params.trackedOutputPolicy().compare("drop") == 0)
+		{
+			tracked_frames_dropped++;
 		}
 		else
 		{
-			vis_to_out_queue.push(std::pair<std::string, cv::Mat>(media_filename, vis_to_out));
+			auto stall_start = std::chrono::steady_clock::now();
+			vis_to_out_queue.push(std::move(tracked_data));
+			tracked_stall_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - stall_start).count();
+			tracked_frames_queued++;
 		}
 
 		// Clear the output
@@ -502,24 +657,141 @@ RecorderOpenFace::~RecorderOpenFace()
 
 void RecorderOpenFace::Close()
 {
-	// Insert terminating frames to the queues
-	vis_to_out_queue.push(std::pair<std::string, cv::Mat>("", cv::Mat()));
-	aligned_face_queue.push(std::pair<std::string, cv::Mat>("", cv::Mat()));
+	// Insert terminating frames to the queues (only if the writing threads are running, as the queues are bounded and would not be drained otherwise)
+	if (video_writing_thread.joinable())
+		vis_to_out_queue.push(std::pair<std::string, cv::Mat>("", cv::Mat()));
+	for (size_t i = 0; i < aligned_writing_threads.size(); ++i)
+		aligned_face_queues[i]->push(std::pair<std::string, cv::Mat>("", cv::Mat()));
 
 	// Make sure the recording threads complete
 	if (video_writing_thread.joinable())
+	{
 		video_writing_thread.join();
-	if (aligned_writing_thread.joinable())
-		aligned_writing_thread.join();
+
+		if (params.isSequence())
+		{
+			INFO_STREAM("Tracked video output (" << params.trackedOutputPolicy() << " policy): " << tracked_frames_queued << " frames written, " << tracked_frames_dropped << " dropped, maximum queue depth "
+				<< tracked_max_queue_depth << " of " << vis_to_out_queue.capacity() << ", stalled for " << std::fixed << std::setprecision(2) << tracked_stall_time << "s" << std::defaultfloat);
+			if (raw_tracked_overflow)
+			{
+				INFO_STREAM("The intermediate tracked video file reached " << RAW_TRACKED_MAX_SIZE << "MB, the later frames were encoded directly");
+			}
+		}
+	}
+	for (size_t i = 0; i < aligned_writing_threads.size(); ++i)
+		aligned_writing_threads[i].join();
+	aligned_writing_threads.clear();
 
 	tracked_writing_thread_started = false;
 	aligned_writing_thread_started = false;
 
 	hog_recorder.Close();
 	csv_recorder.Close();
+	columnar_recorder.Close();
+	aligned_pack_recorder.Close();
 	video_writer.release();
 	metadata_file.close();
 }
 
+void RecorderOpenFace::MergeRecording(const RecorderOpenFace& other)
+{
+	// The CSV file of the other recording is only created once it observed something
+	std::string other_csv = (fs::path(other.record_root) / (other.out_name + ".csv")).string();
+	csv_filename = (fs::path(record_root) / (out_name + ".csv")).string();
+
+	if (fs::exists(other_csv))
+	{
+		bool has_header = fs::exists(csv_filename) && fs::file_size(csv_filename) > 0;
+
+		std::ifstream other_csv_file(other_csv, std::ios_base::in);
+		std::ofstream csv_file(csv_filename, std::ios_base::out | std::ios_base::app);
+		if (!csv_file.is_open())
+		{
+			std::cout << "ERROR: could not open the output file:" << csv_filename << ", either the path of the output directory is wrong or you do not have the permissions to write to it" << std::endl;
+			exit(1);
+		}
+
+		// Skip the header if this recording already has one
+		std::string line;
+		if (has_header)
+		{
+			std::getline(other_csv_file, line);
+		}
+		while (std::getline(other_csv_file, line))
+		{
+			csv_file << line << "\n";
+		}
+		csv_file.close();
+		other_csv_file.close();
+
+		// The output description is only written together with the header
+		if (!has_header)
+		{
+			std::ifstream other_metadata_file(other.metadata_filename, std::ios_base::in);
+			std::ofstream merged_metadata_file(metadata_filename, std::ios_base::out | std::ios_base::app);
+			bool output_description = false;
+			while (std::getline(other_metadata_file, line))
+			{
+				if (line.compare(0, 11, "Output csv:") == 0)
+				{
+					output_description = true;
+					line = "Output csv:" + out_name + ".csv";
+				}
+				else if (line.compare(0, 16, "Output columnar:") == 0)
+				{
+					line = "Output columnar:" + out_name + ".ofcol";
+				}
+				if (output_description)
+				{
+					merged_metadata_file << line << std::endl;
+				}
+			}
+		}
+		fs::remove(other_csv);
+	}
+
+	// Columnar files are a sequence of chunks following the header
+	if (params.outputColumnar())
+	{
+		std::string other_columnar = (fs::path(other.record_root) / (other.out_name + ".ofcol")).string();
+		if (fs::exists(other_columnar))
+		{
+			columnar_filename = (fs::path(record_root) / (out_name + ".ofcol")).string();
+			RecorderColumnar::AppendFile(columnar_filename, other_columnar);
+			fs::remove(other_columnar);
+		}
+	}
+
+	// HOG files are a sequence of frame records (or chunks), so can be appended
+	if (params.outputHOG() && !other.hog_filename.empty() && fs::exists(other.hog_filename))
+	{
+		RecorderHOG::AppendFile(hog_filename, other.hog_filename);
+		fs::remove(other.hog_filename);
+	}
+
+	// Packed aligned images are indexed by name, so can be appended
+	if (params.outputAlignedFaces() && !other.aligned_pack_filename.empty() && fs::exists(other.aligned_pack_filename))
+	{
+		RecorderAlignedPack::AppendFile(aligned_pack_filename, other.aligned_pack_filename);
+		fs::remove(other.aligned_pack_filename);
+	}
+
+	// Aligned images are named by frame number, so can just be moved over
+	if (params.outputAlignedFaces() && !other.aligned_output_directory.empty() && fs::exists(other.aligned_output_directory))
+	{
+		for (fs::directory_iterator it(other.aligned_output_directory); it != fs::directory_iterator(); ++it)
+		{
+			fs::path aligned_file = it->path();
+			fs::rename(aligned_file, fs::path(aligned_output_directory) / aligned_file.filename());
+		}
+		fs::remove_all(other.aligned_output_directory);
+	}
+
+	if (fs::exists(other.metadata_filename))
+	{
+		fs::remove(other.metadata_filename);
+	}
+}
+
 
 
@@ -34,8 +34,17 @@
 
 #include "RecorderOpenFaceParameters.h"
 
+#include <thread>
+
 using namespace Utilities;
 
+// Image encoding is cheap compared to tracking, so a few threads are enough to keep up with it
+static int DefaultAlignedWriterThreads()
+{
+	int num_threads = (int)std::thread::hardware_concurrency() / 4;
+	return std::min(4, std::max(1, num_threads));
+}
+
 RecorderOpenFaceParameters::RecorderOpenFaceParameters(std::vector<std::string> &arguments, bool sequence, bool from_webcam, float fx, float fy, float cx, float cy, double fps_vid_out)
 {
 
@@ -71,6 +80,13 @@ RecorderOpenFaceParameters::RecorderOpenFaceParameters(std::vector<std::string>
 	this->output_hog = false;
 	this->output_tracked = false;
 	this->output_aligned_faces = false;
+	this->output_columnar = false;
+	this->postprocess_AUs = false;
+	this->hog_chunked = false;
+	this->hog_half_precision = false;
+	this->aligned_packed = false;
+	this->aligned_writer_threads = DefaultAlignedWriterThreads();
+	this->tracked_output_policy = "block";
 
 	this->record_aligned_bad = true;
 
@@ -90,6 +106,48 @@ RecorderOpenFaceParameters::RecorderOpenFaceParameters(std::vector<std::string>
 		{
 			this->record_aligned_bad = false;
 		}
+		if (arguments[i].compare("-columnar") == 0)
+		{
+			this->output_columnar = true;
+		}
+		if (arguments[i].compare("-hog_chunked") == 0)
+		{
+			this->hog_chunked = true;
+		}
+		if (arguments[i].compare("-hog_half") == 0)
+		{
+			this->hog_chunked = true;
+			this->hog_half_precision = true;
+		}
+		if (arguments[i].compare("-aligned_pack") == 0)
+		{
+			this->aligned_packed = true;
+		}
+		if (arguments[i].compare("-tracked_policy") == 0)
+		{
+			this->tracked_output_policy = arguments[i + 1];
+			if (tracked_output_policy.compare("block") != 0 && tracked_output_policy.compare("drop") != 0 && tracked_output_policy.compare("raw") != 0)
+			{
+				std::cout << "WARNING: unknown tracked output policy " << tracked_output_policy << ", using block" << std::endl;
+				this->tracked_output_policy = "block";
+			}
+			i++;
+		}
+		if (arguments[i].compare("-aligned_threads") == 0)
+		{
+			std::stringstream data(arguments[i + 1]);
+			int threads = 0;
+			data >> threads;
+			if (threads > 0)
+			{
+				this->aligned_writer_threads = threads;
+			}
+			else
+			{
+				std::cout << "WARNING: invalid number of aligned face writing threads " << arguments[i + 1] << ", ignoring it" << std::endl;
+			}
+			i++;
+		}
 		if (arguments[i].compare("-simalign") == 0)
 		{
 			this->output_aligned_faces = true;
@@ -188,4 +246,11 @@ RecorderOpenFaceParameters::RecorderOpenFaceParameters(bool sequence, bool is_fr
 	this->output_hog = output_hog;
 	this->output_tracked = output_tracked;
 	this->output_aligned_faces = output_aligned_faces;
+	this->output_columnar = false;
+	this->postprocess_AUs = false;
+	this->hog_chunked = false;
+	this->hog_half_precision = false;
+	this->aligned_packed = false;
+	this->aligned_writer_threads = DefaultAlignedWriterThreads();
+	this->tracked_output_policy = "block";
 }
\ No newline at end of file
@@ -152,6 +152,26 @@ bool SequenceCapture::Open(std::vector<std::string>& arguments)
 			valid[i + 1] = false;
 			i++;
 		}
+		else if (arguments[i].compare("-stride") == 0)
+		{
+			std::stringstream data(arguments[i + 1]);
+			data >> frame_stride;
+			i++;
+		}
+		else if (arguments[i].compare("-target_fps") == 0)
+		{
+			std::stringstream data(arguments[i + 1]);
+			data >> target_fps;
+			i++;
+		}
+		else if (arguments[i].compare("-decode_threads") == 0)
+		{
+			std::stringstream data(arguments[i + 1]);
+			data >> num_decode_threads;
+			valid[i] = false;
+			valid[i + 1] = false;
+			i++;
+		}
 	}
 
 	for (int i = (int)arguments.size() - 1; i >= 0; --i)
@@ -225,6 +245,9 @@ bool SequenceCapture::OpenWebcam(int device, int image_width, int image_height,
 	is_webcam = true;
 	is_image_seq = false;
 
+	// Webcams are always processed at their native rate
+	curr_frame_stride = 1;
+
 	vid_length = 0;
 
 	this->frame_width = (int)capture.get(cv::CAP_PROP_FRAME_WIDTH);
@@ -272,6 +295,9 @@ void SequenceCapture::Close()
 		capture_queue.pop();
 	}
 
+	// Stop the image decoders, so that the capture thread is not left waiting on them
+	image_decoder.Stop();
+
 	if (capture_thread.joinable())
 		capture_thread.join();
 	
@@ -288,6 +314,11 @@ SequenceCapture::~SequenceCapture()
 }
 
 bool SequenceCapture::OpenVideoFile(std::string video_file, float fx, float fy, float cx, float cy)
+{
+	return OpenVideoFileSegment(video_file, 0, -1, fx, fy, cx, cy);
+}
+
+bool SequenceCapture::OpenVideoFileSegment(std::string video_file, int start_frame, int end_frame, float fx, float fy, float cx, float cy)
 {
 	INFO_STREAM("Attempting to read from file: " << video_file);
 
@@ -323,11 +354,34 @@ bool SequenceCapture::OpenVideoFile(std::string video_file, float fx, float fy,
 
 	vid_length = (int)capture.get(cv::CAP_PROP_FRAME_COUNT);
 
+	// If only a part of the video is needed, seek to its start
+	segment_start_frame = std::max(0, start_frame);
+	segment_end_frame = end_frame;
+	if (segment_start_frame > 0)
+	{
+		capture.set(cv::CAP_PROP_POS_FRAMES, segment_start_frame);
+	}
+
+	// Work out how many frames to skip if only a lower frame rate is needed
+	curr_frame_stride = std::max(1, frame_stride);
+	if (target_fps > 0)
+	{
+		curr_frame_stride = std::max(1, (int)std::round(fps / target_fps));
+	}
+	if (curr_frame_stride > 1)
+	{
+		INFO_STREAM("Processing every " << curr_frame_stride << " frame(s), at " << fps / curr_frame_stride << " fps");
+	}
+
 	SetCameraIntrinsics(fx, fy, cx, cy);
 
 	this->name = video_file;
 	capturing = true;
 
+	// Pre-allocate the capture queue slots based on the memory budget before the capture thread starts filling it
+	int capacity = (CAPTURE_CAPACITY * 1024 * 1024) / (4 * frame_width * frame_height);
+	capture_queue.set_capacity(capacity);
+
 	capture_thread = std::thread(&SequenceCapture::CaptureThread, this);
 
 	return true;
@@ -390,10 +444,27 @@ bool SequenceCapture::OpenImageSequence(std::string directory, float fx, float f
 	this->name = directory;
 
 	is_webcam = false;
-	is_image_seq = true;	
+	is_image_seq = true;
+	segment_start_frame = 0;
+	segment_end_frame = -1;
 	vid_length = image_files.size();
 	capturing = true;
 
+	// Only decode every n-th image if a stride is used
+	curr_frame_stride = std::max(1, frame_stride);
+	std::vector<std::string> files_to_decode;
+	for (size_t i = 0; i < image_files.size(); i += curr_frame_stride)
+	{
+		files_to_decode.push_back(image_files[i]);
+	}
+
+	// Start decoding the images ahead of the capture thread
+	image_decoder.Start(files_to_decode, num_decode_threads);
+
+	// Pre-allocate the capture queue slots based on the memory budget before the capture thread starts filling it
+	int capacity = (CAPTURE_CAPACITY * 1024 * 1024) / (4 * frame_width * frame_height);
+	capture_queue.set_capacity(capacity);
+
 	capture_thread = std::thread(&SequenceCapture::CaptureThread, this);
 	
 	return true;
@@ -431,10 +502,9 @@ void SequenceCapture::SetCameraIntrinsics(float fx, float fy, float cx, float cy
 
 void SequenceCapture::CaptureThread()
 {
-	int capacity = (CAPTURE_CAPACITY * 1024 * 1024) / (4 * frame_width * frame_height);
-	capture_queue.set_capacity(capacity);
-
+	// The number of frames read so far and the index of the current frame in the source sequence
 	int frame_num_int = 0;
+	size_t source_frame = 0;
 
 	while(capturing)
 	{
@@ -444,7 +514,30 @@ void SequenceCapture::CaptureThread()
 
 		if (!is_image_seq)
 		{
-			bool success = capture.read(tmp_frame);
+			bool success = true;
+
+			source_frame = frame_num_int == 0 ? segment_start_frame : source_frame + 1;
+
+			// Skip over the frames in between when using a stride, grabbing them without decoding
+			if (frame_num_int > 0)
+			{
+				for (int i = 1; i < curr_frame_stride && success; ++i)
+				{
+					success = capture.grab();
+					source_frame++;
+				}
+			}
+
+			// Stop at the end of the segment if only a part of the video is read
+			if (segment_end_frame >= 0 && (int)source_frame >= segment_end_frame)
+			{
+				success = false;
+			}
+
+			if (success)
+			{
+				success = capture.read(tmp_frame);
+			}
 
 			if (!success)
 			{
@@ -454,28 +547,31 @@ void SequenceCapture::CaptureThread()
 			}
 
 			// Recording the timestamp
-			timestamp_curr = frame_num_int * (1.0 / fps);			
+			timestamp_curr = source_frame * (1.0 / fps);
 		}
 		else if (is_image_seq)
 		{
-			if (image_files.empty() || frame_num_int >= (int)image_files.size())
+			// The decoder already performs the grayscale conversion
+			if (!image_decoder.Next(tmp_frame, tmp_gray_frame))
 			{
 				// Indicate lack of success by returning an empty image
 				tmp_frame = cv::Mat();
+				tmp_gray_frame = cv::Mat_<uchar>();
 				capturing = false;
 			}
-			else
-			{
-				tmp_frame = cv::imread(image_files[frame_num_int], cv::IMREAD_COLOR);
-			}
+			source_frame = frame_num_int * curr_frame_stride;
 			timestamp_curr = 0;
 		}
 
 		frame_num_int++;
+
 		// Set the grayscale frame
-		ConvertToGrayscale_8bit(tmp_frame, tmp_gray_frame);
+		if (!is_image_seq)
+		{
+			ConvertToGrayscale_8bit(tmp_frame, tmp_gray_frame);
+		}
 
-		capture_queue.push(std::make_tuple(timestamp_curr, tmp_frame, tmp_gray_frame));
+		capture_queue.push(std::make_tuple(timestamp_curr, std::move(tmp_frame), std::move(tmp_gray_frame), source_frame));
 		
 	}
 }
@@ -484,13 +580,16 @@ cv::Mat SequenceCapture::GetNextFrame()
 {
 	if(!is_webcam)
 	{
-		std::tuple<double, cv::Mat, cv::Mat_<uchar> > data;
+		std::tuple<double, cv::Mat, cv::Mat_<uchar>, size_t> data;
 
-		data = capture_queue.pop();
+		capture_queue.pop(data);
 
 		time_stamp = std::get<0>(data);
-		latest_frame = std::get<1>(data);
-		latest_gray_frame = std::get<2>(data);
+		latest_frame = std::move(std::get<1>(data));
+		latest_gray_frame = std::move(std::get<2>(data));
+
+		// Keep track of the frame number in the source sequence (one based)
+		frame_num = std::get<3>(data) + 1;
 
 	}
 	else
@@ -508,8 +607,8 @@ cv::Mat SequenceCapture::GetNextFrame()
 		
 		ConvertToGrayscale_8bit(latest_frame, latest_gray_frame);
 
+		frame_num++;
 	}
-	frame_num++;
 
 	return latest_frame;
 }
@@ -522,7 +621,8 @@ double SequenceCapture::GetProgress()
 	}
 	else
 	{
-		return (double)frame_num / (double)vid_length;
+		// The frame number is the one in the source, with a stride (or an inaccurate frame count of the video) it can go past the length
+		return std::min(1.0, (double)frame_num / (double)vid_length);
 	}
 }
 
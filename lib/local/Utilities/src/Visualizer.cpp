@@ -73,6 +73,9 @@ Visualizer::Visualizer(std::vector<std::string> arguments)
 	this->vis_align = false;
 	this->vis_aus = false;
 
+	this->tracked_rendered = true;
+	this->au_observed = false;
+
 	for (size_t i = 0; i < arguments.size(); ++i)
 	{
 		if (arguments[i].compare("-verbose") == 0)
@@ -108,13 +111,19 @@ Visualizer::Visualizer(bool vis_track, bool vis_hog, bool vis_align, bool vis_au
 	this->vis_hog = vis_hog;
 	this->vis_align = vis_align;
 	this->vis_aus = vis_aus;
+
+	this->tracked_rendered = true;
+	this->au_observed = false;
 }
 
 // Setting the image on which to draw
 void Visualizer::SetImage(const cv::Mat& canvas, float fx, float fy, float cx, float cy)
 {
-	// Convert the image to 8 bit RGB
-	captured_image = canvas.clone();
+	// The image is only copied once something is drawn on it
+	source_image = canvas;
+	captured_image = cv::Mat();
+	pending_tracked_draws.clear();
+	tracked_rendered = false;
 
 	this->fx = fx;
 	this->fy = fy;
@@ -126,41 +135,131 @@ void Visualizer::SetImage(const cv::Mat& canvas, float fx, float fy, float cx, f
 	aligned_face_image = cv::Mat();
 	action_units_image = cv::Mat();
 
+	pending_hog_descriptors.clear();
+	pending_hog_sizes.clear();
+	pending_aligned_faces.clear();
+	au_observed = false;
+
 }
 
 
 void Visualizer::SetObservationFaceAlign(const cv::Mat& aligned_face)
 {
-	if(this->aligned_face_image.empty())
-	{
-		this->aligned_face_image = aligned_face;
-	}
-	else
+	if (vis_align && !aligned_face.empty())
 	{
-		cv::vconcat(this->aligned_face_image, aligned_face, this->aligned_face_image);
+		pending_aligned_faces.push_back(aligned_face.clone());
 	}
 }
 
 void Visualizer::SetObservationHOG(const cv::Mat_<double>& hog_descriptor, int num_cols, int num_rows)
 {
 	if(vis_hog)
+	{
+		pending_hog_descriptors.push_back(hog_descriptor.clone());
+		pending_hog_sizes.push_back(std::pair<int, int>(num_cols, num_rows));
+	}
+
+}
+
+void Visualizer::SetObservationLandmarks(const cv::Mat_<float>& landmarks_2D, double confidence, const cv::Mat_<int>& visibilities)
+{
+	if (confidence > visualisation_boundary)
+	{
+		pending_tracked_draws.push_back([this, landmarks_2D = landmarks_2D.clone(), confidence, visibilities = visibilities.clone()]()
+		{
+			DrawLandmarks(landmarks_2D, confidence, visibilities);
+		});
+	}
+}
+
+void Visualizer::SetObservationPose(const cv::Vec6f& pose, double confidence)
+{
+	if (confidence > visualisation_boundary)
+	{
+		pending_tracked_draws.push_back([this, pose, confidence]() { DrawPose(pose, confidence); });
+	}
+}
+
+void Visualizer::SetObservationActionUnits(const std::vector<std::pair<std::string, double> >& au_intensities,
+	const std::vector<std::pair<std::string, double> >& au_occurences)
+{
+	// Only the latest observation is visualized
+	if (au_intensities.size() > 0 || au_occurences.size() > 0)
+	{
+		pending_au_intensities = au_intensities;
+		pending_au_occurences = au_occurences;
+		au_observed = true;
+	}
+}
+
+void Visualizer::SetObservationGaze(const cv::Point3f& gaze_direction0, const cv::Point3f& gaze_direction1, const std::vector<cv::Point2f>& eye_landmarks2d, const std::vector<cv::Point3f>& eye_landmarks3d, double confidence)
+{
+	if (confidence > visualisation_boundary && eye_landmarks2d.size() > 0)
+	{
+		pending_tracked_draws.push_back([this, gaze_direction0, gaze_direction1, eye_landmarks2d, eye_landmarks3d, confidence]()
+		{
+			DrawGaze(gaze_direction0, gaze_direction1, eye_landmarks2d, eye_landmarks3d, confidence);
+		});
+	}
+}
+
+void Visualizer::SetFps(double fps)
+{
+	pending_tracked_draws.push_back([this, fps]() { DrawFps(fps); });
+}
+
+void Visualizer::RenderTracked()
+{
+	if (tracked_rendered)
+		return;
+
+	captured_image = source_image.clone();
+
+	for (size_t i = 0; i < pending_tracked_draws.size(); ++i)
+	{
+		pending_tracked_draws[i]();
+	}
+	pending_tracked_draws.clear();
+
+	tracked_rendered = true;
+}
+
+void Visualizer::RenderHOG()
+{
+	for (size_t i = 0; i < pending_hog_descriptors.size(); ++i)
 	{
 		if (this->hog_image.empty())
 		{
-			Visualise_FHOG(hog_descriptor, num_rows, num_cols, this->hog_image);
+			Visualise_FHOG(pending_hog_descriptors[i], pending_hog_sizes[i].second, pending_hog_sizes[i].first, this->hog_image);
 		}
 		else
 		{
 			cv::Mat tmp_hog;
-			Visualise_FHOG(hog_descriptor, num_rows, num_cols, tmp_hog);
+			Visualise_FHOG(pending_hog_descriptors[i], pending_hog_sizes[i].second, pending_hog_sizes[i].first, tmp_hog);
 			cv::vconcat(this->hog_image, tmp_hog, this->hog_image);
 		}
 	}
-
+	pending_hog_descriptors.clear();
+	pending_hog_sizes.clear();
 }
 
+void Visualizer::RenderAlignedFaces()
+{
+	for (size_t i = 0; i < pending_aligned_faces.size(); ++i)
+	{
+		if (this->aligned_face_image.empty())
+		{
+			this->aligned_face_image = pending_aligned_faces[i];
+		}
+		else
+		{
+			cv::vconcat(this->aligned_face_image, pending_aligned_faces[i], this->aligned_face_image);
+		}
+	}
+	pending_aligned_faces.clear();
+}
 
-void Visualizer::SetObservationLandmarks(const cv::Mat_<float>& landmarks_2D, double confidence, const cv::Mat_<int>& visibilities)
+void Visualizer::DrawLandmarks(const cv::Mat_<float>& landmarks_2D, double confidence, const cv::Mat_<int>& visibilities)
 {
 
 	if(confidence > visualisation_boundary)
@@ -200,7 +299,7 @@ void Visualizer::SetObservationLandmarks(const cv::Mat_<float>& landmarks_2D, do
 	}
 }
 
-void Visualizer::SetObservationPose(const cv::Vec6f& pose, double confidence)
+void Visualizer::DrawPose(const cv::Vec6f& pose, double confidence)
 {
 
 	// Only draw if the reliability is reasonable, the value is slightly ad-hoc
@@ -221,11 +320,14 @@ void Visualizer::SetObservationPose(const cv::Vec6f& pose, double confidence)
 	}
 }
 
-void Visualizer::SetObservationActionUnits(const std::vector<std::pair<std::string, double> >& au_intensities,
-	const std::vector<std::pair<std::string, double> >& au_occurences)
+void Visualizer::RenderActionUnits()
 {
-	if (au_intensities.size() > 0 || au_occurences.size() > 0)
+	if (au_observed)
 	{
+		au_observed = false;
+
+		const std::vector<std::pair<std::string, double> >& au_intensities = pending_au_intensities;
+		const std::vector<std::pair<std::string, double> >& au_occurences = pending_au_occurences;
 
 		std::set<std::string> au_names;
 		std::map<std::string, bool> occurences_map;
@@ -324,7 +426,7 @@ void Visualizer::SetObservationActionUnits(const std::vector<std::pair<std::stri
 
 
 // Eye gaze infomration drawing, first of eye landmarks then of gaze
-void Visualizer::SetObservationGaze(const cv::Point3f& gaze_direction0, const cv::Point3f& gaze_direction1, const std::vector<cv::Point2f>& eye_landmarks2d, const std::vector<cv::Point3f>& eye_landmarks3d, double confidence)
+void Visualizer::DrawGaze(const cv::Point3f& gaze_direction0, const cv::Point3f& gaze_direction1, const std::vector<cv::Point2f>& eye_landmarks2d, const std::vector<cv::Point3f>& eye_landmarks3d, double confidence)
 {
 	if(confidence > visualisation_boundary)
 	{
@@ -399,7 +501,7 @@ void Visualizer::SetObservationGaze(const cv::Point3f& gaze_direction0, const cv
 	}
 }
 
-void Visualizer::SetFps(double fps)
+void Visualizer::DrawFps(double fps)
 {
 	// Write out the framerate on the image before displaying it
 	char fpsC[255];
@@ -413,6 +515,16 @@ char Visualizer::ShowObservation()
 {
 	bool ovservation_shown = false;
 
+	// Only the shown visualizations are rendered
+	if (vis_align)
+		RenderAlignedFaces();
+	if (vis_hog)
+		RenderHOG();
+	if (vis_aus)
+		RenderActionUnits();
+	if (vis_track)
+		RenderTracked();
+
 	if (vis_align && !aligned_face_image.empty())
 	{
 		cv::imshow("sim_warp", aligned_face_image);
@@ -428,7 +540,7 @@ char Visualizer::ShowObservation()
 		cv::imshow("action units", action_units_image);
 		ovservation_shown = true;
 	}
-	if (vis_track)
+	if (vis_track && !captured_image.empty())
 	{
 		cv::imshow("tracking result", captured_image);
 		ovservation_shown = true;
@@ -446,10 +558,12 @@ char Visualizer::ShowObservation()
 
 cv::Mat Visualizer::GetVisImage()
 {
+	RenderTracked();
 	return captured_image;
 }
 
 cv::Mat Visualizer::GetHOGVis()
 {
+	RenderHOG();
 	return hog_image;
 }